@@ -0,0 +1,40 @@
+#pragma once
+#include <trajopt_utils/macros.h>
+TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <jsoncpp/json/json.h>
+#include <string>
+TRAJOPT_IGNORE_WARNINGS_POP
+
+namespace json_marshal
+{
+/**
+ * @brief Parses a JSON request from a buffer
+ *
+ * A single pass parser that builds the Json::Value directly from the buffer, without the copy of the document, the
+ * token stream and the comment collection of Json::Reader. It accepts the documents Json::Reader accepts (including
+ * comments and its lenient numbers such as "1." or "-") and produces the same values, e.g. integers that fit in an int
+ * are intValue, larger ones uintValue, and numbers out of the range of a double are errors. The one difference is that
+ * anything but whitespace and comments after the document is an error, Json::Reader ignores it.
+ * Throws std::runtime_error with the offset of the error on malformed input.
+ */
+TRAJOPT_API Json::Value parseJson(const char* data, size_t size);
+TRAJOPT_API Json::Value parseJson(const std::string& doc);
+
+/**
+ * @brief Encodes a request in the binary request format
+ *
+ * The format is a magic number followed by the value tree in prefix order. Each value is a one byte tag followed by
+ * its payload in native (little endian) byte order: int64, uint64 or double numbers, uint32 length prefixed strings,
+ * uint32 counted arrays and objects. Arrays of doubles, e.g. a given initial trajectory, are stored as one block.
+ * Decoding needs no tokenizing or number parsing, and fromBinary(toBinary(v)) == v.
+ */
+TRAJOPT_API void toBinary(const Json::Value& v, std::string& out);
+TRAJOPT_API std::string toBinary(const Json::Value& v);
+
+/** @brief Decodes a request in the binary request format. Throws std::runtime_error if the data is malformed. */
+TRAJOPT_API Json::Value fromBinary(const char* data, size_t size);
+TRAJOPT_API Json::Value fromBinary(const std::string& data);
+
+/** @brief True if data starts with the magic number of the binary request format */
+TRAJOPT_API bool isBinary(const char* data, size_t size);
+}  // namespace json_marshal
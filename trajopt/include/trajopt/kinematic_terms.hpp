@@ -221,6 +221,9 @@ struct CartPoseErrCalculator : public TrajOptVectorOfVector
     assert(indices_.size() <= 6);
   }
 
+  /** @brief Change the target pose (in world coordinates) between optimizations */
+  void setTarget(const Eigen::Isometry3d& pose) { pose_inv_ = pose.inverse(); }
+
   void Plot(const tesseract_visualization::Visualization::Ptr& plotter, const Eigen::VectorXd& dof_vals) override;
 
   Eigen::VectorXd operator()(const Eigen::VectorXd& dof_vals) const override;
@@ -352,6 +355,40 @@ struct JointVelJacCalculator : sco::MatrixOfVector
   Eigen::MatrixXd operator()(const Eigen::VectorXd& var_vals) const override;
 };
 
+/**
+ * @brief Used to calculate the time scaled velocity error of all joints over a range of steps as a single term
+ *
+ * var_vals holds, for each step in order, the joint values followed by 1/dt (the row-major layout of the joint and
+ * time variables). The velocity of joint j between steps i and i+1 is (x_i+1,j - x_i,j) * (1/dt)_i+1. The first half of
+ * the output is the error above the upper tolerance and the second half the error below the lower tolerance, each
+ * ordered by step and then joint.
+ */
+struct JointVelTimeErrCalculator : sco::VectorOfVector
+{
+  /** @brief Velocity targets for each joint */
+  Eigen::VectorXd targets_;
+  /** @brief Upper tolerances for each joint */
+  Eigen::VectorXd upper_tols_;
+  /** @brief Lower tolerances for each joint */
+  Eigen::VectorXd lower_tols_;
+  JointVelTimeErrCalculator(const Eigen::VectorXd& targets,
+                            const Eigen::VectorXd& upper_tols,
+                            const Eigen::VectorXd& lower_tols)
+    : targets_(targets), upper_tols_(upper_tols), lower_tols_(lower_tols)
+  {
+  }
+  Eigen::VectorXd operator()(const Eigen::VectorXd& var_vals) const override;
+};
+
+/** @brief Sparse analytic Jacobian of JointVelTimeErrCalculator. Each row has three nonzeros */
+struct JointVelTimeJacCalculator : sco::SparseMatrixOfVector
+{
+  /** @brief Number of joints per step. The stride of var_vals is n_dof_ + 1 */
+  long n_dof_;
+  JointVelTimeJacCalculator(long n_dof) : n_dof_(n_dof) {}
+  SparseMatrix operator()(const Eigen::VectorXd& var_vals) const override;
+};
+
 struct JointAccErrCalculator : sco::VectorOfVector
 {
   JointVelErrCalculator vel_calc;
@@ -7,6 +7,7 @@ TRAJOPT_IGNORE_WARNINGS_POP
 #include <tesseract/tesseract.h>
 #include <trajopt/common.hpp>
 #include <trajopt/json_marshal.hpp>
+#include <trajopt/trajectory_library.hpp>
 #include <trajopt_sco/optimizers.hpp>
 
 namespace sco
@@ -42,6 +43,7 @@ enum TermType
 class TRAJOPT_API TrajOptProb : public sco::OptProb
 {
 public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
   using Ptr = std::shared_ptr<TrajOptProb>;
 
   TrajOptProb();
@@ -58,21 +60,64 @@ public:
   int GetNumDOF() { return m_traj_vars.cols(); }
   tesseract_kinematics::ForwardKinematics::ConstPtr GetKin() { return m_kin; }
   tesseract_environment::Environment::ConstPtr GetEnv() { return m_env; }
+  /**
+   * @brief The construction context shared by the terms of the problem
+   *
+   * The environment state, the transform from world to the base of the kinematics and the adjacency map of the active
+   * links are computed on first use and then shared by every term hatched into the problem, instead of each term
+   * traversing the scene graph again.
+   */
+  tesseract_environment::EnvState::ConstPtr GetEnvState();
+  const Eigen::Isometry3d& GetWorldToBase();
+  tesseract_environment::AdjacencyMap::ConstPtr GetAdjacencyMap();
   void SetInitTraj(const TrajArray& x) { m_init_traj = x; }
   TrajArray GetInitTraj() { return m_init_traj; }
   friend TrajOptProb::Ptr ConstructProblem(const ProblemConstructionInfo&);
+  friend TrajOptProb::Ptr ConstructProblem(const Json::Value&, const tesseract::Tesseract::ConstPtr&);
+  /** @brief The JSON request the problem was constructed from. Null if it was constructed from a
+   * ProblemConstructionInfo. */
+  const Json::Value& GetRequest() const { return m_request; }
   /** @brief Returns TrajOptProb.has_time */
   bool GetHasTime() { return has_time; }
   /** @brief Sets TrajOptProb.has_time  */
   void SetHasTime(bool tmp) { has_time = tmp; }
 
+  /**
+   * @brief Moves the start state, e.g. to re-plan from where the robot is now without constructing a new problem
+   *
+   * Sets the first row of the initial trajectory and replaces the start_fixed and dofs_fixed constraints.
+   * @param start The joint values of the first time step (without the dt column)
+   */
+  void SetStartState(const Eigen::VectorXd& start);
+  /** @brief Sets the target of every cartesian pose cost and constraint named name. Throws if there is none. */
+  void SetCartPoseTarget(const std::string& name, const Eigen::Isometry3d& world_pose);
+  /** @brief Sets the targets of every joint position cost and constraint named name. Throws if there is none. */
+  void SetJointPosTargets(const std::string& name, const Eigen::VectorXd& targets);
+
 private:
+  /** @brief Adds the start_fixed and dofs_fixed constraints for the first row of the initial trajectory */
+  void addStartConstraints();
+  /** @brief Computes the shared construction context if it has not been computed yet */
+  void initConstructionContext();
+
   /** @brief If true, the last column in the optimization matrix will be 1/dt */
   bool has_time;
   VarArray m_traj_vars;
   tesseract_kinematics::ForwardKinematics::ConstPtr m_kin;
   tesseract_environment::Environment::ConstPtr m_env;
   TrajArray m_init_traj;
+  /** @brief If true the joint values of the first time step are constrained to the start state */
+  bool m_start_fixed = false;
+  /** @brief Joints constrained to their start value at every time step */
+  IntVec m_dofs_fixed;
+  /** @brief The constraints added by addStartConstraints, replaced by SetStartState */
+  sco::CntVector m_start_cnts;
+  /** @brief See GetRequest */
+  Json::Value m_request;
+  /** @brief Construction context, see GetEnvState. Null until first used. */
+  tesseract_environment::EnvState::ConstPtr m_env_state;
+  tesseract_environment::AdjacencyMap::ConstPtr m_adjacency_map;
+  Eigen::Isometry3d m_world_to_base = Eigen::Isometry3d::Identity();
 };
 
 // void TRAJOPT_API SetupPlotting(TrajOptProb& prob, Optimizer& opt); TODO: Levi
@@ -86,6 +131,8 @@ struct TRAJOPT_API TrajOptResult
   DblVec cost_vals, cnt_viols;
   TrajArray traj;
   sco::OptStatus status;
+  /** @brief Time spent in each phase, cost and constraint. Empty if the optimizer did not record timing */
+  sco::OptTiming timing;
   TrajOptResult(sco::OptResults& opt, TrajOptProb& prob);
 };
 
@@ -119,6 +166,8 @@ struct InitInfo
     pci.env->getCurrentJointValues)
     JOINT_INTERPOLATED: Linearly interpolates between initial value and the joint position specified in InitInfo.data
     GIVEN_TRAJ: Initializes the matrix to a given trajectory
+    TRAJECTORY_LIBRARY: Seeds from the nearest solved trajectory in InitInfo.library for the initial value and
+    InitInfo.goal, falling back to STATIONARY if the library is empty
 
     In all cases the dt column (if present) is appended the selected method is defined.
  */
@@ -127,11 +176,16 @@ struct InitInfo
     STATIONARY,
     JOINT_INTERPOLATED,
     GIVEN_TRAJ,
+    TRAJECTORY_LIBRARY,
   };
   /** @brief Specifies the type of initialization to use */
   Type type;
   /** @brief Data used during initialization. Use depends on the initialization selected. */
   TrajArray data;
+  /** @brief Library of solved trajectories, used by TRAJECTORY_LIBRARY */
+  TrajectoryLibrary::ConstPtr library;
+  /** @brief Goal features the library is queried with, used by TRAJECTORY_LIBRARY */
+  Eigen::VectorXd goal;
   /** @brief Default value the final column of the optimization is initialized too if time is being used */
   double dt = 1.0;
 };
@@ -173,7 +227,7 @@ protected:
   TermInfo(int supported_term_types) : supported_term_types_(supported_term_types) {}
 
 private:
-  static std::map<std::string, MakerFunc> name2maker;
+  static std::unordered_map<std::string, MakerFunc> name2maker;
   int supported_term_types_;
 };
 
@@ -231,6 +285,8 @@ struct DynamicCartPoseTermInfo : public TermInfo
   Eigen::Isometry3d tcp;
   /** @brief A Static tranform to be applied to target_ location */
   Eigen::Isometry3d target_tcp;
+  /** @brief Quasi-Newton Hessian added to the cost, read from "quasi_newton": "none", "bfgs" or "sr1" */
+  sco::QuasiNewtonType quasi_newton = sco::QN_NONE;
 
   DynamicCartPoseTermInfo();
 
@@ -264,6 +320,8 @@ struct CartPoseTermInfo : public TermInfo
   /** @brief The frame relative to which the target position is defined. If empty, frame is assumed to the root,
    * "world", frame */
   std::string target;
+  /** @brief Quasi-Newton Hessian added to the cost, read from "quasi_newton": "none", "bfgs" or "sr1" */
+  sco::QuasiNewtonType quasi_newton = sco::QN_NONE;
 
   CartPoseTermInfo();
 
@@ -0,0 +1,86 @@
+#pragma once
+#include <trajopt_utils/macros.h>
+TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <Eigen/Core>
+TRAJOPT_IGNORE_WARNINGS_POP
+
+#include <trajopt/problem_description.hpp>
+
+namespace trajopt
+{
+/**
+ * @brief A versioned binary snapshot of a TrajOptProb, e.g. a problem template built offline for worker processes
+ *
+ * The file is in native byte order, each section starts on an 8 byte boundary:
+ *
+ *   header:    magic "TJPSNAP", version, sizes and the offset of each section
+ *   bounds:    n_vars float64 lower bounds followed by n_vars float64 upper bounds
+ *   init_traj: n_steps x n_cols float64, row major
+ *   names:     the var, cost and constraint names, each terminated by '\0'
+ *   request:   the JSON request the problem was constructed from, in the binary request format (json_codec.hpp)
+ *
+ * Opening a snapshot maps the file read only and checks the header, so the bounds and the initial trajectory can be
+ * used without reading or copying the rest of the file. Costs and constraints hold the kinematics, adjacency map and
+ * collision managers of the environment they were built in, so they are not stored as objects. hydrate() rebuilds
+ * the problem from the stored request against a live environment and checks that it matches the snapshot.
+ */
+class TRAJOPT_API ProblemSnapshot
+{
+public:
+  using Ptr = std::shared_ptr<ProblemSnapshot>;
+  static const char MAGIC[8];
+  static const uint32_t VERSION = 1;
+
+  /**
+   * @brief Writes a snapshot of prob, including its current initial trajectory
+   *
+   * The file is written next to path and renamed into place, so readers never see a partial snapshot. Throws if prob
+   * was not constructed from a JSON request or the file can not be written. Targets changed with SetCartPoseTarget or
+   * SetJointPosTargets are not part of the request and are not saved.
+   */
+  static void save(const std::string& path, TrajOptProb& prob);
+
+  /** @brief Maps a snapshot. Throws if the file can not be mapped or has the wrong magic, version or layout. */
+  explicit ProblemSnapshot(const std::string& path);
+  ~ProblemSnapshot();
+  ProblemSnapshot(const ProblemSnapshot&) = delete;
+  ProblemSnapshot& operator=(const ProblemSnapshot&) = delete;
+
+  int numVars() const;
+  int numSteps() const;
+  int numCols() const;
+  bool hasTime() const;
+  /** @brief Views into the mapped file, valid while the snapshot exists */
+  const double* lowerBounds() const;
+  const double* upperBounds() const;
+  Eigen::Map<const TrajArray> initTraj() const;
+
+  std::vector<std::string> varNames() const;
+  std::vector<std::string> costNames() const;
+  std::vector<std::string> cntNames() const;
+  /** @brief Decodes the stored request */
+  Json::Value request() const;
+
+  /**
+   * @brief Constructs the problem from the stored request and sets its initial trajectory and start state
+   *
+   * Throws if the variables, bounds or term names of the constructed problem differ from the snapshot, e.g. because
+   * the environment has a different robot.
+   */
+  TrajOptProb::Ptr hydrate(const tesseract::Tesseract::ConstPtr& tesseract) const;
+
+private:
+  struct Header;
+
+  const Header& header() const;
+  /** @brief Splits the names section into its var, cost and constraint names */
+  std::vector<std::string> names(size_t first, size_t count) const;
+
+  const char* data_;
+  size_t size_;
+};
+}  // namespace trajopt
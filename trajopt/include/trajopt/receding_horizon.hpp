@@ -0,0 +1,52 @@
+#pragma once
+#include <trajopt_utils/macros.h>
+TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <memory>
+#include <Eigen/Core>
+TRAJOPT_IGNORE_WARNINGS_POP
+
+#include <trajopt/problem_description.hpp>
+#include <trajopt_sco/optimizers.hpp>
+
+namespace trajopt
+{
+/**
+ * @brief Re-plans a problem that is constructed once, e.g. in a 10-20 Hz loop with a moving goal
+ *
+ * Each cycle shifts the previous solution by the steps executed since the last cycle, moves the start to the
+ * measured state and optimizes from the shifted trajectory. The problem, its costs and constraints and the QP model
+ * are reused between cycles. Targets are moved in place with TrajOptProb::SetCartPoseTarget and
+ * TrajOptProb::SetJointPosTargets before calling plan().
+ *
+ * The work per cycle is capped by max_iter and max_time of the parameters. A cycle that hits a cap still returns the
+ * best trajectory found, which the next cycle continues from.
+ */
+class TRAJOPT_API RecedingHorizonPlanner
+{
+public:
+  using Ptr = std::shared_ptr<RecedingHorizonPlanner>;
+
+  RecedingHorizonPlanner(TrajOptProb::Ptr prob, const sco::BasicTrustRegionSQPParameters& params);
+
+  /**
+   * @brief Runs one cycle
+   * @param start The measured joint values of the first time step (without the dt column)
+   * @param n_shift The number of time steps executed since the last cycle. The first cycle starts from the initial
+   * trajectory of the problem and ignores it.
+   */
+  TrajOptResult::Ptr plan(const Eigen::VectorXd& start, int n_shift = 1);
+
+  TrajOptProb::Ptr getProblem() const { return prob_; }
+  /** @brief The parameters each cycle starts with */
+  sco::BasicTrustRegionSQPParameters& getParameters() { return params_; }
+  /** @brief The optimizer results of the last cycle */
+  const sco::OptResults& getOptResults() { return opt_.results(); }
+
+private:
+  TrajOptProb::Ptr prob_;
+  sco::BasicTrustRegionSQP opt_;
+  sco::BasicTrustRegionSQPParameters params_;
+  /** @brief True once a cycle has run, so there is a solution to shift */
+  bool has_solution_;
+};
+}  // namespace trajopt
@@ -24,8 +24,16 @@ public:
   /** @brief Numerically evaluate cost given the vector of values */
   double value(const DblVec&) override;
   sco::VarVector getVars() override { return vars_.flatten(); }
+  /** @brief coeffs * (pos - targets)^2 is quadratic in the variables */
+  bool isConvex() override { return true; }
+
+  /** @brief Change the targets in place, e.g. to re-plan without constructing a new problem */
+  void setTargets(const Eigen::VectorXd& targets);
 
 private:
+  /** @brief Builds the expressions from the targets */
+  void buildExprs();
+
   /** @brief The variables being optimized. Used to properly index the vector being optimized */
   VarArray vars_;
   /** @brief The coefficients used to weight the cost */
@@ -38,6 +46,8 @@ private:
   int first_step_;
   /** @brief Last time step to which the term is applied */
   int last_step_;
+  /** @brief Views vars_ in the solution vector without copying */
+  TrajArrayView traj_view_;
 };
 
 /**
@@ -60,8 +70,16 @@ public:
   /** @brief Numerically evaluate cost given the vector of values */
   double value(const DblVec&) override;
   sco::VarVector getVars() override { return vars_.flatten(); }
+  /** @brief The soft bounds on the position error are exact in the QP, with one slack per element */
+  bool isConvex() override { return true; }
+
+  /** @brief Change the targets in place, e.g. to re-plan without constructing a new problem */
+  void setTargets(const Eigen::VectorXd& targets);
 
 private:
+  /** @brief Builds the expressions from the targets */
+  void buildExprs();
+
   /** @brief The variables being optimized. Used to properly index the vector being optimized */
   VarArray vars_;
   /** @brief The coefficients used to weight the cost */
@@ -76,7 +94,9 @@ private:
   int first_step_;
   /** @brief Last time step to which the term is applied */
   int last_step_;
-  /** @brief Stores the costs as an expression. Will be length num_jnts*num_timesteps*2 */
+  /** @brief Views vars_ in the solution vector without copying */
+  TrajArrayView traj_view_;
+  /** @brief Stores the differenced (and target offset) terms. Will be length num_jnts*num_timesteps */
   std::vector<sco::AffExpr> expr_vec_;
 };
 
@@ -96,7 +116,13 @@ public:
 
   sco::VarVector getVars() override { return vars_.flatten(); }
 
+  /** @brief Change the targets in place, e.g. to re-plan without constructing a new problem */
+  void setTargets(const Eigen::VectorXd& targets);
+
 private:
+  /** @brief Builds the expressions from the targets */
+  void buildExprs();
+
   /** @brief The variables being optimized. Used to properly index the vector being optimized */
   VarArray vars_;
   /** @brief The coefficients used to weight the cost */
@@ -109,6 +135,8 @@ private:
   int first_step_;
   /** @brief Last time step to which the term is applied */
   int last_step_;
+  /** @brief Views vars_ in the solution vector without copying */
+  TrajArrayView traj_view_;
 };
 
 class TRAJOPT_API JointPosIneqConstraint : public sco::IneqConstraint
@@ -128,7 +156,13 @@ public:
   DblVec value(const DblVec&) override;
   sco::VarVector getVars() override { return vars_.flatten(); }
 
+  /** @brief Change the targets in place, e.g. to re-plan without constructing a new problem */
+  void setTargets(const Eigen::VectorXd& targets);
+
 private:
+  /** @brief Builds the expressions from the targets */
+  void buildExprs();
+
   /** @brief The variables being optimized. Used to properly index the vector being optimized */
   VarArray vars_;
   /** @brief The coefficients used to weight the cost */
@@ -143,6 +177,8 @@ private:
   int first_step_;
   /** @brief Last time step to which the term is applied */
   int last_step_;
+  /** @brief Views vars_ in the solution vector without copying */
+  TrajArrayView traj_view_;
   /** @brief Stores the costs as an expression. Will be length num_jnts*num_timesteps*2 */
   std::vector<sco::AffExpr> expr_vec_;
 };
@@ -161,6 +197,8 @@ public:
   /** @brief Numerically evaluate cost given the vector of values using Eigen*/
   double value(const DblVec&) override;
   sco::VarVector getVars() override { return vars_.flatten(); }
+  /** @brief coeffs * (vel - targets)^2 is quadratic in the finite differences of the variables */
+  bool isConvex() override { return true; }
 
 private:
   /** @brief The variables being optimized. Used to properly index the vector being optimized */
@@ -175,6 +213,8 @@ private:
   int first_step_;
   /** @brief Last time step to which the term is applied */
   int last_step_;
+  /** @brief Views vars_ in the solution vector without copying */
+  TrajArrayView traj_view_;
 };
 
 class TRAJOPT_API JointVelIneqCost : public sco::Cost
@@ -193,6 +233,8 @@ public:
   /** @brief Numerically evaluate cost given the vector of values */
   double value(const DblVec&) override;
   sco::VarVector getVars() override { return vars_.flatten(); }
+  /** @brief The soft bounds on the velocity error are exact in the QP, with one slack per element */
+  bool isConvex() override { return true; }
 
 private:
   /** @brief The variables being optimized. Used to properly index the vector being optimized */
@@ -209,7 +251,9 @@ private:
   int first_step_;
   /** @brief Last time step to which the term is applied */
   int last_step_;
-  /** @brief Stores the costs as an expression. Will be length num_jnts*num_timesteps*2 */
+  /** @brief Views vars_ in the solution vector without copying */
+  TrajArrayView traj_view_;
+  /** @brief Stores the differenced (and target offset) terms. Will be length num_jnts*num_timesteps */
   std::vector<sco::AffExpr> expr_vec_;
 };
 
@@ -242,6 +286,8 @@ private:
   int first_step_;
   /** @brief Last time step to which the term is applied */
   int last_step_;
+  /** @brief Views vars_ in the solution vector without copying */
+  TrajArrayView traj_view_;
 };
 
 class TRAJOPT_API JointVelIneqConstraint : public sco::IneqConstraint
@@ -276,6 +322,8 @@ private:
   int first_step_;
   /** @brief Last time step to which the term is applied */
   int last_step_;
+  /** @brief Views vars_ in the solution vector without copying */
+  TrajArrayView traj_view_;
   /** @brief Stores the costs as an expression. Will be length num_jnts*(num_timesteps-1)*2 */
   std::vector<sco::AffExpr> expr_vec_;
 };
@@ -294,6 +342,8 @@ public:
   /** @brief Numerically evaluate cost given the vector of values */
   double value(const DblVec&) override;
   sco::VarVector getVars() override { return vars_.flatten(); }
+  /** @brief coeffs * (acc - targets)^2 is quadratic in the finite differences of the variables */
+  bool isConvex() override { return true; }
 
 private:
   /** @brief The variables being optimized. Used to properly index the vector being optimized */
@@ -308,6 +358,8 @@ private:
   int first_step_;
   /** @brief Last time step to which the term is applied */
   int last_step_;
+  /** @brief Views vars_ in the solution vector without copying */
+  TrajArrayView traj_view_;
 };
 
 class TRAJOPT_API JointAccIneqCost : public sco::Cost
@@ -326,6 +378,8 @@ public:
   /** @brief Numerically evaluate cost given the vector of values */
   double value(const DblVec&) override;
   sco::VarVector getVars() override { return vars_.flatten(); }
+  /** @brief The soft bounds on the acceleration error are exact in the QP, with one slack per element */
+  bool isConvex() override { return true; }
 
 private:
   /** @brief The variables being optimized. Used to properly index the vector being optimized */
@@ -342,7 +396,9 @@ private:
   int first_step_;
   /** @brief Last time step to which the term is applied */
   int last_step_;
-  /** @brief Stores the costs as an expression. Will be length num_jnts*(num_timesteps-2)*2 */
+  /** @brief Views vars_ in the solution vector without copying */
+  TrajArrayView traj_view_;
+  /** @brief Stores the differenced (and target offset) terms. Will be length num_jnts*(num_timesteps-2) */
   std::vector<sco::AffExpr> expr_vec_;
 };
 
@@ -375,6 +431,8 @@ private:
   int first_step_;
   /** @brief Last time step to which the term is applied */
   int last_step_;
+  /** @brief Views vars_ in the solution vector without copying */
+  TrajArrayView traj_view_;
 };
 
 class TRAJOPT_API JointAccIneqConstraint : public sco::IneqConstraint
@@ -409,6 +467,8 @@ private:
   int first_step_;
   /** @brief Last time step to which the term is applied */
   int last_step_;
+  /** @brief Views vars_ in the solution vector without copying */
+  TrajArrayView traj_view_;
   /** @brief Stores the costs as an expression. Will be length num_jnts*(num_timesteps-2)*2 */
   std::vector<sco::AffExpr> expr_vec_;
 };
@@ -427,6 +487,8 @@ public:
   /** @brief Numerically evaluate cost given the vector of values */
   double value(const DblVec&) override;
   sco::VarVector getVars() override { return vars_.flatten(); }
+  /** @brief coeffs * (jerk - targets)^2 is quadratic in the finite differences of the variables */
+  bool isConvex() override { return true; }
 
 private:
   /** @brief The variables being optimized. Used to properly index the vector being optimized */
@@ -441,6 +503,8 @@ private:
   int first_step_;
   /** @brief Last time step to which the term is applied */
   int last_step_;
+  /** @brief Views vars_ in the solution vector without copying */
+  TrajArrayView traj_view_;
 };
 
 class TRAJOPT_API JointJerkIneqCost : public sco::Cost
@@ -459,6 +523,8 @@ public:
   /** @brief Numerically evaluate cost given the vector of values */
   double value(const DblVec&) override;
   sco::VarVector getVars() override { return vars_.flatten(); }
+  /** @brief The soft bounds on the jerk error are exact in the QP, with one slack per element */
+  bool isConvex() override { return true; }
 
 private:
   /** @brief The variables being optimized. Used to properly index the vector being optimized */
@@ -475,7 +541,9 @@ private:
   int first_step_;
   /** @brief Last time step to which the term is applied */
   int last_step_;
-  /** @brief Stores the costs as an expression. Will be length num_jnts*(num_timesteps-4)*2 */
+  /** @brief Views vars_ in the solution vector without copying */
+  TrajArrayView traj_view_;
+  /** @brief Stores the differenced (and target offset) terms. Will be length num_jnts*(num_timesteps-4) */
   std::vector<sco::AffExpr> expr_vec_;
 };
 
@@ -508,6 +576,8 @@ private:
   int first_step_;
   /** @brief Last time step to which the term is applied */
   int last_step_;
+  /** @brief Views vars_ in the solution vector without copying */
+  TrajArrayView traj_view_;
 };
 
 class TRAJOPT_API JointJerkIneqConstraint : public sco::IneqConstraint
@@ -542,6 +612,8 @@ private:
   int first_step_;
   /** @brief Last time step to which the term is applied */
   int last_step_;
+  /** @brief Views vars_ in the solution vector without copying */
+  TrajArrayView traj_view_;
   /** @brief Stores the costs as an expression. Will be length num_jnts*(num_timesteps-4)*2 */
   std::vector<sco::AffExpr> expr_vec_;
 };
@@ -0,0 +1,120 @@
+#pragma once
+#include <trajopt_utils/macros.h>
+TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <string>
+#include <vector>
+#include <Eigen/Core>
+TRAJOPT_IGNORE_WARNINGS_POP
+
+#include <trajopt/typedefs.hpp>
+
+namespace trajopt
+{
+/**
+ * @brief A persistent library of solved trajectories for seeding recurring problems
+ *
+ * Each entry is keyed by the start state and a goal feature vector chosen by the user (e.g. a target position, or the
+ * goal joint values). Queries return the entries whose concatenated key is nearest in the Euclidean norm, so the goal
+ * features should be scaled to be comparable to joint values. All entries have the same key size and trajectory
+ * shape, which are fixed by the first entry.
+ *
+ * Nearest neighbour queries use a KD-tree stored as a permutation of the entries: the median of each range [lo, hi)
+ * sits at (lo + hi) / 2 and the two halves are the subtrees. Entries added after the tree was built are scanned
+ * linearly until they outnumber the entries in the tree (and 32), then the tree is rebuilt. The file written by
+ * save() holds the keys, trajectories and tree in native byte order, each section starting on an 8 byte boundary:
+ *
+ *   header:  magic "TJTRLIB", version, sizes and the offset of each section
+ *   keys:    n_entries x key_size float64
+ *   trajs:   n_entries x n_steps x n_cols float64, each trajectory row major
+ *   tree:    n_entries uint64 entry indices followed by n_entries uint64 split dimensions, over all entries
+ *
+ * A loaded library maps the file read only and answers queries from the mapping without reading the rest of it. Adding
+ * an entry to a loaded library first copies it into memory.
+ */
+class TRAJOPT_API TrajectoryLibrary
+{
+public:
+  using Ptr = std::shared_ptr<TrajectoryLibrary>;
+  using ConstPtr = std::shared_ptr<const TrajectoryLibrary>;
+  static const char MAGIC[8];
+  static const uint32_t VERSION = 1;
+
+  TrajectoryLibrary() = default;
+  /** @brief Maps a library. Throws if the file can not be mapped or has the wrong magic, version or layout. */
+  explicit TrajectoryLibrary(const std::string& path);
+  ~TrajectoryLibrary();
+  TrajectoryLibrary(const TrajectoryLibrary&) = delete;
+  TrajectoryLibrary& operator=(const TrajectoryLibrary&) = delete;
+
+  /**
+   * @brief Adds a solved trajectory
+   * @param start The joint values of the first time step
+   * @param goal The goal features
+   * @param traj The joint values of the trajectory, without the dt column. Throws if the key size or trajectory shape
+   * differs from the first entry.
+   */
+  void add(const Eigen::VectorXd& start, const Eigen::VectorXd& goal, const TrajArray& traj);
+
+  /** @brief Writes the library, replacing path atomically. Throws if the file can not be written. */
+  void save(const std::string& path) const;
+
+  /** @brief Indices of the k entries nearest to (start, goal), nearest first */
+  std::vector<size_t> query(const Eigen::VectorXd& start, const Eigen::VectorXd& goal, size_t k) const;
+
+  size_t size() const { return n_entries_; }
+  bool empty() const { return n_entries_ == 0; }
+  int numSteps() const { return static_cast<int>(n_steps_); }
+  int numCols() const { return static_cast<int>(n_cols_); }
+  Eigen::Map<const Eigen::VectorXd> key(size_t i) const;
+  Eigen::Map<const TrajArray> traj(size_t i) const;
+
+  /**
+   * @brief Seeds a problem starting at start from the trajectory of the nearest entry
+   *
+   * The difference between start and the start of the entry is added to the trajectory, fading out linearly towards
+   * its last step, so the seed starts at start and ends where the stored solution did. Throws if the library is empty.
+   */
+  TrajArray seed(const Eigen::VectorXd& start, const Eigen::VectorXd& goal) const;
+
+private:
+  struct Header;
+
+  /** @brief Concatenates start and goal, checking the key size */
+  Eigen::VectorXd makeKey(const Eigen::VectorXd& start, const Eigen::VectorXd& goal) const;
+  /** @brief Builds the KD-tree over all entries */
+  void buildTree();
+  void buildTree(size_t lo, size_t hi);
+  /** @brief Adds the entries of the subtree [lo, hi) nearer than the k-th nearest found so far to nearest */
+  void searchTree(const Eigen::VectorXd& key,
+                  size_t k,
+                  size_t lo,
+                  size_t hi,
+                  std::vector<std::pair<double, size_t>>& nearest) const;
+  /** @brief Copies a mapped library into memory so it can be changed */
+  void unmap();
+  /** @brief The sections, in the mapped file or in memory */
+  const double* keys() const;
+  const double* trajs() const;
+  const uint64_t* treeOrder() const;
+  const uint64_t* treeSplit() const;
+
+  size_t n_entries_{ 0 };
+  size_t key_size_{ 0 };
+  size_t n_steps_{ 0 };
+  size_t n_cols_{ 0 };
+
+  /** @brief Entries in memory, empty while the library is mapped */
+  DblVec keys_;
+  DblVec trajs_;
+  /** @brief The KD-tree over the first tree_size_ entries, indices then split dimensions as in the file */
+  std::vector<uint64_t> tree_order_;
+  size_t tree_size_{ 0 };
+
+  /** @brief The mapped file, null if the library is in memory */
+  const char* data_{ nullptr };
+  size_t size_{ 0 };
+};
+}  // namespace trajopt
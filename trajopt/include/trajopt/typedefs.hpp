@@ -30,6 +30,9 @@ using AlignedUnorderedMap = std::unordered_map<Key,
                                                std::equal_to<Key>,
                                                Eigen::aligned_allocator<std::pair<const Key, Value>>>;
 
+template <typename T>
+using AlignedVector = std::vector<T, Eigen::aligned_allocator<T>>;
+
 /** @brief Interface for objects that know how to plot themselves given solution
  * vector x */
 class Plotter
@@ -73,6 +76,17 @@ public:
   {
   }
 
+  /// supply error function and sparse gradient
+  TrajOptCostFromErrFunc(sco::VectorOfVector::Ptr f,
+                         sco::SparseMatrixOfVector::Ptr dfdx,
+                         const sco::VarVector& vars,
+                         const Eigen::VectorXd& coeffs,
+                         sco::PenaltyType pen_type,
+                         const std::string& name)
+    : CostFromErrFunc(f, dfdx, vars, coeffs, pen_type, name)
+  {
+  }
+
   void Plot(const tesseract_visualization::Visualization::Ptr& plotter, const DblVec& x) override
   {
     // If error function has a inherited from TrajOptVectorOfVector, call its Plot function
@@ -109,6 +123,17 @@ public:
   {
   }
 
+  /// supply error function and sparse gradient
+  TrajOptConstraintFromErrFunc(sco::VectorOfVector::Ptr f,
+                               sco::SparseMatrixOfVector::Ptr dfdx,
+                               const sco::VarVector& vars,
+                               const Eigen::VectorXd& coeffs,
+                               sco::ConstraintType type,
+                               const std::string& name)
+    : ConstraintFromErrFunc(f, dfdx, vars, coeffs, type, name)
+  {
+  }
+
   void Plot(const tesseract_visualization::Visualization::Ptr& plotter, const DblVec& x) override
   {
     // If error function has a inherited from TrajOptVectorOfVector, call its Plot function
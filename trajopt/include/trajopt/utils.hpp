@@ -15,6 +15,47 @@ Extract trajectory array from solution vector x using indices in array vars
 TrajArray TRAJOPT_API getTraj(const DblVec& x, const VarArray& vars);
 TrajArray TRAJOPT_API getTraj(const DblVec& x, const AffArray& arr);
 
+/**
+ * @brief Shifts a trajectory n_shift steps forward in time, e.g. to warm start the next cycle of a receding horizon
+ *
+ * Row i of the result is row i + n_shift of traj, the rows past the end repeat the last row of traj.
+ */
+TrajArray TRAJOPT_API shiftTraj(const TrajArray& traj, int n_shift);
+
+/** @brief Read-only row-major view of a trajectory with an arbitrary row stride */
+using TrajArrayMap = Eigen::Map<const TrajArray, Eigen::Unaligned, Eigen::OuterStride<>>;
+
+/**
+ * @brief Views the values of a VarArray directly in the solution vector without copying
+ *
+ * The layout is analysed once on construction. Variables created by AddVarArray(s) are stored row-major with a
+ * constant row stride (n_dof, or n_dof + 1 when time is a variable), in which case map() returns an Eigen::Map over
+ * the solution vector itself. Any other layout falls back to gathering the values into a buffer owned by the caller,
+ * so a view can be shared by threads evaluating the same term.
+ */
+class TRAJOPT_API TrajArrayView
+{
+public:
+  TrajArrayView() = default;
+  explicit TrajArrayView(const VarArray& vars);
+
+  /**
+   * @brief Returns a view of the trajectory stored in x
+   * @param buffer Receives the values if the variables are not strided. The view is only valid while x, buffer and
+   * this object are alive.
+   */
+  TrajArrayMap map(const DblVec& x, TrajArray& buffer) const;
+
+  /** @brief True if map() does not need to copy */
+  bool isStrided() const { return strided_; }
+
+private:
+  VarArray vars_;
+  bool strided_{ false };
+  Eigen::Index offset_{ 0 };
+  Eigen::Index row_stride_{ 0 };
+};
+
 inline DblVec trajToDblVec(const TrajArray& x) { return DblVec(x.data(), x.data() + x.rows() * x.cols()); }
 inline Eigen::VectorXd concat(const Eigen::VectorXd& a, const Eigen::VectorXd& b)
 {
@@ -191,6 +232,25 @@ inline Eigen::VectorXd calcTransformError(const Eigen::Isometry3d& t1, const Eig
   return concat(pose_err.translation(), calcRotationalError(pose_err.rotation()));
 }
 
+/**
+ * @brief Calculate the rotation error vectors of a batch of rotation error matrices
+ *
+ * Gives the same result as calcRotationalError applied to each column. It is computed with a branch-free quaternion
+ * logarithm on a structure-of-arrays layout so the arithmetic vectorizes across the batch.
+ * @param R 9 x N, each column holds a rotation matrix in column-major order
+ * @return 3 x N rotation error vectors = axis * angle with angle on [0, pi]
+ */
+Eigen::Matrix3Xd TRAJOPT_API calcRotationalErrors(const Eigen::Ref<const Eigen::Matrix<double, 9, Eigen::Dynamic>>& R);
+
+/**
+ * @brief Calculate the error between a target transform and a batch of transforms expressed in t1 coordinate system
+ * @param t1 Target Transform
+ * @param t2 Current Transforms
+ * @return 6 x N errors, each column [Position, Rotational(Angle Axis)] as returned by calcTransformError
+ */
+Eigen::Matrix<double, 6, Eigen::Dynamic> TRAJOPT_API calcTransformErrors(const Eigen::Isometry3d& t1,
+                                                                         const AlignedVector<Eigen::Isometry3d>& t2);
+
 /**
  * @brief Apply a twist for dt to a given transform
  * @param t1 The transform to apply twist.
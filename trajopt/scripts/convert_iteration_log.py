@@ -0,0 +1,119 @@
+'''
+Converts the binary iteration log written by BasicTrustRegionSQP (trajopt_iterations.bin) to the CSV files
+trajopt_solver.log, trajopt_vars.log, trajopt_costs.log and trajopt_constraints.log that plot_optimization.py and
+other tools read. See trajopt_sco/iteration_log.hpp for the file format.
+
+Usage:
+python convert_iteration_log.py <trajopt_iterations.bin> [output directory]
+
+'''
+
+import argparse
+import os
+import struct
+import sys
+
+MAGIC = b'SCOITLOG'
+VERSION = 2
+RECORD_HEADER_SIZE = 5
+
+
+def read_names(f, count):
+    names = []
+    for _ in range(count):
+        (length,) = struct.unpack('=I', f.read(4))
+        names.append(f.read(length).decode('utf-8'))
+    return names
+
+
+def read_log(path):
+    with open(path, 'rb') as f:
+        if f.read(8) != MAGIC:
+            raise ValueError('%s is not a trajopt iteration log' % path)
+        version, n_vars, n_costs, n_cnts = struct.unpack('=IIII', f.read(16))
+        if version != VERSION:
+            raise ValueError('unsupported iteration log version %d' % version)
+        var_names = read_names(f, n_vars)
+        cost_names = read_names(f, n_costs)
+        cnt_names = read_names(f, n_cnts)
+
+        record_size = RECORD_HEADER_SIZE + n_vars + 3 * n_costs + 4 * n_cnts
+        record_format = '=%dd' % record_size
+        record_bytes = struct.calcsize(record_format)
+        records = []
+        while True:
+            data = f.read(record_bytes)
+            if len(data) < record_bytes:
+                break
+            records.append(struct.unpack(record_format, data))
+
+    return var_names, cost_names, cnt_names, records
+
+
+def split(values, sizes):
+    out = []
+    start = 0
+    for size in sizes:
+        out.append(values[start:start + size])
+        start += size
+    return out
+
+
+def improvement_columns(old, model, new, scales):
+    columns = []
+    for i in range(len(old)):
+        scale = scales[i]
+        approx_improve = old[i] - model[i]
+        exact_improve = old[i] - new[i]
+        if abs(approx_improve) > 1e-8:
+            ratio = '%e' % (exact_improve / approx_improve)
+        else:
+            ratio = 'nan'
+        columns.append(',%e,%e,%e,%s' % (scale * old[i], scale * approx_improve, scale * exact_improve, ratio))
+    return ''.join(columns)
+
+
+def write_csv(var_names, cost_names, cnt_names, records, out_dir):
+    n_vars, n_costs, n_cnts = len(var_names), len(cost_names), len(cnt_names)
+    solver = open(os.path.join(out_dir, 'trajopt_solver.log'), 'w')
+    variables = open(os.path.join(out_dir, 'trajopt_vars.log'), 'w')
+    costs = open(os.path.join(out_dir, 'trajopt_costs.log'), 'w')
+    constraints = open(os.path.join(out_dir, 'trajopt_constraints.log'), 'w')
+
+    solver.write('DESCRIPTION,oldexact,dapprox,dexact,ratio\n')
+    variables.write('NAMES' + ''.join(',' + name for name in var_names) + '\n')
+    costs.write('COST NAMES' + ''.join((',' + name) * 4 for name in cost_names) + '\n')
+    costs.write('DESCRIPTION' + ',oldexact,dapprox,dexact,ratio' * n_costs + '\n')
+    constraints.write('CONSTRAINT NAMES' + ''.join((',' + name) * 4 for name in cnt_names) + '\n')
+    constraints.write('DESCRIPTION' + ',oldexact,dapprox,dexact,ratio' * n_cnts + '\n')
+
+    for record in records:
+        old_merit, model_merit, new_merit, merit_improve_ratio, merit_error_coeff = record[:RECORD_HEADER_SIZE]
+        x, old_costs, model_costs, new_costs, old_cnts, model_cnts, new_cnts, cnt_coeffs = split(
+            record[RECORD_HEADER_SIZE:], [n_vars, n_costs, n_costs, n_costs, n_cnts, n_cnts, n_cnts, n_cnts])
+
+        solver.write('%s,%10.3e,%10.3e,%10.3e,%10.3e\n' %
+                     ('Solver', old_merit, old_merit - model_merit, old_merit - new_merit, merit_improve_ratio))
+        variables.write('VALUES' + ''.join(',%e' % value for value in x) + '\n')
+        costs.write('COSTS' + improvement_columns(old_costs, model_costs, new_costs, [1.0] * n_costs) + '\n')
+        constraints.write('CONSTRAINTS' + improvement_columns(old_cnts, model_cnts, new_cnts, cnt_coeffs) + '\n')
+
+    for f in (solver, variables, costs, constraints):
+        f.close()
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Convert a binary trajopt iteration log to CSV')
+    parser.add_argument('log', type=str, help='Binary iteration log')
+    parser.add_argument('out_dir', type=str, nargs='?', help='Output directory (default: directory of the log)')
+    args = parser.parse_args()
+
+    out_dir = args.out_dir if args.out_dir else os.path.dirname(os.path.abspath(args.log))
+    var_names, cost_names, cnt_names, records = read_log(args.log)
+    write_csv(var_names, cost_names, cnt_names, records, out_dir)
+    print('converted %d records to %s' % (len(records), out_dir))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
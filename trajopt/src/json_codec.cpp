@@ -0,0 +1,706 @@
+#include <trajopt_utils/macros.h>
+TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <algorithm>
+#include <boost/format.hpp>
+#include <clocale>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <sstream>
+TRAJOPT_IGNORE_WARNINGS_POP
+
+#include <trajopt/json_codec.hpp>
+
+namespace json_marshal
+{
+namespace
+{
+const char BINARY_MAGIC[4] = { 'T', 'J', 'B', '1' };
+
+/** @brief Deeper documents are rejected instead of overflowing the stack */
+const int MAX_DEPTH = 256;
+
+enum BinaryTag : uint8_t
+{
+  TAG_NULL = 0,
+  TAG_FALSE = 1,
+  TAG_TRUE = 2,
+  TAG_INT = 3,
+  TAG_UINT = 4,
+  TAG_DOUBLE = 5,
+  TAG_STRING = 6,
+  TAG_ARRAY = 7,
+  TAG_OBJECT = 8,
+  TAG_DOUBLE_ARRAY = 9
+};
+
+void appendUTF8(std::string& out, unsigned int cp)
+{
+  if (cp <= 0x7F)
+  {
+    out += static_cast<char>(cp);
+  }
+  else if (cp <= 0x7FF)
+  {
+    out += static_cast<char>(0xC0 | (cp >> 6));
+    out += static_cast<char>(0x80 | (cp & 0x3F));
+  }
+  else if (cp <= 0xFFFF)
+  {
+    out += static_cast<char>(0xE0 | (cp >> 12));
+    out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+    out += static_cast<char>(0x80 | (cp & 0x3F));
+  }
+  else
+  {
+    out += static_cast<char>(0xF0 | (cp >> 18));
+    out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+    out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+    out += static_cast<char>(0x80 | (cp & 0x3F));
+  }
+}
+
+class JsonParser
+{
+public:
+  JsonParser(const char* data, size_t size) : begin_(data), cur_(data), end_(data + size) {}
+
+  Json::Value parse()
+  {
+    Json::Value root;
+    skipSpace();
+    parseValue(root, 0);
+    skipSpace(true);
+    if (cur_ != end_)
+      fail("unexpected data after the document");
+    return root;
+  }
+
+private:
+  const char* begin_;
+  const char* cur_;
+  const char* end_;
+  /** @brief Reused for member names, which are copied into the object before the member value is parsed */
+  std::string key_;
+
+  void fail(const char* what) const
+  {
+    PRINT_AND_THROW(boost::format("failed to parse json at offset %i: %s") % (cur_ - begin_) % what);
+  }
+
+  /** @brief Skips whitespace and comments. Json::Reader ignores an unterminated comment after the document. */
+  void skipSpace(bool allow_unterminated = false)
+  {
+    while (cur_ != end_)
+    {
+      char c = *cur_;
+      if (c == ' ' || c == '\t' || c == '\n' || c == '\r')
+      {
+        ++cur_;
+      }
+      else if (c == '/' && cur_ + 1 != end_ && cur_[1] == '/')
+      {
+        while (cur_ != end_ && *cur_ != '\n')
+          ++cur_;
+      }
+      else if (c == '/' && cur_ + 1 != end_ && cur_[1] == '*')
+      {
+        cur_ += 2;
+        while (cur_ + 1 < end_ && !(cur_[0] == '*' && cur_[1] == '/'))
+          ++cur_;
+        if (cur_ + 1 >= end_)
+        {
+          if (!allow_unterminated)
+            fail("unterminated comment");
+          cur_ = end_;
+          return;
+        }
+        cur_ += 2;
+      }
+      else
+      {
+        break;
+      }
+    }
+  }
+
+  void expect(char c, const char* what)
+  {
+    if (cur_ == end_ || *cur_ != c)
+      fail(what);
+    ++cur_;
+  }
+
+  void parseValue(Json::Value& out, int depth)
+  {
+    if (depth > MAX_DEPTH)
+      fail("document is nested too deeply");
+    if (cur_ == end_)
+      fail("unexpected end of document");
+
+    switch (*cur_)
+    {
+      case '{':
+        parseObject(out, depth);
+        break;
+      case '[':
+        parseArray(out, depth);
+        break;
+      case '"':
+        parseString(out);
+        break;
+      case 't':
+        parseLiteral("true");
+        out = Json::Value(true);
+        break;
+      case 'f':
+        parseLiteral("false");
+        out = Json::Value(false);
+        break;
+      case 'n':
+        parseLiteral("null");
+        out = Json::Value();
+        break;
+      default:
+        parseNumber(out);
+    }
+  }
+
+  void parseObject(Json::Value& out, int depth)
+  {
+    ++cur_;
+    out = Json::Value(Json::objectValue);
+    skipSpace();
+    if (cur_ != end_ && *cur_ == '}')
+    {
+      ++cur_;
+      return;
+    }
+
+    for (;;)
+    {
+      skipSpace();
+      if (cur_ == end_ || *cur_ != '"')
+        fail("expected a member name");
+      key_.clear();
+      readString(key_);
+      skipSpace();
+      expect(':', "expected ':' after a member name");
+      skipSpace();
+      parseValue(out[key_], depth + 1);
+      skipSpace();
+      if (cur_ != end_ && *cur_ == ',')
+      {
+        ++cur_;
+        continue;
+      }
+      expect('}', "expected ',' or '}' in an object");
+      return;
+    }
+  }
+
+  void parseArray(Json::Value& out, int depth)
+  {
+    ++cur_;
+    out = Json::Value(Json::arrayValue);
+    skipSpace();
+    if (cur_ != end_ && *cur_ == ']')
+    {
+      ++cur_;
+      return;
+    }
+
+    for (;;)
+    {
+      skipSpace();
+      parseValue(out.append(Json::Value()), depth + 1);
+      skipSpace();
+      if (cur_ != end_ && *cur_ == ',')
+      {
+        ++cur_;
+        continue;
+      }
+      expect(']', "expected ',' or ']' in an array");
+      return;
+    }
+  }
+
+  void parseString(Json::Value& out)
+  {
+    // Most strings have no escapes and are copied straight from the buffer
+    const char* start = cur_ + 1;
+    const char* it = start;
+    while (it != end_ && *it != '"' && *it != '\\')
+      ++it;
+    if (it != end_ && *it == '"')
+    {
+      out = Json::Value(start, it);
+      cur_ = it + 1;
+      return;
+    }
+
+    std::string s;
+    readString(s);
+    out = Json::Value(s);
+  }
+
+  /** @brief Reads the string starting at the opening quote and appends it to s */
+  void readString(std::string& s)
+  {
+    ++cur_;
+    for (;;)
+    {
+      const char* start = cur_;
+      while (cur_ != end_ && *cur_ != '"' && *cur_ != '\\')
+        ++cur_;
+      s.append(start, cur_);
+      if (cur_ == end_)
+        fail("unterminated string");
+      if (*cur_ == '"')
+      {
+        ++cur_;
+        return;
+      }
+
+      ++cur_;
+      if (cur_ == end_)
+        fail("unterminated string");
+      char c = *cur_++;
+      switch (c)
+      {
+        case '"':
+        case '\\':
+        case '/':
+          s += c;
+          break;
+        case 'b':
+          s += '\b';
+          break;
+        case 'f':
+          s += '\f';
+          break;
+        case 'n':
+          s += '\n';
+          break;
+        case 'r':
+          s += '\r';
+          break;
+        case 't':
+          s += '\t';
+          break;
+        case 'u':
+          appendUTF8(s, readCodePoint());
+          break;
+        default:
+          fail("invalid escape sequence in string");
+      }
+    }
+  }
+
+  unsigned int readHex4()
+  {
+    if (end_ - cur_ < 4)
+      fail("truncated \\u escape in string");
+    unsigned int value = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+      char c = *cur_++;
+      value <<= 4;
+      if (c >= '0' && c <= '9')
+        value += static_cast<unsigned int>(c - '0');
+      else if (c >= 'a' && c <= 'f')
+        value += static_cast<unsigned int>(c - 'a' + 10);
+      else if (c >= 'A' && c <= 'F')
+        value += static_cast<unsigned int>(c - 'A' + 10);
+      else
+        fail("invalid \\u escape in string");
+    }
+    return value;
+  }
+
+  unsigned int readCodePoint()
+  {
+    unsigned int cp = readHex4();
+    if (cp >= 0xD800 && cp <= 0xDBFF)
+    {
+      // Surrogate pair
+      if (end_ - cur_ < 2 || cur_[0] != '\\' || cur_[1] != 'u')
+        fail("expected a low surrogate in string");
+      cur_ += 2;
+      unsigned int low = readHex4();
+      if (low < 0xDC00 || low > 0xDFFF)
+        fail("invalid low surrogate in string");
+      cp = 0x10000 + ((cp & 0x3FF) << 10) + (low & 0x3FF);
+    }
+    return cp;
+  }
+
+  void parseLiteral(const char* literal)
+  {
+    size_t n = std::strlen(literal);
+    if (static_cast<size_t>(end_ - cur_) < n || std::strncmp(cur_, literal, n) != 0)
+      fail("invalid literal");
+    cur_ += n;
+  }
+
+  static bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+  void parseNumber(Json::Value& out)
+  {
+    const char* start = cur_;
+    bool negative = false;
+    if (*cur_ == '-')
+    {
+      negative = true;
+      ++cur_;
+    }
+    else if (!isDigit(*cur_))
+    {
+      fail("invalid value");
+    }
+
+    // Integers are accumulated directly, falling back to a double if they overflow. Like Json::Reader, digits are
+    // optional after the sign and after the decimal point, so "-" is 0 and "1." is 1.0.
+    uint64_t value = 0;
+    bool overflow = false;
+    bool has_digits = false;
+    while (cur_ != end_ && isDigit(*cur_))
+    {
+      auto digit = static_cast<uint64_t>(*cur_ - '0');
+      if (value > (std::numeric_limits<uint64_t>::max() - digit) / 10)
+        overflow = true;
+      value = value * 10 + digit;
+      has_digits = true;
+      ++cur_;
+    }
+
+    bool is_integer = true;
+    if (cur_ != end_ && *cur_ == '.')
+    {
+      is_integer = false;
+      ++cur_;
+      while (cur_ != end_ && isDigit(*cur_))
+      {
+        has_digits = true;
+        ++cur_;
+      }
+    }
+    if (cur_ != end_ && (*cur_ == 'e' || *cur_ == 'E'))
+    {
+      is_integer = false;
+      ++cur_;
+      if (cur_ != end_ && (*cur_ == '+' || *cur_ == '-'))
+        ++cur_;
+      if (cur_ == end_ || !isDigit(*cur_))
+        fail("expected digits in the exponent");
+      while (cur_ != end_ && isDigit(*cur_))
+        ++cur_;
+    }
+    if (!is_integer && !has_digits)
+      fail("expected digits in a number");
+
+    // Same value types as Json::Reader: ints that fit in an int are intValue, larger positive ones uintValue
+    const auto max_negative = static_cast<uint64_t>(std::numeric_limits<Json::LargestInt>::max()) + 1;
+    if (is_integer && !overflow && negative && value <= max_negative)
+    {
+      if (value == max_negative)
+        out = Json::Value(std::numeric_limits<Json::LargestInt>::min());
+      else
+        out = Json::Value(-static_cast<Json::LargestInt>(value));
+    }
+    else if (is_integer && !overflow && !negative)
+    {
+      if (value <= static_cast<uint64_t>(Json::Value::maxInt))
+        out = Json::Value(static_cast<Json::LargestInt>(value));
+      else
+        out = Json::Value(static_cast<Json::LargestUInt>(value));
+    }
+    else
+    {
+      out = Json::Value(parseDouble(start, cur_));
+    }
+  }
+
+  double parseDouble(const char* start, const char* end) const
+  {
+    // strtod needs a terminated string and uses the decimal point of the current locale
+    char small[64];
+    std::string large;
+    auto length = static_cast<size_t>(end - start);
+    char* buffer = small;
+    if (length >= sizeof(small))
+    {
+      large.resize(length + 1);
+      buffer = &large[0];
+    }
+    std::memcpy(buffer, start, length);
+    buffer[length] = '\0';
+
+    char decimal_point = *std::localeconv()->decimal_point;
+    if (decimal_point != '.')
+      std::replace(buffer, buffer + length, '.', decimal_point);
+    double value = std::strtod(buffer, nullptr);
+    if (std::isinf(value))
+      fail("number is out of range");
+    return value;
+  }
+};
+
+class BinaryWriter
+{
+public:
+  explicit BinaryWriter(std::string& out) : out_(out) {}
+
+  void write(const Json::Value& v)
+  {
+    switch (v.type())
+    {
+      case Json::nullValue:
+        putTag(TAG_NULL);
+        break;
+      case Json::booleanValue:
+        putTag(v.asBool() ? TAG_TRUE : TAG_FALSE);
+        break;
+      case Json::intValue:
+        putTag(TAG_INT);
+        put(static_cast<int64_t>(v.asLargestInt()));
+        break;
+      case Json::uintValue:
+        putTag(TAG_UINT);
+        put(static_cast<uint64_t>(v.asLargestUInt()));
+        break;
+      case Json::realValue:
+        putTag(TAG_DOUBLE);
+        put(v.asDouble());
+        break;
+      case Json::stringValue:
+      {
+        const char* begin = nullptr;
+        const char* end = nullptr;
+        v.getString(&begin, &end);
+        putTag(TAG_STRING);
+        putString(begin, end);
+        break;
+      }
+      case Json::arrayValue:
+        writeArray(v);
+        break;
+      case Json::objectValue:
+        putTag(TAG_OBJECT);
+        putSize(v.size());
+        for (Json::ValueConstIterator it = v.begin(); it != v.end(); ++it)
+        {
+          const char* end = nullptr;
+          const char* begin = it.memberName(&end);
+          putString(begin, end);
+          write(*it);
+        }
+        break;
+    }
+  }
+
+private:
+  std::string& out_;
+
+  void putTag(BinaryTag tag) { out_ += static_cast<char>(tag); }
+
+  template <class T>
+  void put(T value)
+  {
+    out_.append(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+
+  void putSize(size_t size)
+  {
+    if (size > std::numeric_limits<uint32_t>::max())
+      PRINT_AND_THROW("json value is too large for the binary request format");
+    put(static_cast<uint32_t>(size));
+  }
+
+  void putString(const char* begin, const char* end)
+  {
+    putSize(static_cast<size_t>(end - begin));
+    out_.append(begin, end);
+  }
+
+  void writeArray(const Json::Value& v)
+  {
+    bool all_doubles = !v.empty();
+    for (Json::ValueConstIterator it = v.begin(); all_doubles && it != v.end(); ++it)
+      all_doubles = (it->type() == Json::realValue);
+
+    if (all_doubles)
+    {
+      putTag(TAG_DOUBLE_ARRAY);
+      putSize(v.size());
+      for (Json::ValueConstIterator it = v.begin(); it != v.end(); ++it)
+        put(it->asDouble());
+    }
+    else
+    {
+      putTag(TAG_ARRAY);
+      putSize(v.size());
+      for (Json::ValueConstIterator it = v.begin(); it != v.end(); ++it)
+        write(*it);
+    }
+  }
+};
+
+class BinaryReader
+{
+public:
+  BinaryReader(const char* data, size_t size) : begin_(data), cur_(data), end_(data + size) {}
+
+  Json::Value read()
+  {
+    need(sizeof(BINARY_MAGIC));
+    if (std::memcmp(cur_, BINARY_MAGIC, sizeof(BINARY_MAGIC)) != 0)
+      fail("not a binary trajopt request");
+    cur_ += sizeof(BINARY_MAGIC);
+
+    Json::Value root;
+    readValue(root, 0);
+    if (cur_ != end_)
+      fail("unexpected data after the request");
+    return root;
+  }
+
+private:
+  const char* begin_;
+  const char* cur_;
+  const char* end_;
+  std::string key_;
+
+  void fail(const char* what) const
+  {
+    PRINT_AND_THROW(boost::format("failed to decode binary request at offset %i: %s") % (cur_ - begin_) % what);
+  }
+
+  size_t remaining() const { return static_cast<size_t>(end_ - cur_); }
+
+  void need(size_t n) const
+  {
+    if (remaining() < n)
+      fail("unexpected end of data");
+  }
+
+  template <class T>
+  T get()
+  {
+    need(sizeof(T));
+    T value;
+    std::memcpy(&value, cur_, sizeof(T));
+    cur_ += sizeof(T);
+    return value;
+  }
+
+  /** @brief Reads a count and checks that the data can hold that many items of at least item_size bytes */
+  Json::ArrayIndex getCount(size_t item_size)
+  {
+    auto count = get<uint32_t>();
+    if (count > remaining() / item_size)
+      fail("count is larger than the data");
+    return count;
+  }
+
+  void readValue(Json::Value& out, int depth)
+  {
+    if (depth > MAX_DEPTH)
+      fail("request is nested too deeply");
+
+    auto tag = get<uint8_t>();
+    switch (tag)
+    {
+      case TAG_NULL:
+        out = Json::Value();
+        break;
+      case TAG_FALSE:
+        out = Json::Value(false);
+        break;
+      case TAG_TRUE:
+        out = Json::Value(true);
+        break;
+      case TAG_INT:
+        out = Json::Value(static_cast<Json::LargestInt>(get<int64_t>()));
+        break;
+      case TAG_UINT:
+        out = Json::Value(static_cast<Json::LargestUInt>(get<uint64_t>()));
+        break;
+      case TAG_DOUBLE:
+        out = Json::Value(get<double>());
+        break;
+      case TAG_STRING:
+      {
+        Json::ArrayIndex length = getCount(1);
+        out = Json::Value(cur_, cur_ + length);
+        cur_ += length;
+        break;
+      }
+      case TAG_ARRAY:
+      {
+        Json::ArrayIndex count = getCount(1);
+        out = Json::Value(Json::arrayValue);
+        out.resize(count);
+        for (Json::ArrayIndex i = 0; i < count; ++i)
+          readValue(out[i], depth + 1);
+        break;
+      }
+      case TAG_DOUBLE_ARRAY:
+      {
+        Json::ArrayIndex count = getCount(sizeof(double));
+        out = Json::Value(Json::arrayValue);
+        out.resize(count);
+        for (Json::ArrayIndex i = 0; i < count; ++i)
+          out[i] = Json::Value(get<double>());
+        break;
+      }
+      case TAG_OBJECT:
+      {
+        Json::ArrayIndex count = getCount(sizeof(uint32_t) + 1);
+        out = Json::Value(Json::objectValue);
+        for (Json::ArrayIndex i = 0; i < count; ++i)
+        {
+          Json::ArrayIndex length = getCount(1);
+          key_.assign(cur_, length);
+          cur_ += length;
+          readValue(out[key_], depth + 1);
+        }
+        break;
+      }
+      default:
+        --cur_;
+        fail("invalid tag");
+    }
+  }
+};
+}  // namespace
+
+Json::Value parseJson(const char* data, size_t size) { return JsonParser(data, size).parse(); }
+
+Json::Value parseJson(const std::string& doc) { return parseJson(doc.data(), doc.size()); }
+
+void toBinary(const Json::Value& v, std::string& out)
+{
+  out.clear();
+  out.append(BINARY_MAGIC, sizeof(BINARY_MAGIC));
+  BinaryWriter(out).write(v);
+}
+
+std::string toBinary(const Json::Value& v)
+{
+  std::string out;
+  toBinary(v, out);
+  return out;
+}
+
+Json::Value fromBinary(const char* data, size_t size) { return BinaryReader(data, size).read(); }
+
+Json::Value fromBinary(const std::string& data) { return fromBinary(data.data(), data.size()); }
+
+bool isBinary(const char* data, size_t size)
+{
+  return size >= sizeof(BINARY_MAGIC) && std::memcmp(data, BINARY_MAGIC, sizeof(BINARY_MAGIC)) == 0;
+}
+}  // namespace json_marshal
@@ -129,14 +129,16 @@ MatrixXd DynamicCartPoseJacCalculator::operator()(const VectorXd& dof_vals) cons
   // The approach below leverages the geometric jacobian and a small step in time to approximate
   // the partial derivative of the error function. Note that the rotational portion is the only part
   // that is required to be modified per the paper.
+  // The rotational errors of the current pose and of each perturbed pose are evaluated as one batch.
   Isometry3d pose_err = target_tf.inverse() * cur_tf;
-  Eigen::Vector3d rot_err = calcRotationalError(pose_err.rotation());
+  Eigen::Matrix<double, 9, Eigen::Dynamic> rotations(9, jac0.cols() + 1);
+  Eigen::Map<Eigen::Matrix3d>(rotations.col(0).data()) = pose_err.rotation();
   for (int c = 0; c < jac0.cols(); ++c)
-  {
-    auto new_pose_err = addTwist(pose_err, jac0.col(c), 1e-5);
-    Eigen::VectorXd new_rot_err = calcRotationalError(new_pose_err.rotation());
-    jac0.col(c).tail(3) = ((new_rot_err - rot_err) / 1e-5);
-  }
+    Eigen::Map<Eigen::Matrix3d>(rotations.col(c + 1).data()) = addTwist(pose_err, jac0.col(c), 1e-5).rotation();
+
+  Eigen::Matrix3Xd rot_errs = calcRotationalErrors(rotations);
+  for (int c = 0; c < jac0.cols(); ++c)
+    jac0.col(c).tail(3) = ((rot_errs.col(c + 1) - rot_errs.col(0)) / 1e-5);
 
   MatrixXd reduced_jac(indices_.size(), n_dof);
   for (int i = 0; i < indices_.size(); ++i)
@@ -203,14 +205,16 @@ MatrixXd CartPoseJacCalculator::operator()(const VectorXd& dof_vals) const
   // The approach below leverages the geometric jacobian and a small step in time to approximate
   // the partial derivative of the error function. Note that the rotational portion is the only part
   // that is required to be modified per the paper.
+  // The rotational errors of the current pose and of each perturbed pose are evaluated as one batch.
   Isometry3d pose_err = pose_inv_ * tf0;
-  Eigen::Vector3d rot_err = calcRotationalError(pose_err.rotation());
+  Eigen::Matrix<double, 9, Eigen::Dynamic> rotations(9, jac0.cols() + 1);
+  Eigen::Map<Eigen::Matrix3d>(rotations.col(0).data()) = pose_err.rotation();
   for (int c = 0; c < jac0.cols(); ++c)
-  {
-    auto new_pose_err = addTwist(pose_err, jac0.col(c), 1e-5);
-    Eigen::VectorXd new_rot_err = calcRotationalError(new_pose_err.rotation());
-    jac0.col(c).tail(3) = ((new_rot_err - rot_err) / 1e-5);
-  }
+    Eigen::Map<Eigen::Matrix3d>(rotations.col(c + 1).data()) = addTwist(pose_err, jac0.col(c), 1e-5).rotation();
+
+  Eigen::Matrix3Xd rot_errs = calcRotationalErrors(rotations);
+  for (int c = 0; c < jac0.cols(); ++c)
+    jac0.col(c).tail(3) = ((rot_errs.col(c + 1) - rot_errs.col(0)) / 1e-5);
 
   MatrixXd reduced_jac(indices_.size(), n_dof);
   for (int i = 0; i < indices_.size(); ++i)
@@ -328,6 +332,61 @@ MatrixXd JointVelJacCalculator::operator()(const VectorXd& var_vals) const
   return jac;
 }
 
+VectorXd JointVelTimeErrCalculator::operator()(const VectorXd& var_vals) const
+{
+  using RowMajorArray = Array<double, Dynamic, Dynamic, RowMajor>;
+  const long n_dof = targets_.size();
+  const long stride = n_dof + 1;
+  assert(var_vals.size() % stride == 0);
+  const long num_vels = var_vals.size() / stride - 1;
+
+  Map<const RowMajorArray> traj(var_vals.data(), num_vels + 1, stride);
+  // (x1-x0)*(1/dt)
+  RowMajorArray vel = (traj.bottomRows(num_vels).leftCols(n_dof) - traj.topRows(num_vels).leftCols(n_dof)).colwise() *
+                      traj.bottomRows(num_vels).col(n_dof);
+
+  // Note that for equality terms tols are 0, so error is effectively doubled
+  VectorXd result(2 * num_vels * n_dof);
+  Map<RowMajorArray> upper(result.data(), num_vels, n_dof);
+  Map<RowMajorArray> lower(result.data() + num_vels * n_dof, num_vels, n_dof);
+  upper = vel.rowwise() - (targets_ + upper_tols_).transpose().array();
+  lower = (-vel).rowwise() + (targets_ + lower_tols_).transpose().array();
+  return result;
+}
+
+JointVelTimeJacCalculator::SparseMatrix JointVelTimeJacCalculator::operator()(const VectorXd& var_vals) const
+{
+  const long stride = n_dof_ + 1;
+  assert(var_vals.size() % stride == 0);
+  const long num_vels = var_vals.size() / stride - 1;
+  const long half = num_vels * n_dof_;
+
+  SparseMatrix jac(2 * half, var_vals.size());
+  jac.reserve(VectorXi::Constant(2 * half, 3));
+  for (long sign = 0; sign < 2; ++sign)
+  {
+    // bottom half is negative velocities
+    const double scale = (sign == 0) ? 1.0 : -1.0;
+    for (long i = 0; i < num_vels; ++i)
+    {
+      // v = (j_i+1 - j_i)*(1/dt) using the dt from the second pt
+      const long time_index = (i + 1) * stride + n_dof_;
+      const double inv_dt = var_vals(time_index);
+      for (long j = 0; j < n_dof_; ++j)
+      {
+        const long row = sign * half + i * n_dof_ + j;
+        const long index0 = i * stride + j;
+        const long index1 = index0 + stride;
+        jac.insert(row, index0) = -scale * inv_dt;
+        jac.insert(row, index1) = scale * inv_dt;
+        jac.insert(row, time_index) = scale * (var_vals(index1) - var_vals(index0));
+      }
+    }
+  }
+  jac.makeCompressed();
+  return jac;
+}
+
 // TODO: convert to (1/dt) and use central finite difference method
 VectorXd JointAccErrCalculator::operator()(const VectorXd& var_vals) const
 {
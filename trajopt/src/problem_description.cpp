@@ -27,10 +27,12 @@ void ensure_only_members(const Json::Value& v, const char** fields, int nvalid)
   for (Json::ValueConstIterator it = v.begin(); it != v.end(); ++it)
   {
     bool valid = false;
+    const char* member_end = nullptr;
+    const char* member_name = it.memberName(&member_end);
+    size_t member_size = static_cast<size_t>(member_end - member_name);
     for (int j = 0; j < nvalid; ++j)
     {
-      JSONCPP_STRING member_name = it.name();
-      if (strcmp(member_name.c_str(), fields[j]) == 0)
+      if (strlen(fields[j]) == member_size && memcmp(member_name, fields[j], member_size) == 0)
       {
         valid = true;
         break;
@@ -38,7 +40,7 @@ void ensure_only_members(const Json::Value& v, const char** fields, int nvalid)
     }
     if (!valid)
     {
-      PRINT_AND_THROW(boost::format("invalid field found: %s") % it.name());
+      PRINT_AND_THROW(boost::format("invalid field found: %s") % std::string(member_name, member_end));
     }
   }
 }
@@ -81,6 +83,38 @@ void checkParameterSize(trajopt::DblVec& parameter,
   }
 }
 
+/**
+ * @brief Reads the optional quasi-Newton Hessian of a cost term
+ * @param params The term parameters, whose "quasi_newton" member is "none" (the default), "bfgs" or "sr1"
+ */
+sco::QuasiNewtonType readQuasiNewton(const Json::Value& params)
+{
+  std::string type_str;
+  json_marshal::childFromJson(params, type_str, "quasi_newton", std::string("none"));
+  if (boost::iequals(type_str, "none"))
+    return sco::QN_NONE;
+  if (boost::iequals(type_str, "bfgs"))
+    return sco::QN_BFGS;
+  if (boost::iequals(type_str, "sr1"))
+    return sco::QN_SR1;
+  PRINT_AND_THROW(boost::format("invalid quasi_newton: %s. Valid values are none, bfgs, or sr1") % type_str);
+}
+
+/** @brief The current environment values of the joints of pci.kin, where the initial trajectories start */
+Eigen::VectorXd currentJointValues(const trajopt::ProblemConstructionInfo& pci)
+{
+  tesseract_environment::EnvState state(*(pci.env->getCurrentState()));
+  Eigen::VectorXd start_pos(pci.kin->numJoints());
+  int i = 0;
+  for (const auto& joint : pci.kin->getJointNames())
+  {
+    assert(state.joints.find(joint) != state.joints.end());
+    start_pos[i] = state.joints[joint];
+    ++i;
+  }
+  return start_pos;
+}
+
 #if 0
 BoolVec toMask(const VectorXd& x) {
   BoolVec out(x.size());
@@ -92,7 +126,7 @@ BoolVec toMask(const VectorXd& x) {
 
 namespace trajopt
 {
-std::map<std::string, TermInfo::MakerFunc> TermInfo::name2maker;
+std::unordered_map<std::string, TermInfo::MakerFunc> TermInfo::name2maker;
 
 void TermInfo::RegisterMaker(const std::string& type, MakerFunc f) { TermInfo::name2maker[type] = f; }
 
@@ -100,9 +134,10 @@ TermInfo::Ptr TermInfo::fromName(const std::string& type)
 {
   if (!gRegisteredMakers)
     RegisterMakers();
-  if (name2maker.find(type) != name2maker.end())
+  auto it = name2maker.find(type);
+  if (it != name2maker.end())
   {
-    return (*name2maker[type])();
+    return (*it->second)();
   }
   else
   {
@@ -149,6 +184,20 @@ void ProblemConstructionInfo::readOptInfo(const Json::Value& v)
   json_marshal::childFromJson(v, opt_info.max_time, "max_time", opt_info.max_time);
   json_marshal::childFromJson(v, opt_info.merit_error_coeff, "merit_error_coeff", opt_info.merit_error_coeff);
   json_marshal::childFromJson(v, opt_info.trust_box_size, "trust_box_size", opt_info.trust_box_size);
+  json_marshal::childFromJson(v,
+                              opt_info.merit_coeff_increase_violated_only,
+                              "merit_coeff_increase_violated_only",
+                              opt_info.merit_coeff_increase_violated_only);
+  json_marshal::childFromJson(v, opt_info.use_filter, "use_filter", opt_info.use_filter);
+  json_marshal::childFromJson(v, opt_info.filter_margin, "filter_margin", opt_info.filter_margin);
+  json_marshal::childFromJson(v, opt_info.max_backtrack_steps, "max_backtrack_steps", opt_info.max_backtrack_steps);
+  json_marshal::childFromJson(v, opt_info.backtrack_ratio, "backtrack_ratio", opt_info.backtrack_ratio);
+  json_marshal::childFromJson(v, opt_info.trust_box_scales, "trust_box_scales", opt_info.trust_box_scales);
+  json_marshal::childFromJson(
+      v, opt_info.adapt_trust_box_scales, "adapt_trust_box_scales", opt_info.adapt_trust_box_scales);
+  json_marshal::childFromJson(
+      v, opt_info.trust_box_scale_ratio, "trust_box_scale_ratio", opt_info.trust_box_scale_ratio);
+  json_marshal::childFromJson(v, opt_info.record_timing, "record_timing", opt_info.record_timing);
 }
 
 void ProblemConstructionInfo::readCosts(const Json::Value& v)
@@ -254,10 +303,21 @@ void ProblemConstructionInfo::readInitInfo(const Json::Value& v)
     }
     init_info.data = util::toVectorXd(endpoint);
   }
+  else if (boost::iequals(type_str, "trajectory_library"))
+  {
+    init_info.type = InitInfo::TRAJECTORY_LIBRARY;
+    FAIL_IF_FALSE(v.isMember("path"));
+    std::string path;
+    json_marshal::childFromJson(v, path, "path");
+    init_info.library = std::make_shared<const TrajectoryLibrary>(path);
+    DblVec goal;
+    json_marshal::childFromJson(v, goal, "goal", DblVec());
+    init_info.goal = util::toVectorXd(goal);
+  }
   else
   {
     PRINT_AND_THROW("init_info did not have a valid type from Json. Valid types are "
-                    "stationary, joint_interpolated, or given_traj");
+                    "stationary, joint_interpolated, given_traj, or trajectory_library");
   }
 }
 
@@ -307,30 +367,11 @@ void generateInitTraj(TrajArray& init_traj, const ProblemConstructionInfo& pci)
   // initialize based on type specified
   if (init_info.type == InitInfo::STATIONARY)
   {
-    tesseract_environment::EnvState state(*(pci.env->getCurrentState()));
-    Eigen::VectorXd start_pos(pci.kin->numJoints());
-    int i = 0;
-    for (const auto& joint : pci.kin->getJointNames())
-    {
-      assert(state.joints.find(joint) != state.joints.end());
-      start_pos[i] = state.joints[joint];
-      ++i;
-    }
-
-    init_traj = start_pos.transpose().replicate(pci.basic_info.n_steps, 1);
+    init_traj = currentJointValues(pci).transpose().replicate(pci.basic_info.n_steps, 1);
   }
   else if (init_info.type == InitInfo::JOINT_INTERPOLATED)
   {
-    tesseract_environment::EnvState state(*(pci.env->getCurrentState()));
-    Eigen::VectorXd start_pos(pci.kin->numJoints());
-    int i = 0;
-    for (const auto& joint : pci.kin->getJointNames())
-    {
-      assert(state.joints.find(joint) != state.joints.end());
-      start_pos[i] = state.joints[joint];
-      ++i;
-    }
-
+    Eigen::VectorXd start_pos = currentJointValues(pci);
     Eigen::VectorXd end_pos = init_info.data;
     init_traj.resize(pci.basic_info.n_steps, end_pos.rows());
     for (int idof = 0; idof < start_pos.rows(); ++idof)
@@ -342,10 +383,26 @@ void generateInitTraj(TrajArray& init_traj, const ProblemConstructionInfo& pci)
   {
     init_traj = init_info.data;
   }
+  else if (init_info.type == InitInfo::TRAJECTORY_LIBRARY)
+  {
+    Eigen::VectorXd start_pos = currentJointValues(pci);
+    if (!init_info.library || init_info.library->empty())
+    {
+      CONSOLE_BRIDGE_logWarn("Trajectory library is empty, initializing stationary");
+      init_traj = start_pos.transpose().replicate(pci.basic_info.n_steps, 1);
+    }
+    else
+    {
+      if (init_info.library->numSteps() != pci.basic_info.n_steps)
+        PRINT_AND_THROW(boost::format("trajectory library has %i steps, the problem %i") %
+                        init_info.library->numSteps() % pci.basic_info.n_steps);
+      init_traj = init_info.library->seed(start_pos, init_info.goal);
+    }
+  }
   else
   {
     PRINT_AND_THROW("Init Info did not have a valid type. Valid types are "
-                    "STATIONARY, JOINT_INTERPOLATED, or GIVEN_TRAJ");
+                    "STATIONARY, JOINT_INTERPOLATED, GIVEN_TRAJ, or TRAJECTORY_LIBRARY");
   }
 
   // Currently all trajectories are generated without time then appended here
@@ -360,7 +417,7 @@ void generateInitTraj(TrajArray& init_traj, const ProblemConstructionInfo& pci)
 }
 
 TrajOptResult::TrajOptResult(sco::OptResults& opt, TrajOptProb& prob)
-  : cost_vals(opt.cost_vals), cnt_viols(opt.cnt_viols), status(opt.status)
+  : cost_vals(opt.cost_vals), cnt_viols(opt.cnt_viols), status(opt.status), timing(opt.timing)
 {
   for (const sco::Cost::Ptr& cost : prob.getCosts())
   {
@@ -475,25 +532,12 @@ TrajOptProb::Ptr ConstructProblem(const ProblemConstructionInfo& pci)
       PRINT_AND_THROW("robot dof values don't match initialization. I don't "
                       "know what you want me to use for the dof values");
     }
-
-    for (int j = 0; j < static_cast<int>(n_dof); ++j)
-    {
-      prob->addLinearConstraint(sco::exprSub(sco::AffExpr(prob->m_traj_vars(0, j)), init_traj(0, j)), sco::EQ);
-    }
   }
 
-  // Apply constraint to each fixed dof to its initial value for all timesteps (freeze that column)
-  if (!bi.dofs_fixed.empty())
-  {
-    for (const int& dof_ind : bi.dofs_fixed)
-    {
-      for (int i = 1; i < prob->GetNumSteps(); ++i)
-      {
-        prob->addLinearConstraint(
-            sco::exprSub(sco::AffExpr(prob->m_traj_vars(i, dof_ind)), sco::AffExpr(init_traj(0, dof_ind))), sco::EQ);
-      }
-    }
-  }
+  // Kept on the problem so SetStartState can replace these constraints
+  prob->m_start_fixed = bi.start_fixed;
+  prob->m_dofs_fixed = bi.dofs_fixed;
+  prob->addStartConstraints();
 
   for (const TermInfo::Ptr& ci : pci.cost_infos)
   {
@@ -511,7 +555,9 @@ TrajOptProb::Ptr ConstructProblem(const Json::Value& root, const tesseract::Tess
 {
   ProblemConstructionInfo pci(tesseract);
   pci.fromJson(root);
-  return ConstructProblem(pci);
+  TrajOptProb::Ptr prob = ConstructProblem(pci);
+  prob->m_request = root;
+  return prob;
 }
 
 TrajOptProb::TrajOptProb(int n_steps, const ProblemConstructionInfo& pci)
@@ -546,6 +592,144 @@ TrajOptProb::TrajOptProb(int n_steps, const ProblemConstructionInfo& pci)
 }
 
 TrajOptProb::TrajOptProb() {}
+
+void TrajOptProb::addStartConstraints()
+{
+  // If start_fixed, constrain the joint values for the first time step to be their initialized values
+  if (m_start_fixed)
+  {
+    for (int j = 0; j < static_cast<int>(m_kin->numJoints()); ++j)
+    {
+      m_start_cnts.push_back(
+          addLinearConstraint(sco::exprSub(sco::AffExpr(m_traj_vars(0, j)), m_init_traj(0, j)), sco::EQ));
+    }
+  }
+
+  // Apply constraint to each fixed dof to its initial value for all timesteps (freeze that column)
+  for (const int& dof_ind : m_dofs_fixed)
+  {
+    for (int i = 1; i < GetNumSteps(); ++i)
+    {
+      m_start_cnts.push_back(addLinearConstraint(
+          sco::exprSub(sco::AffExpr(m_traj_vars(i, dof_ind)), sco::AffExpr(m_init_traj(0, dof_ind))), sco::EQ));
+    }
+  }
+}
+
+void TrajOptProb::initConstructionContext()
+{
+  if (m_env_state)
+    return;
+
+  tesseract_environment::EnvState::ConstPtr state = m_env->getCurrentState();
+  try
+  {
+    m_world_to_base = state->transforms.at(m_kin->getBaseLinkName());
+  }
+  catch (const std::exception&)
+  {
+    PRINT_AND_THROW(boost::format("Failed to find transform for link '%s'") % m_kin->getBaseLinkName());
+  }
+  m_adjacency_map = std::make_shared<tesseract_environment::AdjacencyMap>(
+      m_env->getSceneGraph(), m_kin->getActiveLinkNames(), state->transforms);
+  m_env_state = state;
+}
+
+tesseract_environment::EnvState::ConstPtr TrajOptProb::GetEnvState()
+{
+  initConstructionContext();
+  return m_env_state;
+}
+
+const Eigen::Isometry3d& TrajOptProb::GetWorldToBase()
+{
+  initConstructionContext();
+  return m_world_to_base;
+}
+
+tesseract_environment::AdjacencyMap::ConstPtr TrajOptProb::GetAdjacencyMap()
+{
+  initConstructionContext();
+  return m_adjacency_map;
+}
+
+void TrajOptProb::SetStartState(const Eigen::VectorXd& start)
+{
+  long n_dof = static_cast<long>(m_kin->numJoints());
+  if (start.size() != n_dof)
+    PRINT_AND_THROW(boost::format("Start state has %i values, expected %i") % start.size() % n_dof);
+
+  m_init_traj.row(0).head(n_dof) = start.transpose();
+  removeLinearConstraints(m_start_cnts);
+  m_start_cnts.clear();
+  addStartConstraints();
+}
+
+void TrajOptProb::SetCartPoseTarget(const std::string& name, const Eigen::Isometry3d& world_pose)
+{
+  bool found = false;
+  auto set_target = [&](const sco::VectorOfVector::Ptr& f) {
+    auto calc = std::dynamic_pointer_cast<CartPoseErrCalculator>(f);
+    if (calc)
+    {
+      calc->setTarget(world_pose);
+      found = true;
+    }
+  };
+
+  for (const sco::Cost::Ptr& cost : getCosts())
+  {
+    auto term = std::dynamic_pointer_cast<sco::CostFromErrFunc>(cost);
+    if (term && cost->name() == name)
+    {
+      set_target(term->getErrFunc());
+      // The quasi-Newton Hessian approximates the error to the old target
+      term->reset();
+    }
+  }
+  for (const sco::Constraint::Ptr& cnt : getConstraints())
+  {
+    auto term = std::dynamic_pointer_cast<sco::ConstraintFromErrFunc>(cnt);
+    if (term && cnt->name() == name)
+      set_target(term->getErrFunc());
+  }
+
+  if (!found)
+    PRINT_AND_THROW(boost::format("No cartesian pose term named '%s'") % name);
+}
+
+void TrajOptProb::SetJointPosTargets(const std::string& name, const Eigen::VectorXd& targets)
+{
+  bool found = false;
+  for (const sco::Cost::Ptr& cost : getCosts())
+  {
+    if (cost->name() != name)
+      continue;
+    auto eq = std::dynamic_pointer_cast<JointPosEqCost>(cost);
+    auto ineq = std::dynamic_pointer_cast<JointPosIneqCost>(cost);
+    if (eq)
+      eq->setTargets(targets);
+    if (ineq)
+      ineq->setTargets(targets);
+    found = found || eq || ineq;
+  }
+  for (const sco::Constraint::Ptr& cnt : getConstraints())
+  {
+    if (cnt->name() != name)
+      continue;
+    auto eq = std::dynamic_pointer_cast<JointPosEqConstraint>(cnt);
+    auto ineq = std::dynamic_pointer_cast<JointPosIneqConstraint>(cnt);
+    if (eq)
+      eq->setTargets(targets);
+    if (ineq)
+      ineq->setTargets(targets);
+    found = found || eq || ineq;
+  }
+
+  if (!found)
+    PRINT_AND_THROW(boost::format("No joint position term named '%s'") % name);
+}
+
 DynamicCartPoseTermInfo::DynamicCartPoseTermInfo() : TermInfo(TT_COST | TT_CNT)
 {
   pos_coeffs = Eigen::Vector3d::Ones();
@@ -572,6 +756,7 @@ void DynamicCartPoseTermInfo::fromJson(ProblemConstructionInfo& pci, const Json:
   json_marshal::childFromJson(params, tcp_wxyz, "tcp_wxyz", Eigen::Vector4d(1, 0, 0, 0));
   json_marshal::childFromJson(params, target_tcp_xyz, "target_tcp_xyz", Eigen::Vector3d(0, 0, 0));
   json_marshal::childFromJson(params, target_tcp_wxyz, "target_tcp_wxyz", Eigen::Vector4d(1, 0, 0, 0));
+  quasi_newton = readQuasiNewton(params);
 
   Eigen::Quaterniond q(tcp_wxyz(0), tcp_wxyz(1), tcp_wxyz(2), tcp_wxyz(3));
   tcp.linear() = q.matrix();
@@ -587,8 +772,8 @@ void DynamicCartPoseTermInfo::fromJson(ProblemConstructionInfo& pci, const Json:
     PRINT_AND_THROW(boost::format("invalid link name: %s") % link);
   }
 
-  const char* all_fields[] = { "timestep", "target",   "pos_coeffs",     "rot_coeffs",     "link",
-                               "tcp_xyz",  "tcp_wxyz", "target_tcp_xyz", "target_tcp_wxyz" };
+  const char* all_fields[] = { "timestep", "target",   "pos_coeffs",     "rot_coeffs",      "link",
+                               "tcp_xyz",  "tcp_wxyz", "target_tcp_xyz", "target_tcp_wxyz", "quasi_newton" };
   ensure_only_members(params, all_fields, sizeof(all_fields) / sizeof(char*));
 }
 
@@ -628,18 +813,8 @@ void DynamicCartPoseTermInfo::hatch(TrajOptProb& prob)
   }
   else
   {
-    tesseract_environment::EnvState::ConstPtr state = prob.GetEnv()->getCurrentState();
-    Eigen::Isometry3d world_to_base = Eigen::Isometry3d::Identity();
-    try
-    {
-      world_to_base = state->transforms.at(prob.GetKin()->getBaseLinkName());
-    }
-    catch (const std::exception&)
-    {
-      PRINT_AND_THROW(boost::format("Failed to find transform for link '%s'") % prob.GetKin()->getBaseLinkName());
-    }
-    tesseract_environment::AdjacencyMap::Ptr adjacency_map = std::make_shared<tesseract_environment::AdjacencyMap>(
-        prob.GetEnv()->getSceneGraph(), prob.GetKin()->getActiveLinkNames(), state->transforms);
+    const Eigen::Isometry3d& world_to_base = prob.GetWorldToBase();
+    tesseract_environment::AdjacencyMap::ConstPtr adjacency_map = prob.GetAdjacencyMap();
 
     sco::VectorOfVector::Ptr f(new DynamicCartPoseErrCalculator(
         target, prob.GetKin(), adjacency_map, world_to_base, link, tcp, target_tcp, indices));
@@ -651,8 +826,10 @@ void DynamicCartPoseTermInfo::hatch(TrajOptProb& prob)
     // Apply error calculator as either cost or constraint
     if (term_type & TT_COST)
     {
-      prob.addCost(
-          sco::Cost::Ptr(new TrajOptCostFromErrFunc(f, prob.GetVarRow(timestep, 0, n_dof), coeff, sco::ABS, name)));
+      auto cost =
+          std::make_shared<TrajOptCostFromErrFunc>(f, prob.GetVarRow(timestep, 0, n_dof), coeff, sco::ABS, name);
+      cost->setQuasiNewton(quasi_newton);
+      prob.addCost(cost);
     }
     else if (term_type & TT_CNT)
     {
@@ -690,6 +867,7 @@ void CartPoseTermInfo::fromJson(ProblemConstructionInfo& pci, const Json::Value&
   json_marshal::childFromJson(params, tcp_xyz, "tcp_xyz", Eigen::Vector3d(0, 0, 0));
   json_marshal::childFromJson(params, tcp_wxyz, "tcp_wxyz", Eigen::Vector4d(1, 0, 0, 0));
   json_marshal::childFromJson(params, target, "target", std::string(""));
+  quasi_newton = readQuasiNewton(params);
 
   Eigen::Quaterniond q(tcp_wxyz(0), tcp_wxyz(1), tcp_wxyz(2), tcp_wxyz(3));
   tcp.linear() = q.matrix();
@@ -715,7 +893,7 @@ void CartPoseTermInfo::fromJson(ProblemConstructionInfo& pci, const Json::Value&
   }
 
   const char* all_fields[] = { "timestep", "xyz",     "wxyz",     "pos_coeffs", "rot_coeffs",
-                               "link",     "tcp_xyz", "tcp_wxyz", "target" };
+                               "link",     "tcp_xyz", "tcp_wxyz", "target",     "quasi_newton" };
   ensure_only_members(params, all_fields, sizeof(all_fields) / sizeof(char*));
 }
 
@@ -728,16 +906,8 @@ void CartPoseTermInfo::hatch(TrajOptProb& prob)
   input_pose.linear() = q.matrix();
   input_pose.translation() = xyz;
 
-  tesseract_environment::EnvState::ConstPtr state = prob.GetEnv()->getCurrentState();
-  Eigen::Isometry3d world_to_base = Eigen::Isometry3d::Identity();
-  try
-  {
-    world_to_base = state->transforms.at(prob.GetKin()->getBaseLinkName());
-  }
-  catch (const std::exception&)
-  {
-    PRINT_AND_THROW(boost::format("Failed to find transform for link '%s'") % prob.GetKin()->getBaseLinkName());
-  }
+  tesseract_environment::EnvState::ConstPtr state = prob.GetEnvState();
+  const Eigen::Isometry3d& world_to_base = prob.GetWorldToBase();
 
   Eigen::Isometry3d world_to_target = Eigen::Isometry3d::Identity();
   if (!target.empty())
@@ -752,8 +922,7 @@ void CartPoseTermInfo::hatch(TrajOptProb& prob)
     }
   }
 
-  tesseract_environment::AdjacencyMap::Ptr adjacency_map = std::make_shared<tesseract_environment::AdjacencyMap>(
-      prob.GetEnv()->getSceneGraph(), prob.GetKin()->getActiveLinkNames(), state->transforms);
+  tesseract_environment::AdjacencyMap::ConstPtr adjacency_map = prob.GetAdjacencyMap();
 
   // Next parse the coeff and if not zero add the indice and coeff
   std::vector<int> ic;
@@ -797,8 +966,9 @@ void CartPoseTermInfo::hatch(TrajOptProb& prob)
     // This is currently not being used. There is an intermittent bug that needs to be tracked down it is not used.
     sco::MatrixOfVector::Ptr dfdx(
         new CartPoseJacCalculator(input_pose, prob.GetKin(), adjacency_map, world_to_base, link, tcp, indices));
-    prob.addCost(
-        sco::Cost::Ptr(new TrajOptCostFromErrFunc(f, prob.GetVarRow(timestep, 0, n_dof), coeff, sco::ABS, name)));
+    auto cost = std::make_shared<TrajOptCostFromErrFunc>(f, prob.GetVarRow(timestep, 0, n_dof), coeff, sco::ABS, name);
+    cost->setQuasiNewton(quasi_newton);
+    prob.addCost(cost);
   }
   else if ((term_type & TT_CNT) && ~(term_type | ~TT_USE_TIME))
   {
@@ -843,19 +1013,9 @@ void CartVelTermInfo::hatch(TrajOptProb& prob)
 {
   int n_dof = static_cast<int>(prob.GetKin()->numJoints());
 
-  tesseract_environment::EnvState::ConstPtr state = prob.GetEnv()->getCurrentState();
-  Eigen::Isometry3d world_to_base = Eigen::Isometry3d::Identity();
-  try
-  {
-    world_to_base = state->transforms.at(prob.GetKin()->getBaseLinkName());
-  }
-  catch (const std::exception&)
-  {
-    PRINT_AND_THROW(boost::format("Failed to find transform for link '%s'") % prob.GetKin()->getBaseLinkName());
-  }
+  const Eigen::Isometry3d& world_to_base = prob.GetWorldToBase();
 
-  tesseract_environment::AdjacencyMap::Ptr adjacency_map = std::make_shared<tesseract_environment::AdjacencyMap>(
-      prob.GetEnv()->getSceneGraph(), prob.GetKin()->getActiveLinkNames(), state->transforms);
+  tesseract_environment::AdjacencyMap::ConstPtr adjacency_map = prob.GetAdjacencyMap();
 
   if (term_type == (TT_COST | TT_USE_TIME))
   {
@@ -1083,78 +1243,35 @@ void JointVelTermInfo::hatch(TrajOptProb& prob)
   trajopt::VarArray vars = prob.GetVars();
   trajopt::VarArray joint_vars = vars.block(0, 0, vars.rows(), static_cast<int>(n_dof));
 
-  if (term_type == (TT_COST | TT_USE_TIME))
+  if (term_type == (TT_COST | TT_USE_TIME) || term_type == (TT_CNT | TT_USE_TIME))
   {
-    unsigned num_vels = static_cast<unsigned>(last_step - first_step);
-
-    // Apply seperate cost to each joint b/c that is how the error function is currently written
-    for (size_t j = 0; j < n_dof; j++)
+    // A single term covers all joints and steps. The vars are ordered by step, each step being the joint vars
+    // followed by the 1/dt var, which keeps the Jacobian banded
+    sco::VarVector vel_vars;
+    vel_vars.reserve(static_cast<size_t>(last_step - first_step + 1) * (n_dof + 1));
+    for (int i = first_step; i <= last_step; ++i)
     {
-      // Get a vector of a single column of vars
-      sco::VarVector joint_vars_vec = joint_vars.cblock(first_step, static_cast<int>(j), last_step - first_step + 1);
-      sco::VarVector time_vars_vec = vars.cblock(first_step, vars.cols() - 1, last_step - first_step + 1);
-
-      // If the tolerances are 0, an equality cost is set
-      if (is_upper_zeros && is_lower_zeros)
-      {
-        DblVec single_jnt_coeffs = DblVec(num_vels * 2, coeffs[j]);
-        prob.addCost(sco::Cost::Ptr(new TrajOptCostFromErrFunc(
-            sco::VectorOfVector::Ptr(new JointVelErrCalculator(targets[j], upper_tols[j], lower_tols[j])),
-            sco::MatrixOfVector::Ptr(new JointVelJacCalculator()),
-            concat(joint_vars_vec, time_vars_vec),
-            util::toVectorXd(single_jnt_coeffs),
-            sco::SQUARED,
-            name + "_j" + std::to_string(j))));
-      }
-      // Otherwise it's a hinged "inequality" cost
-      else
-      {
-        DblVec single_jnt_coeffs = DblVec(num_vels * 2, coeffs[j]);
-        prob.addCost(sco::Cost::Ptr(new TrajOptCostFromErrFunc(
-            sco::VectorOfVector::Ptr(new JointVelErrCalculator(targets[j], upper_tols[j], lower_tols[j])),
-            sco::MatrixOfVector::Ptr(new JointVelJacCalculator()),
-            concat(joint_vars_vec, time_vars_vec),
-            util::toVectorXd(single_jnt_coeffs),
-            sco::HINGE,
-            name + "_j" + std::to_string(j))));
-      }
+      for (int j = 0; j < static_cast<int>(n_dof); ++j)
+        vel_vars.push_back(joint_vars(i, j));
+      vel_vars.push_back(vars(i, vars.cols() - 1));
     }
-  }
-  else if (term_type == (TT_CNT | TT_USE_TIME))
-  {
-    unsigned num_vels = static_cast<unsigned>(last_step - first_step);
 
-    // Apply seperate cnt to each joint b/c that is how the error function is currently written
-    for (size_t j = 0; j < n_dof; j++)
-    {
-      // Get a vector of a single column of vars
-      sco::VarVector joint_vars_vec = joint_vars.cblock(first_step, static_cast<int>(j), last_step - first_step + 1);
-      sco::VarVector time_vars_vec = vars.cblock(first_step, vars.cols() - 1, last_step - first_step + 1);
+    Eigen::VectorXd vel_coeffs = util::toVectorXd(coeffs).replicate(2 * (last_step - first_step), 1);
+    sco::VectorOfVector::Ptr f(new JointVelTimeErrCalculator(
+        util::toVectorXd(targets), util::toVectorXd(upper_tols), util::toVectorXd(lower_tols)));
+    sco::SparseMatrixOfVector::Ptr dfdx(new JointVelTimeJacCalculator(static_cast<long>(n_dof)));
 
-      // If the tolerances are 0, an equality cnt is set
-      if (is_upper_zeros && is_lower_zeros)
-      {
-        DblVec single_jnt_coeffs = DblVec(num_vels * 2, coeffs[j]);
-        prob.addConstraint(sco::Constraint::Ptr(new TrajOptConstraintFromErrFunc(
-            sco::VectorOfVector::Ptr(new JointVelErrCalculator(targets[j], upper_tols[j], lower_tols[j])),
-            sco::MatrixOfVector::Ptr(new JointVelJacCalculator()),
-            concat(joint_vars_vec, time_vars_vec),
-            util::toVectorXd(single_jnt_coeffs),
-            sco::EQ,
-            name + "_j" + std::to_string(j))));
-      }
-      // Otherwise it's a hinged "inequality" constraint
-      else
-      {
-        DblVec single_jnt_coeffs = DblVec(num_vels * 2, coeffs[j]);
-        prob.addConstraint(sco::Constraint::Ptr(new TrajOptConstraintFromErrFunc(
-            sco::VectorOfVector::Ptr(new JointVelErrCalculator(targets[j], upper_tols[j], lower_tols[j])),
-            sco::MatrixOfVector::Ptr(new JointVelJacCalculator()),
-            concat(joint_vars_vec, time_vars_vec),
-            util::toVectorXd(single_jnt_coeffs),
-            sco::INEQ,
-            name + "_j" + std::to_string(j))));
-      }
+    // If the tolerances are 0, an equality term is set. Otherwise it's a hinged "inequality" term
+    bool is_equality = is_upper_zeros && is_lower_zeros;
+    if (term_type & TT_COST)
+    {
+      prob.addCost(sco::Cost::Ptr(
+          new TrajOptCostFromErrFunc(f, dfdx, vel_vars, vel_coeffs, is_equality ? sco::SQUARED : sco::HINGE, name)));
+    }
+    else
+    {
+      prob.addConstraint(sco::Constraint::Ptr(
+          new TrajOptConstraintFromErrFunc(f, dfdx, vel_vars, vel_coeffs, is_equality ? sco::EQ : sco::INEQ, name)));
     }
   }
   else if ((term_type & TT_COST) && ~(term_type | ~TT_USE_TIME))
@@ -1548,19 +1665,9 @@ void CollisionTermInfo::fromJson(ProblemConstructionInfo& pci, const Json::Value
 void CollisionTermInfo::hatch(TrajOptProb& prob)
 {
   int n_dof = static_cast<int>(prob.GetKin()->numJoints());
-  tesseract_environment::EnvState::ConstPtr state = prob.GetEnv()->getCurrentState();
-  Eigen::Isometry3d world_to_base = Eigen::Isometry3d::Identity();
-  try
-  {
-    world_to_base = state->transforms.at(prob.GetKin()->getBaseLinkName());
-  }
-  catch (const std::exception&)
-  {
-    PRINT_AND_THROW(boost::format("Failed to find transform for link '%s'") % prob.GetKin()->getBaseLinkName());
-  }
+  const Eigen::Isometry3d& world_to_base = prob.GetWorldToBase();
 
-  tesseract_environment::AdjacencyMap::Ptr adjacency_map = std::make_shared<tesseract_environment::AdjacencyMap>(
-      prob.GetEnv()->getSceneGraph(), prob.GetKin()->getActiveLinkNames(), state->transforms);
+  tesseract_environment::AdjacencyMap::ConstPtr adjacency_map = prob.GetAdjacencyMap();
 
   if (term_type == TT_COST)
   {
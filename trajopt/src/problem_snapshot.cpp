@@ -0,0 +1,269 @@
+#include <trajopt_utils/macros.h>
+TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+TRAJOPT_IGNORE_WARNINGS_POP
+
+#include <trajopt/json_codec.hpp>
+#include <trajopt/problem_snapshot.hpp>
+
+namespace trajopt
+{
+const char ProblemSnapshot::MAGIC[8] = { 'T', 'J', 'P', 'S', 'N', 'A', 'P', '\0' };
+const uint32_t ProblemSnapshot::VERSION;
+
+struct ProblemSnapshot::Header
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t has_time;
+  uint64_t n_vars;
+  uint64_t n_steps;
+  uint64_t n_cols;
+  uint64_t n_costs;
+  uint64_t n_cnts;
+  uint64_t bounds_offset;
+  uint64_t init_traj_offset;
+  uint64_t names_offset;
+  uint64_t names_size;
+  uint64_t request_offset;
+  uint64_t request_size;
+  uint64_t file_size;
+};
+
+namespace
+{
+uint64_t align8(uint64_t offset) { return (offset + 7) & ~uint64_t(7); }
+
+void appendNames(std::string& out, const std::vector<std::string>& names)
+{
+  for (const std::string& name : names)
+  {
+    out += name;
+    out += '\0';
+  }
+}
+
+void writeAt(std::string& file, uint64_t offset, const void* data, size_t size)
+{
+  std::memcpy(&file[static_cast<size_t>(offset)], data, size);
+}
+
+/** @brief True if count values of value_size bytes starting at offset end at or before end, without overflowing */
+bool fitsBefore(uint64_t offset, uint64_t count, uint64_t value_size, uint64_t end)
+{
+  return offset <= end && offset % 8 == 0 && count <= (end - offset) / value_size;
+}
+
+/** @brief Stores a * b in product, returns false if it overflows */
+bool multiply(uint64_t a, uint64_t b, uint64_t& product)
+{
+  if (a != 0 && b > std::numeric_limits<uint64_t>::max() / a)
+    return false;
+  product = a * b;
+  return true;
+}
+}  // namespace
+
+void ProblemSnapshot::save(const std::string& path, TrajOptProb& prob)
+{
+  if (prob.GetRequest().isNull())
+    PRINT_AND_THROW("only problems constructed from a JSON request can be saved as a snapshot");
+
+  std::string request = json_marshal::toBinary(prob.GetRequest());
+
+  std::vector<std::string> var_names;
+  for (const sco::Var& var : prob.getVars())
+    var_names.push_back(var.var_rep->name);
+  std::vector<std::string> cost_names;
+  for (const sco::Cost::Ptr& cost : prob.getCosts())
+    cost_names.push_back(cost->name());
+  std::vector<std::string> cnt_names;
+  for (const sco::Constraint::Ptr& cnt : prob.getConstraints())
+    cnt_names.push_back(cnt->name());
+  std::string names;
+  appendNames(names, var_names);
+  appendNames(names, cost_names);
+  appendNames(names, cnt_names);
+
+  TrajArray init_traj = prob.GetInitTraj();
+  const DblVec& lower = prob.getLowerBounds();
+  const DblVec& upper = prob.getUpperBounds();
+
+  Header header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = VERSION;
+  header.has_time = prob.GetHasTime() ? 1 : 0;
+  header.n_vars = lower.size();
+  header.n_steps = static_cast<uint64_t>(init_traj.rows());
+  header.n_cols = static_cast<uint64_t>(init_traj.cols());
+  header.n_costs = cost_names.size();
+  header.n_cnts = cnt_names.size();
+  header.bounds_offset = align8(sizeof(Header));
+  header.init_traj_offset = align8(header.bounds_offset + 2 * header.n_vars * sizeof(double));
+  header.names_offset = align8(header.init_traj_offset + header.n_steps * header.n_cols * sizeof(double));
+  header.names_size = names.size();
+  header.request_offset = align8(header.names_offset + header.names_size);
+  header.request_size = request.size();
+  header.file_size = header.request_offset + header.request_size;
+
+  std::string file(static_cast<size_t>(header.file_size), '\0');
+  writeAt(file, 0, &header, sizeof(header));
+  writeAt(file, header.bounds_offset, lower.data(), lower.size() * sizeof(double));
+  writeAt(file, header.bounds_offset + header.n_vars * sizeof(double), upper.data(), upper.size() * sizeof(double));
+  writeAt(file, header.init_traj_offset, init_traj.data(), static_cast<size_t>(init_traj.size()) * sizeof(double));
+  writeAt(file, header.names_offset, names.data(), names.size());
+  writeAt(file, header.request_offset, request.data(), request.size());
+
+  std::string tmp_path = path + ".tmp";
+  std::FILE* stream = std::fopen(tmp_path.c_str(), "wb");
+  if (stream == nullptr)
+    PRINT_AND_THROW(boost::format("failed to open %s: %s") % tmp_path % std::strerror(errno));
+  bool written = std::fwrite(file.data(), 1, file.size(), stream) == file.size();
+  written = (std::fclose(stream) == 0) && written;
+  if (!written || std::rename(tmp_path.c_str(), path.c_str()) != 0)
+  {
+    std::remove(tmp_path.c_str());
+    PRINT_AND_THROW(boost::format("failed to write problem snapshot %s") % path);
+  }
+}
+
+ProblemSnapshot::ProblemSnapshot(const std::string& path) : data_(nullptr), size_(0)
+{
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    PRINT_AND_THROW(boost::format("failed to open problem snapshot %s: %s") % path % std::strerror(errno));
+
+  struct stat st;
+  if (::fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(Header)))
+  {
+    ::close(fd);
+    PRINT_AND_THROW(boost::format("%s is not a problem snapshot") % path);
+  }
+
+  size_ = static_cast<size_t>(st.st_size);
+  void* data = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (data == MAP_FAILED)
+    PRINT_AND_THROW(boost::format("failed to map problem snapshot %s: %s") % path % std::strerror(errno));
+  data_ = static_cast<const char*>(data);
+
+  // Each section has to fit between its offset and the next one, so the sections are in order and inside the file
+  const Header& h = header();
+  uint64_t n_bounds = 0, n_init_traj_values = 0;
+  const char* error = nullptr;
+  if (std::memcmp(h.magic, MAGIC, sizeof(MAGIC)) != 0)
+    error = "is not a problem snapshot";
+  else if (h.version != VERSION)
+    error = "has an unsupported version";
+  else if (h.file_size != size_ || h.bounds_offset < sizeof(Header) || !multiply(h.n_vars, 2, n_bounds) ||
+           !multiply(h.n_steps, h.n_cols, n_init_traj_values) ||
+           !fitsBefore(h.bounds_offset, n_bounds, sizeof(double), h.init_traj_offset) ||
+           !fitsBefore(h.init_traj_offset, n_init_traj_values, sizeof(double), h.names_offset) ||
+           !fitsBefore(h.names_offset, h.names_size, 1, h.request_offset) ||
+           !fitsBefore(h.request_offset, h.request_size, 1, size_))
+    error = "is truncated or corrupt";
+
+  if (error != nullptr)
+  {
+    ::munmap(const_cast<char*>(data_), size_);
+    PRINT_AND_THROW(boost::format("problem snapshot %s %s") % path % error);
+  }
+}
+
+ProblemSnapshot::~ProblemSnapshot() { ::munmap(const_cast<char*>(data_), size_); }
+
+const ProblemSnapshot::Header& ProblemSnapshot::header() const { return *reinterpret_cast<const Header*>(data_); }
+
+int ProblemSnapshot::numVars() const { return static_cast<int>(header().n_vars); }
+
+int ProblemSnapshot::numSteps() const { return static_cast<int>(header().n_steps); }
+
+int ProblemSnapshot::numCols() const { return static_cast<int>(header().n_cols); }
+
+bool ProblemSnapshot::hasTime() const { return header().has_time != 0; }
+
+const double* ProblemSnapshot::lowerBounds() const
+{
+  return reinterpret_cast<const double*>(data_ + header().bounds_offset);
+}
+
+const double* ProblemSnapshot::upperBounds() const { return lowerBounds() + header().n_vars; }
+
+Eigen::Map<const TrajArray> ProblemSnapshot::initTraj() const
+{
+  return Eigen::Map<const TrajArray>(
+      reinterpret_cast<const double*>(data_ + header().init_traj_offset), numSteps(), numCols());
+}
+
+std::vector<std::string> ProblemSnapshot::names(size_t first, size_t count) const
+{
+  std::vector<std::string> out;
+  out.reserve(count);
+  const char* it = data_ + header().names_offset;
+  const char* end = it + header().names_size;
+  for (size_t i = 0; i < first + count; ++i)
+  {
+    const char* name_end = static_cast<const char*>(std::memchr(it, '\0', static_cast<size_t>(end - it)));
+    if (name_end == nullptr)
+      PRINT_AND_THROW("problem snapshot names are corrupt");
+    if (i >= first)
+      out.emplace_back(it, name_end);
+    it = name_end + 1;
+  }
+  return out;
+}
+
+std::vector<std::string> ProblemSnapshot::varNames() const { return names(0, header().n_vars); }
+
+std::vector<std::string> ProblemSnapshot::costNames() const { return names(header().n_vars, header().n_costs); }
+
+std::vector<std::string> ProblemSnapshot::cntNames() const
+{
+  return names(header().n_vars + header().n_costs, header().n_cnts);
+}
+
+Json::Value ProblemSnapshot::request() const
+{
+  return json_marshal::fromBinary(data_ + header().request_offset, header().request_size);
+}
+
+TrajOptProb::Ptr ProblemSnapshot::hydrate(const tesseract::Tesseract::ConstPtr& tesseract) const
+{
+  TrajOptProb::Ptr prob = ConstructProblem(request(), tesseract);
+
+  const DblVec& lower = prob->getLowerBounds();
+  const DblVec& upper = prob->getUpperBounds();
+  bool matches = prob->getNumVars() == numVars() && prob->GetNumSteps() == numSteps() &&
+                 prob->GetNumDOF() == numCols() &&
+                 std::equal(lower.begin(), lower.end(), lowerBounds()) &&
+                 std::equal(upper.begin(), upper.end(), upperBounds());
+  if (!matches)
+    PRINT_AND_THROW("problem snapshot variables do not match the environment");
+
+  std::vector<std::string> cost_names = costNames();
+  std::vector<std::string> cnt_names = cntNames();
+  std::vector<sco::Cost::Ptr> costs = prob->getCosts();
+  std::vector<sco::Constraint::Ptr> cnts = prob->getConstraints();
+  matches = costs.size() == cost_names.size() && cnts.size() == cnt_names.size();
+  for (size_t i = 0; matches && i < costs.size(); ++i)
+    matches = costs[i]->name() == cost_names[i];
+  for (size_t i = 0; matches && i < cnts.size(); ++i)
+    matches = cnts[i]->name() == cnt_names[i];
+  if (!matches)
+    PRINT_AND_THROW("problem snapshot terms do not match the problem constructed from its request");
+
+  TrajArray init_traj = initTraj();
+  prob->SetInitTraj(init_traj);
+  prob->SetStartState(init_traj.row(0).head(static_cast<long>(prob->GetKin()->numJoints())).transpose());
+  return prob;
+}
+}  // namespace trajopt
@@ -0,0 +1,29 @@
+#include <trajopt/receding_horizon.hpp>
+#include <trajopt/utils.hpp>
+
+namespace trajopt
+{
+RecedingHorizonPlanner::RecedingHorizonPlanner(TrajOptProb::Ptr prob, const sco::BasicTrustRegionSQPParameters& params)
+  : prob_(prob), opt_(prob), params_(params), has_solution_(false)
+{
+}
+
+TrajOptResult::Ptr RecedingHorizonPlanner::plan(const Eigen::VectorXd& start, int n_shift)
+{
+  // The optimizer changes its trust region and penalties while it runs, every cycle starts from the configured ones
+  sco::BasicTrustRegionSQPParameters params = params_;
+  if (has_solution_)
+  {
+    prob_->SetInitTraj(shiftTraj(getTraj(opt_.x(), prob_->GetVars()), n_shift));
+    if (params.adapt_trust_box_scales)
+      params.trust_box_scales = opt_.results().trust_box_scales;
+  }
+  prob_->SetStartState(start);
+
+  opt_.setParameters(params);
+  opt_.initialize(trajToDblVec(prob_->GetInitTraj()));
+  opt_.optimize();
+  has_solution_ = true;
+  return TrajOptResult::Ptr(new TrajOptResult(opt_.results(), *prob_));
+}
+}  // namespace trajopt
@@ -1,6 +1,8 @@
 #include <trajopt_utils/macros.h>
 TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <algorithm>
 #include <Eigen/Core>
+#include <boost/format.hpp>
 TRAJOPT_IGNORE_WARNINGS_POP
 
 #include <trajopt/trajectory_costs.hpp>
@@ -10,10 +12,140 @@ TRAJOPT_IGNORE_WARNINGS_POP
 
 namespace
 {
-/** @brief Returns the difference between each row of a matrixXd and the row before */
-static Eigen::MatrixXd diffAxis0(const Eigen::MatrixXd& in)
+/**
+ * @brief Finite difference stencils applied along the time axis. These match the AffExpr formed in the constructors
+ * so that value() agrees with the convexified terms.
+ */
+const double POS_STENCIL[] = { 1.0 };
+const double VEL_STENCIL[] = { -1.0, 1.0 };
+const double ACC_STENCIL[] = { 1.0, -2.0, 1.0 };
+const double JERK_STENCIL[] = { -1.0 / 2.0, 1.0, 0.0, -1.0, 1.0 / 2.0 };
+
+/** @brief Number of time steps in [first_step, last_step] at which a stencil of length n can be applied */
+inline Eigen::Index numSteps(int first_step, int last_step, std::size_t n)
 {
-  return in.middleRows(1, in.rows() - 1) - in.middleRows(0, in.rows() - 1);
+  return std::max<Eigen::Index>(last_step - first_step + 2 - static_cast<Eigen::Index>(n), 0);
+}
+
+/** @brief Throws unless there is one target per joint column of vars, buildExprs() indexes them by column */
+void checkTargetSize(const Eigen::VectorXd& targets, const trajopt::VarArray& vars)
+{
+  if (targets.size() != vars.cols())
+    PRINT_AND_THROW(boost::format("joint position targets have %i values, expected %i") % targets.size() %
+                    vars.cols());
+}
+
+/** @brief Applies the stencil starting at row i of column j */
+template <std::size_t N>
+inline double applyStencil(const trajopt::TrajArrayMap& traj,
+                           const double (&stencil)[N],
+                           Eigen::Index i,
+                           Eigen::Index j)
+{
+  double d = 0;
+  for (std::size_t k = 0; k < N; ++k)
+    d += stencil[k] * traj(i + static_cast<Eigen::Index>(k), j);
+  return d;
+}
+
+/** @brief sum_ij coeffs_j * (D(traj)_ij - targets_j)^2 evaluated in a single pass */
+template <std::size_t N>
+double eqCostValue(const trajopt::TrajArrayMap& traj,
+                   const double (&stencil)[N],
+                   int first_step,
+                   int last_step,
+                   const Eigen::VectorXd& coeffs,
+                   const Eigen::VectorXd& targets)
+{
+  const Eigen::Index end = first_step + numSteps(first_step, last_step, N);
+  double cost = 0;
+  for (Eigen::Index i = first_step; i < end; ++i)
+  {
+    for (Eigen::Index j = 0; j < traj.cols(); ++j)
+    {
+      const double d = applyStencil(traj, stencil, i, j) - targets[j];
+      cost += coeffs[j] * d * d;
+    }
+  }
+  return cost;
+}
+
+/** @brief sum_ij hinge((D(traj)_ij - targets_j - upper_tols_j) * coeffs_j) + hinge((lower_tols_j - ...) * coeffs_j) */
+template <std::size_t N>
+double ineqCostValue(const trajopt::TrajArrayMap& traj,
+                     const double (&stencil)[N],
+                     int first_step,
+                     int last_step,
+                     const Eigen::VectorXd& coeffs,
+                     const Eigen::VectorXd& targets,
+                     const Eigen::VectorXd& upper_tols,
+                     const Eigen::VectorXd& lower_tols)
+{
+  const Eigen::Index end = first_step + numSteps(first_step, last_step, N);
+  double cost = 0;
+  for (Eigen::Index i = first_step; i < end; ++i)
+  {
+    for (Eigen::Index j = 0; j < traj.cols(); ++j)
+    {
+      const double d = applyStencil(traj, stencil, i, j) - targets[j];
+      cost += std::max((d - upper_tols[j]) * coeffs[j], 0.0) + std::max((lower_tols[j] - d) * coeffs[j], 0.0);
+    }
+  }
+  return cost;
+}
+
+/** @brief coeffs_j * (D(traj)_ij - targets_j)^2 for every step and joint, stored row-major */
+template <std::size_t N>
+sco::DblVec eqConstraintValue(const trajopt::TrajArrayMap& traj,
+                              const double (&stencil)[N],
+                              int first_step,
+                              int last_step,
+                              const Eigen::VectorXd& coeffs,
+                              const Eigen::VectorXd& targets)
+{
+  const Eigen::Index rows = numSteps(first_step, last_step, N);
+  const Eigen::Index cols = traj.cols();
+  sco::DblVec out(static_cast<std::size_t>(rows * cols));
+  auto it = out.begin();
+  for (Eigen::Index i = first_step; i < first_step + rows; ++i)
+  {
+    for (Eigen::Index j = 0; j < cols; ++j, ++it)
+    {
+      const double d = applyStencil(traj, stencil, i, j) - targets[j];
+      *it = coeffs[j] * d * d;
+    }
+  }
+  return out;
+}
+
+/**
+ * @brief Upper and lower tolerance violations for every step and joint. Each step produces the upper violations of
+ * all joints followed by the lower violations of all joints.
+ */
+template <std::size_t N>
+sco::DblVec ineqConstraintValue(const trajopt::TrajArrayMap& traj,
+                                const double (&stencil)[N],
+                                int first_step,
+                                int last_step,
+                                const Eigen::VectorXd& coeffs,
+                                const Eigen::VectorXd& targets,
+                                const Eigen::VectorXd& upper_tols,
+                                const Eigen::VectorXd& lower_tols)
+{
+  const Eigen::Index rows = numSteps(first_step, last_step, N);
+  const Eigen::Index cols = traj.cols();
+  sco::DblVec out(static_cast<std::size_t>(rows * 2 * cols));
+  auto it = out.begin();
+  for (Eigen::Index i = first_step; i < first_step + rows; ++i, it += 2 * cols)
+  {
+    for (Eigen::Index j = 0; j < cols; ++j)
+    {
+      const double d = applyStencil(traj, stencil, i, j) - targets[j];
+      it[j] = std::max((d - upper_tols[j]) * coeffs[j], 0.0);
+      it[cols + j] = std::max((lower_tols[j] - d) * coeffs[j], 0.0);
+    }
+  }
+  return out;
 }
 }  // namespace
 
@@ -27,15 +159,39 @@ JointPosEqCost::JointPosEqCost(const VarArray& vars,
                                const Eigen::VectorXd& targets,
                                int& first_step,
                                int& last_step)
-  : Cost("JointPosEq"), vars_(vars), coeffs_(coeffs), targets_(targets), first_step_(first_step), last_step_(last_step)
+  : Cost("JointPosEq")
+  , vars_(vars)
+  , coeffs_(coeffs)
+  , targets_(targets)
+  , first_step_(first_step)
+  , last_step_(last_step)
+  , traj_view_(vars)
 {
+  buildExprs();
+}
+
+void JointPosEqCost::setTargets(const Eigen::VectorXd& targets)
+{
+  checkTargetSize(targets, vars_);
+  targets_ = targets;
+  buildExprs();
+}
+
+void JointPosEqCost::buildExprs()
+{
+  expr_.affexpr.constant = 0;
+  expr_.affexpr.coeffs.clear();
+  expr_.affexpr.vars.clear();
+  expr_.coeffs.clear();
+  expr_.vars1.clear();
+  expr_.vars2.clear();
   for (int i = first_step_; i <= last_step_; ++i)
   {
-    for (int j = 0; j < vars.cols(); ++j)
+    for (int j = 0; j < vars_.cols(); ++j)
     {
       // pos = x1 - targ
       sco::AffExpr pos;
-      sco::exprInc(pos, sco::exprMult(vars(i, j), 1));
+      sco::exprInc(pos, sco::exprMult(vars_(i, j), 1));
       sco::exprDec(pos, targets_[j]);
       // expr_ = coeff * vel^2
       sco::exprInc(expr_, sco::exprMult(sco::exprSquare(pos), coeffs_[j]));
@@ -44,13 +200,8 @@ JointPosEqCost::JointPosEqCost(const VarArray& vars,
 }
 double JointPosEqCost::value(const DblVec& xvec)
 {
-  // Convert vector from optimization to trajectory
-  Eigen::MatrixXd traj = (getTraj(xvec, vars_));
-  // Takes diff b/n the subsequent rows and subtract each row by the targets_ vector
-  Eigen::MatrixXd diff =
-      (traj.block(first_step_, 0, last_step_ - first_step_ + 1, traj.cols())).rowwise() - targets_.transpose();
-  // Element-wise square it, multiply it by a diagonal matrix of coefficients, and sums output
-  return (diff.array().square().matrix() * coeffs_.asDiagonal()).sum();
+  TrajArray buffer;
+  return eqCostValue(traj_view_.map(xvec, buffer), POS_STENCIL, first_step_, last_step_, coeffs_, targets_);
 }
 sco::ConvexObjective::Ptr JointPosEqCost::convex(const DblVec& /*x*/, sco::Model* model)
 {
@@ -74,55 +225,49 @@ JointPosIneqCost::JointPosIneqCost(const VarArray& vars,
   , targets_(targets)
   , first_step_(first_step)
   , last_step_(last_step)
+  , traj_view_(vars)
 {
+  buildExprs();
+}
+
+void JointPosIneqCost::setTargets(const Eigen::VectorXd& targets)
+{
+  checkTargetSize(targets, vars_);
+  targets_ = targets;
+  buildExprs();
+}
+
+void JointPosIneqCost::buildExprs()
+{
+  expr_vec_.clear();
   for (int i = first_step_; i <= last_step_; ++i)
   {
-    for (int j = 0; j < vars.cols(); ++j)
+    for (int j = 0; j < vars_.cols(); ++j)
     {
-      sco::AffExpr expr;
-      sco::AffExpr expr_neg;
       // pos = x1 - targ
       sco::AffExpr pos;
-      sco::exprInc(pos, sco::exprMult(vars(i, j), 1));
+      sco::exprInc(pos, sco::exprMult(vars_(i, j), 1));
       sco::exprDec(pos, targets_[j]);
-      sco::exprInc(expr, upper_tols_[j]);  // expr_ = upper_tol
-
-      // Form upper limit expr = - (upper_tol-(vel-targ))
-      sco::exprDec(expr, pos);           // expr = upper_tol_- (vel - targets_)
-      sco::exprScale(expr, -coeffs[j]);  // expr = - (upper_tol_- (vel - targets_)) * coeffs_
-      expr_vec_.push_back(expr);
-
-      // Form upper limit expr = - (upper_tol-(vel-targ))
-      sco::exprDec(expr_neg, pos);          // expr = lower_tol_- (vel - targets_)
-      sco::exprScale(expr_neg, coeffs[j]);  // expr = (lower_tol_- (vel - targets_)) * coeffs_
-      expr_vec_.push_back(expr_neg);
+      expr_vec_.push_back(pos);
     }
   }
 }
 
 double JointPosIneqCost::value(const DblVec& xvec)
 {
-  // Convert vector from optimization to trajectory
-  Eigen::MatrixXd traj = getTraj(xvec, vars_);
-  // Takes diff b/n the subsequent rows to get velocity
-  Eigen::MatrixXd pos = traj.block(first_step_, 0, last_step_ - first_step_ + 1, traj.cols());
-  // Subtract targets to center about 0 and then subtract from tolerance
-  Eigen::MatrixXd diff0 = (pos.rowwise() - targets_.transpose());
-  Eigen::MatrixXd diff1 = (diff0.rowwise() - upper_tols_.transpose()) * coeffs_.asDiagonal();
-  Eigen::MatrixXd diff2 = ((diff0 * -1).rowwise() + lower_tols_.transpose()) * coeffs_.asDiagonal();
-  // Applies hinge, multiplies it by a diagonal matrix of coefficients, sums each corresponding value, and converts to
-  // vector
-  return diff1.cwiseMax(0).sum() + diff2.cwiseMax(0).sum();
+  TrajArray buffer;
+  return ineqCostValue(
+      traj_view_.map(xvec, buffer), POS_STENCIL, first_step_, last_step_, coeffs_, targets_, upper_tols_, lower_tols_);
 }
 
 sco::ConvexObjective::Ptr JointPosIneqCost::convex(const DblVec& /*x*/, sco::Model* model)
 {
   sco::ConvexObjective::Ptr out(new sco::ConvexObjective(model));
-  // Add hinge cost. Set the coefficient to 1 here since we include it in the AffExpr already
-  // This is necessary since we want a seperate coefficient per joint
-  for (sco::AffExpr& expr : expr_vec_)
+  // Upper and lower tolerances of each element share one auxiliary variable. A separate coefficient is used per joint
+  for (std::size_t i = 0; i < expr_vec_.size(); ++i)
   {
-    out->addHinge(expr, 1);
+    const Eigen::Index j = static_cast<Eigen::Index>(i) % vars_.cols();
+    out->addSoftBound(expr_vec_[i], lower_tols_[j], upper_tols_[j], coeffs_[j]);
   }
   return out;
 }
@@ -138,14 +283,28 @@ JointPosEqConstraint::JointPosEqConstraint(const VarArray& vars,
   , targets_(targets)
   , first_step_(first_step)
   , last_step_(last_step)
+  , traj_view_(vars)
 {
+  buildExprs();
+}
+
+void JointPosEqConstraint::setTargets(const Eigen::VectorXd& targets)
+{
+  checkTargetSize(targets, vars_);
+  targets_ = targets;
+  buildExprs();
+}
+
+void JointPosEqConstraint::buildExprs()
+{
+  expr_vec_.clear();
   for (int i = first_step_; i <= last_step_; ++i)
   {
-    for (int j = 0; j < vars.cols(); ++j)
+    for (int j = 0; j < vars_.cols(); ++j)
     {
       // pos = x1 - targ
       sco::AffExpr pos;
-      sco::exprInc(pos, sco::exprMult(vars(i, j), 1));
+      sco::exprInc(pos, sco::exprMult(vars_(i, j), 1));
       sco::exprDec(pos, targets_[j]);
       // expr_ = coeff * vel - Not squared b/c QuadExpr cnt not yet supported (TODO)
       expr_vec_.push_back(sco::exprMult(pos, coeffs_[j]));
@@ -155,13 +314,8 @@ JointPosEqConstraint::JointPosEqConstraint(const VarArray& vars,
 
 DblVec JointPosEqConstraint::value(const DblVec& xvec)
 {
-  // Convert vector from optimization to trajectory
-  Eigen::MatrixXd traj = getTraj(xvec, vars_);
-  // Takes diff b/n the subsequent rows and subtract each row by the targets_ vector
-  Eigen::MatrixXd diff =
-      (traj.block(first_step_, 0, last_step_ - first_step_ + 1, traj.cols())).rowwise() - targets_.transpose();
-  // Squares it, multiplies it by a diagonal matrix of coefficients, and converts to vector
-  return util::toDblVec((diff.array().square()).matrix() * coeffs_.asDiagonal());
+  TrajArray buffer;
+  return eqConstraintValue(traj_view_.map(xvec, buffer), POS_STENCIL, first_step_, last_step_, coeffs_, targets_);
 }
 sco::ConvexConstraints::Ptr JointPosEqConstraint::convex(const DblVec& /*x*/, sco::Model* model)
 {
@@ -188,27 +342,41 @@ JointPosIneqConstraint::JointPosIneqConstraint(const VarArray& vars,
   , targets_(targets)
   , first_step_(first_step)
   , last_step_(last_step)
+  , traj_view_(vars)
+{
+  buildExprs();
+}
+
+void JointPosIneqConstraint::setTargets(const Eigen::VectorXd& targets)
+{
+  checkTargetSize(targets, vars_);
+  targets_ = targets;
+  buildExprs();
+}
+
+void JointPosIneqConstraint::buildExprs()
 {
+  expr_vec_.clear();
   for (int i = first_step_; i <= last_step_; ++i)
   {
-    for (int j = 0; j < vars.cols(); ++j)
+    for (int j = 0; j < vars_.cols(); ++j)
     {
       sco::AffExpr expr;
       sco::AffExpr expr_neg;
       // pos = x1 - targ
       sco::AffExpr pos;
-      sco::exprInc(pos, sco::exprMult(vars(i, j), 1));
+      sco::exprInc(pos, sco::exprMult(vars_(i, j), 1));
       sco::exprDec(pos, targets_[j]);
       sco::exprInc(expr, upper_tols_[j]);  // expr_ = upper_tol
 
       // Form upper limit expr = - (upper_tol-(vel-targ))
-      sco::exprDec(expr, pos);           // expr = upper_tol_- (vel - targets_)
-      sco::exprScale(expr, -coeffs[j]);  // expr = - (upper_tol_- (vel - targets_)) * coeffs_
+      sco::exprDec(expr, pos);            // expr = upper_tol_- (vel - targets_)
+      sco::exprScale(expr, -coeffs_[j]);  // expr = - (upper_tol_- (vel - targets_)) * coeffs_
       expr_vec_.push_back(expr);
 
       // Form lower limit expr = (upper_tol-(vel-targ))
-      sco::exprDec(expr_neg, pos);          // expr = lower_tol_- (vel - targets_)
-      sco::exprScale(expr_neg, coeffs[j]);  // expr = (lower_tol_- (vel - targets_)) * coeffs_
+      sco::exprDec(expr_neg, pos);           // expr = lower_tol_- (vel - targets_)
+      sco::exprScale(expr_neg, coeffs_[j]);  // expr = (lower_tol_- (vel - targets_)) * coeffs_
       expr_vec_.push_back(expr_neg);
     }
   }
@@ -216,19 +384,9 @@ JointPosIneqConstraint::JointPosIneqConstraint(const VarArray& vars,
 
 DblVec JointPosIneqConstraint::value(const DblVec& xvec)
 {
-  // Convert vector from optimization to trajectory
-  Eigen::MatrixXd traj = getTraj(xvec, vars_);
-  // Takes diff b/n the subsequent rows to get velocity
-  Eigen::MatrixXd pos = diffAxis0(traj.block(first_step_, 0, last_step_ - first_step_ + 1, traj.cols()));
-  // Subtract targets to center about 0 and then subtract from tolerance
-  Eigen::MatrixXd diff0 = (pos.rowwise() - targets_.transpose());
-  Eigen::MatrixXd diff1 = (diff0.rowwise() - upper_tols_.transpose()) * coeffs_.asDiagonal();
-  Eigen::MatrixXd diff2 = ((diff0 * -1).rowwise() + lower_tols_.transpose()) * coeffs_.asDiagonal();
-  // Applies hinge, multiplies it by a diagonal matrix of coefficients, sums each corresponding value, and converts to
-  // vector
-  Eigen::MatrixXd out(diff1.rows(), diff1.cols() + diff2.cols());
-  out << diff1, diff2;
-  return util::toDblVec(out);
+  TrajArray buffer;
+  return ineqConstraintValue(
+      traj_view_.map(xvec, buffer), POS_STENCIL, first_step_, last_step_, coeffs_, targets_, upper_tols_, lower_tols_);
 }
 
 sco::ConvexConstraints::Ptr JointPosIneqConstraint::convex(const DblVec& /*x*/, sco::Model* model)
@@ -249,7 +407,13 @@ JointVelEqCost::JointVelEqCost(const VarArray& vars,
                                const Eigen::VectorXd& targets,
                                int& first_step,
                                int& last_step)
-  : Cost("JointVelEq"), vars_(vars), coeffs_(coeffs), targets_(targets), first_step_(first_step), last_step_(last_step)
+  : Cost("JointVelEq")
+  , vars_(vars)
+  , coeffs_(coeffs)
+  , targets_(targets)
+  , first_step_(first_step)
+  , last_step_(last_step)
+  , traj_view_(vars)
 {
   for (int i = first_step_; i <= last_step_ - 1; ++i)
   {
@@ -267,13 +431,8 @@ JointVelEqCost::JointVelEqCost(const VarArray& vars,
 }
 double JointVelEqCost::value(const DblVec& xvec)
 {
-  // Convert vector from optimization to trajectory
-  Eigen::MatrixXd traj = (getTraj(xvec, vars_));
-  // Takes diff b/n the subsequent rows and subtract each row by the targets_ vector
-  Eigen::MatrixXd diff = (diffAxis0(traj.block(first_step_, 0, last_step_ - first_step_ + 1, traj.cols()))).rowwise() -
-                         targets_.transpose();
-  // Element-wise square it, multiply it by a diagonal matrix of coefficients, and sums output
-  return (diff.array().square().matrix() * coeffs_.asDiagonal()).sum();
+  TrajArray buffer;
+  return eqCostValue(traj_view_.map(xvec, buffer), VEL_STENCIL, first_step_, last_step_, coeffs_, targets_);
 }
 sco::ConvexObjective::Ptr JointVelEqCost::convex(const DblVec& /*x*/, sco::Model* model)
 {
@@ -297,6 +456,7 @@ JointVelIneqCost::JointVelIneqCost(const VarArray& vars,
   , targets_(targets)
   , first_step_(first_step)
   , last_step_(last_step)
+  , traj_view_(vars)
 {
   for (int i = first_step_; i <= last_step_ - 1; ++i)
   {
@@ -304,50 +464,29 @@ JointVelIneqCost::JointVelIneqCost(const VarArray& vars,
     {
       // vel = (x2 - x1) - targ
       sco::AffExpr vel;
-      sco::AffExpr expr;
-      sco::AffExpr expr_neg;
       sco::exprInc(vel, sco::exprMult(vars(i, j), -1));
       sco::exprInc(vel, sco::exprMult(vars(i + 1, j), 1));
       sco::exprDec(vel, targets_[j]);  // offset to center about 0
-
-      // Form upper limit expr = - (upper_tol-(vel-targ))
-      sco::exprInc(expr, upper_tols_[j]);  // expr_ = upper_tol
-      sco::exprDec(expr, vel);             // expr = upper_tol_- (vel - targets_)
-      sco::exprScale(expr, -coeffs[j]);    // expr = - (upper_tol_- (vel - targets_)) * coeffs_
-      expr_vec_.push_back(expr);
-
-      // Form lower limit expr =  (upper_tol-(vel-targ))
-      sco::exprInc(expr_neg, lower_tols_[j]);  // expr_ = lower_tol_
-      sco::exprDec(expr_neg, vel);             // expr = lower_tol_- (vel - targets_)
-      sco::exprScale(expr_neg, coeffs[j]);     // expr = (lower_tol_- (vel - targets_)) * coeffs_
-      expr_vec_.push_back(expr_neg);
+      expr_vec_.push_back(vel);
     }
   }
 }
 
 double JointVelIneqCost::value(const DblVec& xvec)
 {
-  // Convert vector from optimization to trajectory
-  Eigen::MatrixXd traj = getTraj(xvec, vars_);
-  // Takes diff b/n the subsequent rows to get velocity
-  Eigen::MatrixXd vel = diffAxis0(traj.block(first_step_, 0, last_step_ - first_step_ + 1, traj.cols()));
-  // Subtract targets_ to center about 0 and then subtract from tolerance
-  Eigen::MatrixXd diff0 = (vel.rowwise() - targets_.transpose());
-  Eigen::MatrixXd diff1 = (diff0.rowwise() - upper_tols_.transpose()) * coeffs_.asDiagonal();
-  Eigen::MatrixXd diff2 = ((diff0 * -1).rowwise() + lower_tols_.transpose()) * coeffs_.asDiagonal();
-  // Applies hinge, multiplies it by a diagonal matrix of coefficients, sums each corresponding value, and converts to
-  // vector
-  return diff1.cwiseMax(0).sum() + diff2.cwiseMax(0).sum();
+  TrajArray buffer;
+  return ineqCostValue(
+      traj_view_.map(xvec, buffer), VEL_STENCIL, first_step_, last_step_, coeffs_, targets_, upper_tols_, lower_tols_);
 }
 
 sco::ConvexObjective::Ptr JointVelIneqCost::convex(const DblVec& /*x*/, sco::Model* model)
 {
   sco::ConvexObjective::Ptr out(new sco::ConvexObjective(model));
-  // Add hinge cost. Set the coefficient to 1 here since we include it in the AffExpr already
-  // This is necessary since we want a seperate coefficient per joint
-  for (sco::AffExpr& expr : expr_vec_)
+  // Upper and lower tolerances of each element share one auxiliary variable. A separate coefficient is used per joint
+  for (std::size_t i = 0; i < expr_vec_.size(); ++i)
   {
-    out->addHinge(expr, 1);
+    const Eigen::Index j = static_cast<Eigen::Index>(i) % vars_.cols();
+    out->addSoftBound(expr_vec_[i], lower_tols_[j], upper_tols_[j], coeffs_[j]);
   }
   return out;
 }
@@ -363,6 +502,7 @@ JointVelEqConstraint::JointVelEqConstraint(const VarArray& vars,
   , targets_(targets)
   , first_step_(first_step)
   , last_step_(last_step)
+  , traj_view_(vars)
 {
   for (int i = first_step_; i <= last_step_ - 1; ++i)
   {
@@ -381,13 +521,8 @@ JointVelEqConstraint::JointVelEqConstraint(const VarArray& vars,
 
 DblVec JointVelEqConstraint::value(const DblVec& xvec)
 {
-  // Convert vector from optimization to trajectory
-  Eigen::MatrixXd traj = getTraj(xvec, vars_);
-  // Takes diff b/n the subsequent rows and subtract each row by the targets_ vector
-  Eigen::MatrixXd diff = (diffAxis0(traj.block(first_step_, 0, last_step_ - first_step_ + 1, traj.cols()))).rowwise() -
-                         targets_.transpose();
-  // Squares it, multiplies it by a diagonal matrix of coefficients, and converts to vector
-  return util::toDblVec((diff.array().square()).matrix() * coeffs_.asDiagonal());
+  TrajArray buffer;
+  return eqConstraintValue(traj_view_.map(xvec, buffer), VEL_STENCIL, first_step_, last_step_, coeffs_, targets_);
 }
 sco::ConvexConstraints::Ptr JointVelEqConstraint::convex(const DblVec& /*x*/, sco::Model* model)
 {
@@ -414,6 +549,7 @@ JointVelIneqConstraint::JointVelIneqConstraint(const VarArray& vars,
   , targets_(targets)
   , first_step_(first_step)
   , last_step_(last_step)
+  , traj_view_(vars)
 {
   for (int i = first_step_; i <= last_step_ - 1; ++i)
   {
@@ -444,19 +580,9 @@ JointVelIneqConstraint::JointVelIneqConstraint(const VarArray& vars,
 
 DblVec JointVelIneqConstraint::value(const DblVec& xvec)
 {
-  // Convert vector from optimization to trajectory
-  Eigen::MatrixXd traj = getTraj(xvec, vars_);
-  // Takes diff b/n the subsequent rows to get velocity
-  Eigen::MatrixXd vel = diffAxis0(traj.block(first_step_, 0, last_step_ - first_step_ + 1, traj.cols()));
-  // Subtract targets_ to center about 0 and then subtract from tolerance
-  Eigen::MatrixXd diff0 = (vel.rowwise() - targets_.transpose());
-  Eigen::MatrixXd diff1 = (diff0.rowwise() - upper_tols_.transpose()) * coeffs_.asDiagonal();
-  Eigen::MatrixXd diff2 = ((diff0 * -1).rowwise() + lower_tols_.transpose()) * coeffs_.asDiagonal();
-  // Applies hinge, multiplies it by a diagonal matrix of coefficients, sums each corresponding value, and converts to
-  // vector
-  Eigen::MatrixXd out(diff1.rows(), diff1.cols() + diff2.cols());
-  out << diff1, diff2;
-  return util::toDblVec(out.cwiseMax(0));
+  TrajArray buffer;
+  return ineqConstraintValue(
+      traj_view_.map(xvec, buffer), VEL_STENCIL, first_step_, last_step_, coeffs_, targets_, upper_tols_, lower_tols_);
 }
 
 sco::ConvexConstraints::Ptr JointVelIneqConstraint::convex(const DblVec& /*x*/, sco::Model* model)
@@ -477,7 +603,13 @@ JointAccEqCost::JointAccEqCost(const VarArray& vars,
                                const Eigen::VectorXd& targets,
                                int& first_step,
                                int& last_step)
-  : Cost("JointAccEq"), vars_(vars), coeffs_(coeffs), targets_(targets), first_step_(first_step), last_step_(last_step)
+  : Cost("JointAccEq")
+  , vars_(vars)
+  , coeffs_(coeffs)
+  , targets_(targets)
+  , first_step_(first_step)
+  , last_step_(last_step)
+  , traj_view_(vars)
 {
   for (int i = first_step_; i <= last_step_ - 2; ++i)
   {
@@ -497,14 +629,8 @@ JointAccEqCost::JointAccEqCost(const VarArray& vars,
 }
 double JointAccEqCost::value(const DblVec& xvec)
 {
-  // Convert vector from optimization to trajectory
-  Eigen::MatrixXd traj = (getTraj(xvec, vars_));
-  // Takes diff b/n the subsequent rows and subtract each row by the targets_ vector
-  Eigen::MatrixXd diff =
-      (diffAxis0(diffAxis0(traj.block(first_step_, 0, last_step_ - first_step_ + 1, traj.cols())))).rowwise() -
-      targets_.transpose();
-  // Element-wise square it, multiply it by a diagonal matrix of coefficients, and sums output
-  return (diff.array().square().matrix() * coeffs_.asDiagonal()).sum();
+  TrajArray buffer;
+  return eqCostValue(traj_view_.map(xvec, buffer), ACC_STENCIL, first_step_, last_step_, coeffs_, targets_);
 }
 sco::ConvexObjective::Ptr JointAccEqCost::convex(const DblVec& /*x*/, sco::Model* model)
 {
@@ -528,6 +654,7 @@ JointAccIneqCost::JointAccIneqCost(const VarArray& vars,
   , targets_(targets)
   , first_step_(first_step)
   , last_step_(last_step)
+  , traj_view_(vars)
 {
   for (int i = first_step_; i <= last_step_ - 2; ++i)
   {
@@ -535,51 +662,30 @@ JointAccIneqCost::JointAccIneqCost(const VarArray& vars,
     {
       // acc = (x3 - 2*x2 + x1) - targ
       sco::AffExpr acc;
-      sco::AffExpr expr;
-      sco::AffExpr expr_neg;
       sco::exprInc(acc, sco::exprMult(vars(i, j), 1.0));
       sco::exprInc(acc, sco::exprMult(vars(i + 1, j), -2.0));
       sco::exprInc(acc, sco::exprMult(vars(i + 2, j), 1.0));
       sco::exprDec(acc, targets_[j]);  // offset to center about 0
-
-      // Form upper limit expr = - (upper_tol-(acc-targ))
-      sco::exprInc(expr, upper_tols_[j]);  // expr_ = upper_tol
-      sco::exprDec(expr, acc);             // expr = upper_tol_- (vel - targets_)
-      sco::exprScale(expr, -coeffs[j]);    // expr = - (upper_tol_- (vel - targets_)) * coeffs_
-      expr_vec_.push_back(expr);
-
-      // Form lower limit expr = (lower_tol-(acc-targ))
-      sco::exprInc(expr_neg, lower_tols_[j]);  // expr_ = lower_tol_
-      sco::exprDec(expr_neg, acc);             // expr = lower_tol_- (vel - targets_)
-      sco::exprScale(expr_neg, coeffs[j]);     // expr = (lower_tol_- (vel - targets_)) * coeffs_
-      expr_vec_.push_back(expr_neg);
+      expr_vec_.push_back(acc);
     }
   }
 }
 
 double JointAccIneqCost::value(const DblVec& xvec)
 {
-  // Convert vector from optimization to trajectory
-  Eigen::MatrixXd traj = getTraj(xvec, vars_);
-  // Takes diff b/n the subsequent rows to get velocity
-  Eigen::MatrixXd acc = diffAxis0(diffAxis0(traj.block(first_step_, 0, last_step_ - first_step_ + 1, traj.cols())));
-  // Subtract targets_ to center about 0 and then subtract from tolerance
-  Eigen::MatrixXd diff0 = (acc.rowwise() - targets_.transpose());
-  Eigen::MatrixXd diff1 = (diff0.rowwise() - upper_tols_.transpose()) * coeffs_.asDiagonal();
-  Eigen::MatrixXd diff2 = ((diff0 * -1).rowwise() + lower_tols_.transpose()) * coeffs_.asDiagonal();
-  // Applies hinge, multiplies it by a diagonal matrix of coefficients, sums each corresponding value, and converts to
-  // vector
-  return diff1.cwiseMax(0).sum() + diff2.cwiseMax(0).sum();
+  TrajArray buffer;
+  return ineqCostValue(
+      traj_view_.map(xvec, buffer), ACC_STENCIL, first_step_, last_step_, coeffs_, targets_, upper_tols_, lower_tols_);
 }
 
 sco::ConvexObjective::Ptr JointAccIneqCost::convex(const DblVec& /*x*/, sco::Model* model)
 {
   sco::ConvexObjective::Ptr out(new sco::ConvexObjective(model));
-  // Add hinge cost. Set the coefficient to 1 here since we include it in the AffExpr already
-  // This is necessary since we want a seperate coefficient per joint
-  for (sco::AffExpr& expr : expr_vec_)
+  // Upper and lower tolerances of each element share one auxiliary variable. A separate coefficient is used per joint
+  for (std::size_t i = 0; i < expr_vec_.size(); ++i)
   {
-    out->addHinge(expr, 1);
+    const Eigen::Index j = static_cast<Eigen::Index>(i) % vars_.cols();
+    out->addSoftBound(expr_vec_[i], lower_tols_[j], upper_tols_[j], coeffs_[j]);
   }
   return out;
 }
@@ -595,6 +701,7 @@ JointAccEqConstraint::JointAccEqConstraint(const VarArray& vars,
   , targets_(targets)
   , first_step_(first_step)
   , last_step_(last_step)
+  , traj_view_(vars)
 {
   for (int i = first_step_; i <= last_step_ - 2; ++i)
   {
@@ -615,14 +722,8 @@ JointAccEqConstraint::JointAccEqConstraint(const VarArray& vars,
 
 DblVec JointAccEqConstraint::value(const DblVec& xvec)
 {
-  // Convert vector from optimization to trajectory
-  Eigen::MatrixXd traj = getTraj(xvec, vars_);
-  // Takes diff b/n the subsequent rows and subtract each row by the targets_ vector
-  Eigen::MatrixXd diff =
-      (diffAxis0(diffAxis0(traj.block(first_step_, 0, last_step_ - first_step_ + 1, traj.cols())))).rowwise() -
-      targets_.transpose();
-  // Squares it, multiplies it by a diagonal matrix of coefficients, and converts to vector
-  return util::toDblVec((diff.array().square()).matrix() * coeffs_.asDiagonal());
+  TrajArray buffer;
+  return eqConstraintValue(traj_view_.map(xvec, buffer), ACC_STENCIL, first_step_, last_step_, coeffs_, targets_);
 }
 sco::ConvexConstraints::Ptr JointAccEqConstraint::convex(const DblVec& /*x*/, sco::Model* model)
 {
@@ -649,6 +750,7 @@ JointAccIneqConstraint::JointAccIneqConstraint(const VarArray& vars,
   , targets_(targets)
   , first_step_(first_step)
   , last_step_(last_step)
+  , traj_view_(vars)
 {
   // Form upper limit expr = - (upper_tol-(vel-targ))
   for (int i = first_step_; i <= last_step_ - 2; ++i)
@@ -681,19 +783,9 @@ JointAccIneqConstraint::JointAccIneqConstraint(const VarArray& vars,
 
 DblVec JointAccIneqConstraint::value(const DblVec& xvec)
 {
-  // Convert vector from optimization to trajectory
-  Eigen::MatrixXd traj = getTraj(xvec, vars_);
-  // Takes diff b/n the subsequent rows to get velocity
-  Eigen::MatrixXd acc = diffAxis0(diffAxis0(traj.block(first_step_, 0, last_step_ - first_step_ + 1, traj.cols())));
-  // Subtract targets_ to center about 0 and then subtract from tolerance
-  Eigen::MatrixXd diff0 = (acc.rowwise() - targets_.transpose());
-  Eigen::MatrixXd diff1 = (diff0.rowwise() - upper_tols_.transpose()) * coeffs_.asDiagonal();
-  Eigen::MatrixXd diff2 = ((diff0 * -1).rowwise() + lower_tols_.transpose()) * coeffs_.asDiagonal();
-  // Applies hinge, multiplies it by a diagonal matrix of coefficients, sums each corresponding value, and converts to
-  // vector
-  Eigen::MatrixXd out(diff1.rows(), diff1.cols() + diff2.cols());
-  out << diff1, diff2;
-  return util::toDblVec(out.cwiseMax(0));
+  TrajArray buffer;
+  return ineqConstraintValue(
+      traj_view_.map(xvec, buffer), ACC_STENCIL, first_step_, last_step_, coeffs_, targets_, upper_tols_, lower_tols_);
 }
 
 sco::ConvexConstraints::Ptr JointAccIneqConstraint::convex(const DblVec& /*x*/, sco::Model* model)
@@ -714,7 +806,13 @@ JointJerkEqCost::JointJerkEqCost(const VarArray& vars,
                                  const Eigen::VectorXd& targets,
                                  int& first_step,
                                  int& last_step)
-  : Cost("JointJerkEq"), vars_(vars), coeffs_(coeffs), targets_(targets), first_step_(first_step), last_step_(last_step)
+  : Cost("JointJerkEq")
+  , vars_(vars)
+  , coeffs_(coeffs)
+  , targets_(targets)
+  , first_step_(first_step)
+  , last_step_(last_step)
+  , traj_view_(vars)
 {
   for (int i = first_step_; i <= last_step_ - 4; ++i)
   {
@@ -735,15 +833,8 @@ JointJerkEqCost::JointJerkEqCost(const VarArray& vars,
 }
 double JointJerkEqCost::value(const DblVec& xvec)
 {
-  // Convert vector from optimization to trajectory
-  Eigen::MatrixXd traj = (getTraj(xvec, vars_));
-  // Takes diff b/n the subsequent rows and subtract each row by the targets_ vector
-  Eigen::MatrixXd diff =
-      (diffAxis0(diffAxis0(diffAxis0(traj.block(first_step_, 0, last_step_ - first_step_ + 1, traj.cols())))))
-          .rowwise() -
-      targets_.transpose();
-  // Element-wise square it, multiply it by a diagonal matrix of coefficients, and sums output
-  return (diff.array().square().matrix() * coeffs_.asDiagonal()).sum();
+  TrajArray buffer;
+  return eqCostValue(traj_view_.map(xvec, buffer), JERK_STENCIL, first_step_, last_step_, coeffs_, targets_);
 }
 sco::ConvexObjective::Ptr JointJerkEqCost::convex(const DblVec& /*x*/, sco::Model* model)
 {
@@ -767,60 +858,39 @@ JointJerkIneqCost::JointJerkIneqCost(const VarArray& vars,
   , targets_(targets)
   , first_step_(first_step)
   , last_step_(last_step)
+  , traj_view_(vars)
 {
   for (int i = first_step_; i <= last_step_ - 4; ++i)
   {
     for (int j = 0; j < vars.cols(); ++j)
     {
       sco::AffExpr jerk;
-      sco::AffExpr expr;
-      sco::AffExpr expr_neg;
       sco::exprInc(jerk, sco::exprMult(vars(i, j), -1.0 / 2.0));
       sco::exprInc(jerk, sco::exprMult(vars(i + 1, j), 1.0));
       sco::exprInc(jerk, sco::exprMult(vars(i + 2, j), 0.0));
       sco::exprInc(jerk, sco::exprMult(vars(i + 3, j), -1.0));
       sco::exprInc(jerk, sco::exprMult(vars(i + 4, j), 1.0 / 2.0));
-      sco::exprDec(jerk, targets_[j]);
-
-      // Form upper limit expr = - (upper_tol-(jerk-targ))
-      sco::exprInc(expr, upper_tols_[j]);  // expr_ = upper_tol
-      sco::exprDec(expr, jerk);            // expr = upper_tol_- (vel - targets_)
-      sco::exprScale(expr, -coeffs[j]);    // expr = - (upper_tol_- (vel - targets_)) * coeffs_
-      expr_vec_.push_back(expr);
-
-      // Form lower limit expr = (lower_tol-(acc-targ))
-      sco::exprInc(expr_neg, lower_tols_[j]);  // expr_ = lower_tol_
-      sco::exprDec(expr_neg, jerk);            // expr = lower_tol_- (vel - targets_)
-      sco::exprScale(expr_neg, coeffs[j]);     // expr = (lower_tol_- (vel - targets_)) * coeffs_
-      expr_vec_.push_back(expr_neg);
+      sco::exprDec(jerk, targets_[j]);  // offset to center about 0
+      expr_vec_.push_back(jerk);
     }
   }
 }
 
 double JointJerkIneqCost::value(const DblVec& xvec)
 {
-  // Convert vector from optimization to trajectory
-  Eigen::MatrixXd traj = getTraj(xvec, vars_);
-  // Takes diff b/n the subsequent rows to get velocity
-  Eigen::MatrixXd jerk =
-      diffAxis0(diffAxis0(diffAxis0(traj.block(first_step_, 0, last_step_ - first_step_ + 1, traj.cols()))));
-  // Subtract targets_ to center about 0 and then subtract from tolerance
-  Eigen::MatrixXd diff0 = (jerk.rowwise() - targets_.transpose());
-  Eigen::MatrixXd diff1 = (diff0.rowwise() - upper_tols_.transpose()) * coeffs_.asDiagonal();
-  Eigen::MatrixXd diff2 = ((diff0 * -1).rowwise() + lower_tols_.transpose()) * coeffs_.asDiagonal();
-  // Applies hinge, multiplies it by a diagonal matrix of coefficients, sums each corresponding value, and converts to
-  // vector
-  return diff1.cwiseMax(0).sum() + diff2.cwiseMax(0).sum();
+  TrajArray buffer;
+  return ineqCostValue(
+      traj_view_.map(xvec, buffer), JERK_STENCIL, first_step_, last_step_, coeffs_, targets_, upper_tols_, lower_tols_);
 }
 
 sco::ConvexObjective::Ptr JointJerkIneqCost::convex(const DblVec& /*x*/, sco::Model* model)
 {
   sco::ConvexObjective::Ptr out(new sco::ConvexObjective(model));
-  // Add hinge cost. Set the coefficient to 1 here since we include it in the AffExpr already
-  // This is necessary since we want a seperate coefficient per joint
-  for (sco::AffExpr& expr : expr_vec_)
+  // Upper and lower tolerances of each element share one auxiliary variable. A separate coefficient is used per joint
+  for (std::size_t i = 0; i < expr_vec_.size(); ++i)
   {
-    out->addHinge(expr, 1);
+    const Eigen::Index j = static_cast<Eigen::Index>(i) % vars_.cols();
+    out->addSoftBound(expr_vec_[i], lower_tols_[j], upper_tols_[j], coeffs_[j]);
   }
   return out;
 }
@@ -836,6 +906,7 @@ JointJerkEqConstraint::JointJerkEqConstraint(const VarArray& vars,
   , targets_(targets)
   , first_step_(first_step)
   , last_step_(last_step)
+  , traj_view_(vars)
 {
   for (int i = first_step_; i <= last_step_ - 4; ++i)
   {
@@ -857,15 +928,8 @@ JointJerkEqConstraint::JointJerkEqConstraint(const VarArray& vars,
 
 DblVec JointJerkEqConstraint::value(const DblVec& xvec)
 {
-  // Convert vector from optimization to trajectory
-  Eigen::MatrixXd traj = getTraj(xvec, vars_);
-  // Takes diff b/n the subsequent rows and subtract each row by the targets_ vector
-  Eigen::MatrixXd diff =
-      (diffAxis0(diffAxis0(diffAxis0(traj.block(first_step_, 0, last_step_ - first_step_ + 1, traj.cols())))))
-          .rowwise() -
-      targets_.transpose();
-  // Squares it, multiplies it by a diagonal matrix of coefficients, and converts to vector
-  return util::toDblVec((diff.array().square()).matrix() * coeffs_.asDiagonal());
+  TrajArray buffer;
+  return eqConstraintValue(traj_view_.map(xvec, buffer), JERK_STENCIL, first_step_, last_step_, coeffs_, targets_);
 }
 sco::ConvexConstraints::Ptr JointJerkEqConstraint::convex(const DblVec& /*x*/, sco::Model* model)
 {
@@ -892,6 +956,7 @@ JointJerkIneqConstraint::JointJerkIneqConstraint(const VarArray& vars,
   , targets_(targets)
   , first_step_(first_step)
   , last_step_(last_step)
+  , traj_view_(vars)
 {
   for (int i = first_step_; i <= last_step_ - 4; ++i)
   {
@@ -924,19 +989,9 @@ JointJerkIneqConstraint::JointJerkIneqConstraint(const VarArray& vars,
 
 DblVec JointJerkIneqConstraint::value(const DblVec& xvec)
 {
-  // Convert vector from optimization to trajectory
-  Eigen::MatrixXd traj = getTraj(xvec, vars_);
-  // Takes diff b/n the subsequent rows to get velocity
-  Eigen::MatrixXd acc = diffAxis0(diffAxis0(traj.block(first_step_, 0, last_step_ - first_step_ + 1, traj.cols())));
-  // Subtract targets_ to center about 0 and then subtract from tolerance
-  Eigen::MatrixXd diff0 = (acc.rowwise() - targets_.transpose());
-  Eigen::MatrixXd diff1 = (diff0.rowwise() - upper_tols_.transpose()) * coeffs_.asDiagonal();
-  Eigen::MatrixXd diff2 = ((diff0 * -1).rowwise() + lower_tols_.transpose()) * coeffs_.asDiagonal();
-  // Applies hinge, multiplies it by a diagonal matrix of coefficients, sums each corresponding value, and converts to
-  // vector
-  Eigen::MatrixXd out(diff1.rows(), diff1.cols() + diff2.cols());
-  out << diff1, diff2;
-  return util::toDblVec(out.cwiseMax(0));
+  TrajArray buffer;
+  return ineqConstraintValue(
+      traj_view_.map(xvec, buffer), JERK_STENCIL, first_step_, last_step_, coeffs_, targets_, upper_tols_, lower_tols_);
 }
 
 sco::ConvexConstraints::Ptr JointJerkIneqConstraint::convex(const DblVec& /*x*/, sco::Model* model)
@@ -0,0 +1,399 @@
+#include <trajopt_utils/macros.h>
+TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <boost/format.hpp>
+TRAJOPT_IGNORE_WARNINGS_POP
+
+#include <trajopt/trajectory_library.hpp>
+
+namespace trajopt
+{
+const char TrajectoryLibrary::MAGIC[8] = { 'T', 'J', 'T', 'R', 'L', 'I', 'B', '\0' };
+const uint32_t TrajectoryLibrary::VERSION;
+
+struct TrajectoryLibrary::Header
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t reserved;
+  uint64_t n_entries;
+  uint64_t key_size;
+  uint64_t n_steps;
+  uint64_t n_cols;
+  uint64_t keys_offset;
+  uint64_t trajs_offset;
+  uint64_t tree_offset;
+  uint64_t file_size;
+};
+
+namespace
+{
+uint64_t align8(uint64_t offset) { return (offset + 7) & ~uint64_t(7); }
+
+void writeAt(std::string& file, uint64_t offset, const void* data, size_t size)
+{
+  std::memcpy(&file[static_cast<size_t>(offset)], data, size);
+}
+
+/** @brief True if count values of value_size bytes starting at offset end at or before end, without overflowing */
+bool fitsBefore(uint64_t offset, uint64_t count, uint64_t value_size, uint64_t end)
+{
+  return offset <= end && offset % 8 == 0 && count <= (end - offset) / value_size;
+}
+
+/** @brief Stores a * b in product, returns false if it overflows */
+bool multiply(uint64_t a, uint64_t b, uint64_t& product)
+{
+  if (a != 0 && b > std::numeric_limits<uint64_t>::max() / a)
+    return false;
+  product = a * b;
+  return true;
+}
+}  // namespace
+
+TrajectoryLibrary::TrajectoryLibrary(const std::string& path)
+{
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    PRINT_AND_THROW(boost::format("failed to open trajectory library %s: %s") % path % std::strerror(errno));
+
+  struct stat st;
+  if (::fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(Header)))
+  {
+    ::close(fd);
+    PRINT_AND_THROW(boost::format("%s is not a trajectory library") % path);
+  }
+
+  size_ = static_cast<size_t>(st.st_size);
+  void* data = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (data == MAP_FAILED)
+    PRINT_AND_THROW(boost::format("failed to map trajectory library %s: %s") % path % std::strerror(errno));
+  data_ = static_cast<const char*>(data);
+
+  const Header& h = *reinterpret_cast<const Header*>(data_);
+  uint64_t n_keys = 0, n_traj_values = 0, n_tree_values = 0;
+  const char* error = nullptr;
+  if (std::memcmp(h.magic, MAGIC, sizeof(MAGIC)) != 0)
+    error = "is not a trajectory library";
+  else if (h.version != VERSION)
+    error = "has an unsupported version";
+  else if (h.file_size != size_ || h.keys_offset < sizeof(Header) || !multiply(h.n_entries, h.key_size, n_keys) ||
+           !multiply(h.n_steps, h.n_cols, n_traj_values) || !multiply(h.n_entries, n_traj_values, n_traj_values) ||
+           !multiply(h.n_entries, 2, n_tree_values) ||
+           !fitsBefore(h.keys_offset, n_keys, sizeof(double), h.trajs_offset) ||
+           !fitsBefore(h.trajs_offset, n_traj_values, sizeof(double), h.tree_offset) ||
+           !fitsBefore(h.tree_offset, n_tree_values, sizeof(uint64_t), size_))
+    error = "is truncated or corrupt";
+  else
+  {
+    // The tree is followed at query time without bounds checks, every entry and split dimension has to be valid
+    const uint64_t* order = reinterpret_cast<const uint64_t*>(data_ + h.tree_offset);
+    const uint64_t* split = order + h.n_entries;
+    for (uint64_t i = 0; i < h.n_entries && error == nullptr; ++i)
+    {
+      if (order[i] >= h.n_entries || split[i] >= h.key_size)
+        error = "has a corrupt search tree";
+    }
+  }
+
+  if (error != nullptr)
+  {
+    ::munmap(const_cast<char*>(data_), size_);
+    data_ = nullptr;
+    PRINT_AND_THROW(boost::format("trajectory library %s %s") % path % error);
+  }
+
+  n_entries_ = static_cast<size_t>(h.n_entries);
+  key_size_ = static_cast<size_t>(h.key_size);
+  n_steps_ = static_cast<size_t>(h.n_steps);
+  n_cols_ = static_cast<size_t>(h.n_cols);
+  tree_size_ = n_entries_;
+}
+
+TrajectoryLibrary::~TrajectoryLibrary()
+{
+  if (data_ != nullptr)
+    ::munmap(const_cast<char*>(data_), size_);
+}
+
+const double* TrajectoryLibrary::keys() const
+{
+  if (data_ == nullptr)
+    return keys_.data();
+  return reinterpret_cast<const double*>(data_ + reinterpret_cast<const Header*>(data_)->keys_offset);
+}
+
+const double* TrajectoryLibrary::trajs() const
+{
+  if (data_ == nullptr)
+    return trajs_.data();
+  return reinterpret_cast<const double*>(data_ + reinterpret_cast<const Header*>(data_)->trajs_offset);
+}
+
+const uint64_t* TrajectoryLibrary::treeOrder() const
+{
+  if (data_ == nullptr)
+    return tree_order_.data();
+  return reinterpret_cast<const uint64_t*>(data_ + reinterpret_cast<const Header*>(data_)->tree_offset);
+}
+
+const uint64_t* TrajectoryLibrary::treeSplit() const { return treeOrder() + tree_size_; }
+
+Eigen::Map<const Eigen::VectorXd> TrajectoryLibrary::key(size_t i) const
+{
+  return Eigen::Map<const Eigen::VectorXd>(keys() + i * key_size_, static_cast<Eigen::Index>(key_size_));
+}
+
+Eigen::Map<const TrajArray> TrajectoryLibrary::traj(size_t i) const
+{
+  return Eigen::Map<const TrajArray>(trajs() + i * n_steps_ * n_cols_,
+                                     static_cast<Eigen::Index>(n_steps_),
+                                     static_cast<Eigen::Index>(n_cols_));
+}
+
+void TrajectoryLibrary::unmap()
+{
+  if (data_ == nullptr)
+    return;
+
+  keys_.assign(keys(), keys() + n_entries_ * key_size_);
+  trajs_.assign(trajs(), trajs() + n_entries_ * n_steps_ * n_cols_);
+  tree_order_.assign(treeOrder(), treeOrder() + 2 * tree_size_);
+  ::munmap(const_cast<char*>(data_), size_);
+  data_ = nullptr;
+  size_ = 0;
+}
+
+Eigen::VectorXd TrajectoryLibrary::makeKey(const Eigen::VectorXd& start, const Eigen::VectorXd& goal) const
+{
+  Eigen::VectorXd key(start.size() + goal.size());
+  key << start, goal;
+  if (n_entries_ > 0 && static_cast<size_t>(key.size()) != key_size_)
+    PRINT_AND_THROW(boost::format("trajectory library keys have %i values, got a start and goal with %i") %
+                    key_size_ % key.size());
+  return key;
+}
+
+void TrajectoryLibrary::add(const Eigen::VectorXd& start, const Eigen::VectorXd& goal, const TrajArray& traj)
+{
+  Eigen::VectorXd key = makeKey(start, goal);
+  if (start.size() != traj.cols())
+    PRINT_AND_THROW(boost::format("start has %i values, the trajectory %i columns") % start.size() % traj.cols());
+  if (n_entries_ == 0)
+  {
+    key_size_ = static_cast<size_t>(key.size());
+    n_steps_ = static_cast<size_t>(traj.rows());
+    n_cols_ = static_cast<size_t>(traj.cols());
+  }
+  else if (static_cast<size_t>(traj.rows()) != n_steps_ || static_cast<size_t>(traj.cols()) != n_cols_)
+  {
+    PRINT_AND_THROW(boost::format("trajectory library trajectories are %ix%i, got %ix%i") % n_steps_ % n_cols_ %
+                    traj.rows() % traj.cols());
+  }
+
+  unmap();
+  keys_.insert(keys_.end(), key.data(), key.data() + key.size());
+  trajs_.insert(trajs_.end(), traj.data(), traj.data() + traj.size());
+  ++n_entries_;
+
+  // The tree is rebuilt when the linear scan over the new entries costs as much as the search of the tree
+  if (n_entries_ - tree_size_ > std::max<size_t>(32, tree_size_))
+    buildTree();
+}
+
+void TrajectoryLibrary::buildTree()
+{
+  tree_size_ = n_entries_;
+  tree_order_.resize(2 * tree_size_);
+  for (size_t i = 0; i < tree_size_; ++i)
+    tree_order_[i] = i;
+  buildTree(0, tree_size_);
+}
+
+void TrajectoryLibrary::buildTree(size_t lo, size_t hi)
+{
+  uint64_t* order = tree_order_.data();
+  uint64_t* split = order + tree_size_;
+  if (hi - lo <= 1)
+  {
+    if (hi > lo)
+      split[lo] = 0;
+    return;
+  }
+
+  // Split along the dimension with the largest spread
+  size_t dim = 0;
+  double max_spread = -1;
+  for (size_t d = 0; d < key_size_; ++d)
+  {
+    double lower = keys_[order[lo] * key_size_ + d];
+    double upper = lower;
+    for (size_t i = lo + 1; i < hi; ++i)
+    {
+      lower = std::min(lower, keys_[order[i] * key_size_ + d]);
+      upper = std::max(upper, keys_[order[i] * key_size_ + d]);
+    }
+    if (upper - lower > max_spread)
+    {
+      max_spread = upper - lower;
+      dim = d;
+    }
+  }
+
+  size_t mid = (lo + hi) / 2;
+  const DblVec& keys = keys_;
+  const size_t key_size = key_size_;
+  std::nth_element(order + lo, order + mid, order + hi, [&keys, key_size, dim](uint64_t a, uint64_t b) {
+    return keys[a * key_size + dim] < keys[b * key_size + dim];
+  });
+  split[mid] = dim;
+  buildTree(lo, mid);
+  buildTree(mid + 1, hi);
+}
+
+void TrajectoryLibrary::searchTree(const Eigen::VectorXd& key,
+                                   size_t k,
+                                   size_t lo,
+                                   size_t hi,
+                                   std::vector<std::pair<double, size_t>>& nearest) const
+{
+  if (lo >= hi)
+    return;
+
+  size_t mid = (lo + hi) / 2;
+  size_t entry = static_cast<size_t>(treeOrder()[mid]);
+  Eigen::Map<const Eigen::VectorXd> entry_key = this->key(entry);
+  double dist = (entry_key - key).squaredNorm();
+  if (nearest.size() < k || dist < nearest.front().first)
+  {
+    nearest.emplace_back(dist, entry);
+    std::push_heap(nearest.begin(), nearest.end());
+    if (nearest.size() > k)
+    {
+      std::pop_heap(nearest.begin(), nearest.end());
+      nearest.pop_back();
+    }
+  }
+
+  size_t dim = static_cast<size_t>(treeSplit()[mid]);
+  double diff = key[static_cast<Eigen::Index>(dim)] - entry_key[static_cast<Eigen::Index>(dim)];
+  bool left_first = diff < 0;
+  searchTree(key, k, left_first ? lo : mid + 1, left_first ? mid : hi, nearest);
+  if (nearest.size() < k || diff * diff < nearest.front().first)
+    searchTree(key, k, left_first ? mid + 1 : lo, left_first ? hi : mid, nearest);
+}
+
+std::vector<size_t> TrajectoryLibrary::query(const Eigen::VectorXd& start, const Eigen::VectorXd& goal, size_t k) const
+{
+  std::vector<size_t> out;
+  if (n_entries_ == 0 || k == 0)
+    return out;
+
+  Eigen::VectorXd key = makeKey(start, goal);
+
+  // Max heap of the k nearest entries found so far
+  std::vector<std::pair<double, size_t>> nearest;
+  nearest.reserve(k + 1);
+  searchTree(key, k, 0, tree_size_, nearest);
+  for (size_t i = tree_size_; i < n_entries_; ++i)
+  {
+    double dist = (this->key(i) - key).squaredNorm();
+    if (nearest.size() < k || dist < nearest.front().first)
+    {
+      nearest.emplace_back(dist, i);
+      std::push_heap(nearest.begin(), nearest.end());
+      if (nearest.size() > k)
+      {
+        std::pop_heap(nearest.begin(), nearest.end());
+        nearest.pop_back();
+      }
+    }
+  }
+
+  std::sort_heap(nearest.begin(), nearest.end());
+  for (const auto& n : nearest)
+    out.push_back(n.second);
+  return out;
+}
+
+TrajArray TrajectoryLibrary::seed(const Eigen::VectorXd& start, const Eigen::VectorXd& goal) const
+{
+  std::vector<size_t> nearest = query(start, goal, 1);
+  if (nearest.empty())
+    PRINT_AND_THROW("can not seed from an empty trajectory library");
+
+  TrajArray out = traj(nearest[0]);
+  Eigen::RowVectorXd offset = start.transpose() - out.row(0);
+  const Eigen::Index n_steps = out.rows();
+  for (Eigen::Index i = 0; i < n_steps; ++i)
+  {
+    double fade = (n_steps > 1) ? 1. - static_cast<double>(i) / static_cast<double>(n_steps - 1) : 1.;
+    out.row(i) += fade * offset;
+  }
+  return out;
+}
+
+void TrajectoryLibrary::save(const std::string& path) const
+{
+  // Entries added since the tree was built are not part of it, the saved tree covers all entries
+  std::vector<uint64_t> tree;
+  if (tree_size_ == n_entries_)
+  {
+    tree.assign(treeOrder(), treeOrder() + 2 * tree_size_);
+  }
+  else
+  {
+    TrajectoryLibrary copy;
+    copy.n_entries_ = n_entries_;
+    copy.key_size_ = key_size_;
+    copy.n_steps_ = n_steps_;
+    copy.n_cols_ = n_cols_;
+    copy.keys_.assign(keys(), keys() + n_entries_ * key_size_);
+    copy.buildTree();
+    tree = copy.tree_order_;
+  }
+
+  Header header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = VERSION;
+  header.n_entries = n_entries_;
+  header.key_size = key_size_;
+  header.n_steps = n_steps_;
+  header.n_cols = n_cols_;
+  header.keys_offset = align8(sizeof(Header));
+  header.trajs_offset = align8(header.keys_offset + n_entries_ * key_size_ * sizeof(double));
+  header.tree_offset = align8(header.trajs_offset + n_entries_ * n_steps_ * n_cols_ * sizeof(double));
+  header.file_size = header.tree_offset + tree.size() * sizeof(uint64_t);
+
+  std::string file(static_cast<size_t>(header.file_size), '\0');
+  writeAt(file, 0, &header, sizeof(header));
+  writeAt(file, header.keys_offset, keys(), n_entries_ * key_size_ * sizeof(double));
+  writeAt(file, header.trajs_offset, trajs(), n_entries_ * n_steps_ * n_cols_ * sizeof(double));
+  writeAt(file, header.tree_offset, tree.data(), tree.size() * sizeof(uint64_t));
+
+  std::string tmp_path = path + ".tmp";
+  std::FILE* stream = std::fopen(tmp_path.c_str(), "wb");
+  if (stream == nullptr)
+    PRINT_AND_THROW(boost::format("failed to open %s: %s") % tmp_path % std::strerror(errno));
+  bool written = std::fwrite(file.data(), 1, file.size(), stream) == file.size();
+  written = (std::fclose(stream) == 0) && written;
+  if (!written || std::rename(tmp_path.c_str(), path.c_str()) != 0)
+  {
+    std::remove(tmp_path.c_str());
+    PRINT_AND_THROW(boost::format("failed to write trajectory library %s") % path);
+  }
+}
+}  // namespace trajopt
@@ -1,5 +1,6 @@
 #include <trajopt_utils/macros.h>
 TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <algorithm>
 #include <Eigen/Geometry>
 #include <boost/format.hpp>
 TRAJOPT_IGNORE_WARNINGS_POP
@@ -35,6 +36,130 @@ TrajArray getTraj(const DblVec& x, const AffArray& arr)
   return out;
 }
 
+TrajArray shiftTraj(const TrajArray& traj, int n_shift)
+{
+  if (n_shift < 0)
+    PRINT_AND_THROW(boost::format("can not shift a trajectory by %i steps") % n_shift);
+
+  TrajArray out(traj.rows(), traj.cols());
+  for (long i = 0; i < traj.rows(); ++i)
+    out.row(i) = traj.row(std::min(i + n_shift, traj.rows() - 1));
+  return out;
+}
+
+TrajArrayView::TrajArrayView(const VarArray& vars) : vars_(vars)
+{
+  const int rows = vars.rows();
+  const int cols = vars.cols();
+  if (rows == 0 || cols == 0)
+    return;
+
+  offset_ = vars(0, 0).var_rep->index;
+  row_stride_ = (rows > 1) ? vars(1, 0).var_rep->index - offset_ : cols;
+
+  strided_ = (row_stride_ >= cols);
+  for (int i = 0; i < rows && strided_; ++i)
+  {
+    for (int j = 0; j < cols; ++j)
+    {
+      if (vars(i, j).var_rep->index != offset_ + i * row_stride_ + j)
+      {
+        strided_ = false;
+        break;
+      }
+    }
+  }
+}
+
+TrajArrayMap TrajArrayView::map(const DblVec& x, TrajArray& buffer) const
+{
+  if (strided_)
+  {
+    assert(static_cast<Eigen::Index>(x.size()) >= offset_ + (vars_.rows() - 1) * row_stride_ + vars_.cols());
+    return TrajArrayMap(x.data() + offset_, vars_.rows(), vars_.cols(), Eigen::OuterStride<>(row_stride_));
+  }
+
+  buffer.resize(vars_.rows(), vars_.cols());
+  for (int i = 0; i < vars_.rows(); ++i)
+    for (int j = 0; j < vars_.cols(); ++j)
+      buffer(i, j) = vars_(i, j).value(x);
+
+  return TrajArrayMap(buffer.data(), buffer.rows(), buffer.cols(), Eigen::OuterStride<>(buffer.cols()));
+}
+
+Eigen::Matrix3Xd calcRotationalErrors(const Eigen::Ref<const Eigen::Matrix<double, 9, Eigen::Dynamic>>& R)
+{
+  using Eigen::ArrayXd;
+  const Eigen::Index n = R.cols();
+
+  // One contiguous column per matrix entry so each operation below runs over the whole batch
+  const Eigen::Array<double, Eigen::Dynamic, 9> m = R.transpose().array();
+  const auto r00 = m.col(0), r10 = m.col(1), r20 = m.col(2);
+  const auto r01 = m.col(3), r11 = m.col(4), r21 = m.col(5);
+  const auto r02 = m.col(6), r12 = m.col(7), r22 = m.col(8);
+
+  // Shepperd's method: tw, tx, ty and tz are 4w^2, 4x^2, 4y^2 and 4z^2. The largest component is taken from its square
+  // root and the others from the off-diagonal terms, which keeps the conversion accurate for every angle. All four
+  // candidates are evaluated and the best is selected per rotation instead of branching. They sum to 4, so t >= 1.
+  const ArrayXd tw = 1 + r00 + r11 + r22;
+  const ArrayXd tx = 1 + r00 - r11 - r22;
+  const ArrayXd ty = 1 - r00 + r11 - r22;
+  const ArrayXd tz = 1 - r00 - r11 + r22;
+  const ArrayXd t = tw.max(tx).max(ty.max(tz));
+  const ArrayXd s = 0.5 / t.sqrt();
+
+  const ArrayXd wx = r21 - r12;  // 4wx
+  const ArrayXd wy = r02 - r20;  // 4wy
+  const ArrayXd wz = r10 - r01;  // 4wz
+  const ArrayXd xy = r01 + r10;  // 4xy
+  const ArrayXd xz = r02 + r20;  // 4xz
+  const ArrayXd yz = r12 + r21;  // 4yz
+
+  const auto is_w = (tw == t);
+  const auto is_x = (tx == t);
+  const auto is_y = (ty == t);
+  ArrayXd w = is_w.select(t, is_x.select(wx, is_y.select(wy, wz))) * s;
+  ArrayXd x = is_w.select(wx, is_x.select(t, is_y.select(xy, xz))) * s;
+  ArrayXd y = is_w.select(wy, is_x.select(xy, is_y.select(t, yz))) * s;
+  ArrayXd z = is_w.select(wz, is_x.select(xz, is_y.select(yz, t))) * s;
+
+  // Use the quaternion with w >= 0 so the angle is on [0, pi]
+  const ArrayXd sign = (w < 0).select(-ArrayXd::Ones(n), ArrayXd::Ones(n));
+  w = w.abs();
+  x *= sign;
+  y *= sign;
+  z *= sign;
+
+  // log(q) = axis * angle = v * 2 * atan2(|v|, w) / |v|, which tends to v * 2 / w as |v| goes to zero
+  const ArrayXd norm = (x.square() + y.square() + z.square()).sqrt();
+  const ArrayXd angle = 2 * (norm / w).atan();
+  const ArrayXd scale = (norm > 1e-8).select(angle / norm, 2 / w);
+
+  Eigen::Matrix3Xd out(3, n);
+  out.row(0) = (x * scale).matrix().transpose();
+  out.row(1) = (y * scale).matrix().transpose();
+  out.row(2) = (z * scale).matrix().transpose();
+  return out;
+}
+
+Eigen::Matrix<double, 6, Eigen::Dynamic> calcTransformErrors(const Eigen::Isometry3d& t1,
+                                                             const AlignedVector<Eigen::Isometry3d>& t2)
+{
+  const Eigen::Index n = static_cast<Eigen::Index>(t2.size());
+  const Eigen::Isometry3d t1_inv = t1.inverse();
+
+  Eigen::Matrix<double, 6, Eigen::Dynamic> out(6, n);
+  Eigen::Matrix<double, 9, Eigen::Dynamic> rotations(9, n);
+  for (Eigen::Index i = 0; i < n; ++i)
+  {
+    Eigen::Isometry3d pose_err = t1_inv * t2[static_cast<size_t>(i)];
+    out.col(i).head<3>() = pose_err.translation();
+    Eigen::Map<Eigen::Matrix3d>(rotations.col(i).data()) = pose_err.linear();
+  }
+  out.bottomRows<3>() = calcRotationalErrors(rotations);
+  return out;
+}
+
 void AddVarArrays(sco::OptProb& prob,
                   int rows,
                   const IntVec& cols,
@@ -0,0 +1,133 @@
+#include <trajopt_utils/macros.h>
+TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <Eigen/Core>
+TRAJOPT_IGNORE_WARNINGS_POP
+
+#include <trajopt/trajectory_costs.hpp>
+#include <trajopt/utils.hpp>
+#include <trajopt_sco/modeling.hpp>
+#include <trajopt_utils/clock.hpp>
+#include <trajopt_utils/logging.hpp>
+
+using namespace trajopt;
+using namespace std;
+using namespace util;
+
+namespace
+{
+/** @brief Reference implementation of the joint costs using a dense copy of the trajectory */
+Eigen::MatrixXd diffAxis0(const Eigen::MatrixXd& in)
+{
+  return in.middleRows(1, in.rows() - 1) - in.middleRows(0, in.rows() - 1);
+}
+
+double velIneqReference(const DblVec& x,
+                        const VarArray& vars,
+                        const Eigen::VectorXd& coeffs,
+                        const Eigen::VectorXd& targets,
+                        const Eigen::VectorXd& upper_tols,
+                        const Eigen::VectorXd& lower_tols)
+{
+  Eigen::MatrixXd traj = getTraj(x, vars);
+  Eigen::MatrixXd diff0 = diffAxis0(traj).rowwise() - targets.transpose();
+  Eigen::MatrixXd diff1 = (diff0.rowwise() - upper_tols.transpose()) * coeffs.asDiagonal();
+  Eigen::MatrixXd diff2 = ((diff0 * -1).rowwise() + lower_tols.transpose()) * coeffs.asDiagonal();
+  return diff1.cwiseMax(0).sum() + diff2.cwiseMax(0).sum();
+}
+
+double accEqReference(const DblVec& x,
+                      const VarArray& vars,
+                      const Eigen::VectorXd& coeffs,
+                      const Eigen::VectorXd& targets)
+{
+  Eigen::MatrixXd traj = getTraj(x, vars);
+  Eigen::MatrixXd diff = diffAxis0(diffAxis0(traj)).rowwise() - targets.transpose();
+  return (diff.array().square().matrix() * coeffs.asDiagonal()).sum();
+}
+}  // namespace
+
+/**
+ * @brief Reports the time per value() call of the strided joint costs and of the dense getTraj reference for a range
+ * of trajectory sizes, with and without a time column, which changes the row stride of the variables.
+ *
+ * The values are checked against the reference, the benchmark returns 1 if they differ.
+ */
+int main(int /*argc*/, char** /*argv*/)
+{
+  gLogLevel = util::LevelError;
+  const int n_evals = 200;
+  int n_mismatches = 0;
+
+  for (bool use_time : { false, true })
+  {
+    printf("use_time %d\n%8s %6s %14s %14s %14s %14s\n",
+           use_time,
+           "n_steps",
+           "n_dof",
+           "vel_ref [us]",
+           "vel [us]",
+           "acc_ref [us]",
+           "acc [us]");
+    for (int n_steps : { 10, 50, 200, 1000 })
+    {
+      for (int n_dof : { 6, 7, 14 })
+      {
+        sco::OptProb prob;
+        VarArray all_vars;
+        AddVarArray(prob, n_steps, use_time ? n_dof + 1 : n_dof, "j", all_vars);
+        VarArray vars = all_vars.block(0, 0, n_steps, n_dof);
+
+        DblVec x(static_cast<size_t>(prob.getNumVars()));
+        for (size_t i = 0; i < x.size(); ++i)
+          x[i] = std::sin(0.1 * static_cast<double>(i));
+
+        Eigen::VectorXd coeffs = Eigen::VectorXd::LinSpaced(n_dof, 1, 2);
+        Eigen::VectorXd targets = Eigen::VectorXd::Constant(n_dof, 0.01);
+        Eigen::VectorXd upper_tols = Eigen::VectorXd::Constant(n_dof, 0.05);
+        Eigen::VectorXd lower_tols = Eigen::VectorXd::Constant(n_dof, -0.05);
+        int first_step = 0;
+        int last_step = n_steps - 1;
+
+        JointVelIneqCost vel_cost(vars, coeffs, targets, upper_tols, lower_tols, first_step, last_step);
+        JointAccEqCost acc_cost(vars, coeffs, targets, first_step, last_step);
+
+        double vel_ref = velIneqReference(x, vars, coeffs, targets, upper_tols, lower_tols);
+        double acc_ref = accEqReference(x, vars, coeffs, targets);
+        if (std::abs(vel_cost.value(x) - vel_ref) > 1e-9 * std::max(1.0, std::abs(vel_ref)) ||
+            std::abs(acc_cost.value(x) - acc_ref) > 1e-9 * std::max(1.0, std::abs(acc_ref)))
+        {
+          printf("value differs from the reference for %d steps and %d dof\n", n_steps, n_dof);
+          ++n_mismatches;
+        }
+
+        double sink = 0;
+        double t0 = GetClock();
+        for (int i = 0; i < n_evals; ++i)
+          sink += velIneqReference(x, vars, coeffs, targets, upper_tols, lower_tols);
+        double t1 = GetClock();
+        for (int i = 0; i < n_evals; ++i)
+          sink += vel_cost.value(x);
+        double t2 = GetClock();
+        for (int i = 0; i < n_evals; ++i)
+          sink += accEqReference(x, vars, coeffs, targets);
+        double t3 = GetClock();
+        for (int i = 0; i < n_evals; ++i)
+          sink += acc_cost.value(x);
+        double t4 = GetClock();
+
+        printf("%8d %6d %14.3f %14.3f %14.3f %14.3f%s\n",
+               n_steps,
+               n_dof,
+               1e6 * (t1 - t0) / n_evals,
+               1e6 * (t2 - t1) / n_evals,
+               1e6 * (t3 - t2) / n_evals,
+               1e6 * (t4 - t3) / n_evals,
+               std::isfinite(sink) ? "" : " (not finite)");
+      }
+    }
+  }
+  return (n_mismatches == 0) ? 0 : 1;
+}
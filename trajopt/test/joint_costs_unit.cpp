@@ -139,6 +139,141 @@ TEST_F(CostsTest, equality_jointPos)
   CONSOLE_BRIDGE_logDebug("planning time: %.3f", GetClock() - tStart);
 }
 
+/**
+ * @brief Tests changing the jointPos targets of a constructed problem
+ *
+ * Solves the problem of equality_jointPos, then moves the cost and constraint targets with SetJointPosTargets and
+ * checks that optimizing the same problem again reaches the new targets.
+ */
+TEST_F(CostsTest, retarget_jointPos)
+{
+  CONSOLE_BRIDGE_logDebug("CostsTest, retarget_jointPos");
+
+  const double cost_tol = 0.01;
+  const double cnt_tol = 0.0001;
+
+  ProblemConstructionInfo pci(tesseract_);
+  pci.basic_info.n_steps = 10;
+  pci.basic_info.manip = "right_arm";
+  pci.basic_info.start_fixed = false;
+  pci.kin = tesseract_->getFwdKinematicsManagerConst()->getFwdKinematicSolver(pci.basic_info.manip);
+
+  Eigen::VectorXd start_pos = pci.env->getCurrentJointValues(pci.kin->getJointNames());
+  pci.init_info.type = InitInfo::STATIONARY;
+  pci.init_info.data = start_pos.transpose().replicate(pci.basic_info.n_steps, 1);
+
+  std::shared_ptr<JointPosTermInfo> jv = std::shared_ptr<JointPosTermInfo>(new JointPosTermInfo);
+  jv->coeffs = std::vector<double>(7, 10.0);
+  jv->targets = std::vector<double>(7, 0.0);
+  jv->first_step = 0;
+  jv->last_step = 0;
+  jv->name = "joint_pos_single";
+  jv->term_type = TT_CNT;
+  pci.cnt_infos.push_back(jv);
+
+  std::shared_ptr<JointPosTermInfo> jv2 = std::shared_ptr<JointPosTermInfo>(new JointPosTermInfo);
+  jv2->coeffs = std::vector<double>(7, 10.0);
+  jv2->targets = std::vector<double>(7, -0.1);
+  jv2->first_step = 0;
+  jv2->last_step = pci.basic_info.n_steps - 1;
+  jv2->name = "joint_pos_all";
+  jv2->term_type = TT_COST;
+  pci.cost_infos.push_back(jv2);
+
+  TrajOptProb::Ptr prob = ConstructProblem(pci);
+  ASSERT_TRUE(!!prob);
+
+  {
+    sco::BasicTrustRegionSQP opt(prob);
+    opt.initialize(trajToDblVec(prob->GetInitTraj()));
+    opt.optimize();
+  }
+
+  const double cnt_targ = 0.2;
+  const double cost_targ = 0.1;
+  prob->SetJointPosTargets("joint_pos_single", Eigen::VectorXd::Constant(7, cnt_targ));
+  prob->SetJointPosTargets("joint_pos_all", Eigen::VectorXd::Constant(7, cost_targ));
+  EXPECT_ANY_THROW(prob->SetJointPosTargets("no_such_term", Eigen::VectorXd::Zero(7)));
+  EXPECT_ANY_THROW(prob->SetJointPosTargets("joint_pos_all", Eigen::VectorXd::Zero(6)));
+
+  sco::BasicTrustRegionSQP opt(prob);
+  opt.initialize(trajToDblVec(prob->GetInitTraj()));
+  opt.optimize();
+
+  TrajArray output = getTraj(opt.x(), prob->GetVars());
+  for (auto j = 0; j < output.cols(); ++j)
+    EXPECT_NEAR(output(0, j), cnt_targ, cnt_tol);
+  for (auto i = 1; i < output.rows(); ++i)
+  {
+    for (auto j = 0; j < output.cols(); ++j)
+      EXPECT_NEAR(output(i, j), cost_targ, cost_tol);
+  }
+}
+
+/**
+ * @brief Tests changing the start state of a constructed problem
+ *
+ * Solves a problem with a fixed start and a jointPos cost on the other timesteps, then moves the start with
+ * SetStartState and checks that optimizing the same problem again starts at the new state and still meets the cost.
+ */
+TEST_F(CostsTest, retarget_startState)
+{
+  CONSOLE_BRIDGE_logDebug("CostsTest, retarget_startState");
+
+  const double cost_targ = 0.1;
+  const double cost_tol = 0.01;
+  const double cnt_tol = 0.0001;
+
+  ProblemConstructionInfo pci(tesseract_);
+  pci.basic_info.n_steps = 10;
+  pci.basic_info.manip = "right_arm";
+  pci.basic_info.start_fixed = true;
+  pci.kin = tesseract_->getFwdKinematicsManagerConst()->getFwdKinematicSolver(pci.basic_info.manip);
+
+  Eigen::VectorXd start_pos = pci.env->getCurrentJointValues(pci.kin->getJointNames());
+  pci.init_info.type = InitInfo::STATIONARY;
+  pci.init_info.data = start_pos.transpose().replicate(pci.basic_info.n_steps, 1);
+
+  std::shared_ptr<JointPosTermInfo> jv = std::shared_ptr<JointPosTermInfo>(new JointPosTermInfo);
+  jv->coeffs = std::vector<double>(7, 10.0);
+  jv->targets = std::vector<double>(7, cost_targ);
+  jv->first_step = pci.basic_info.n_steps / 2;
+  jv->last_step = pci.basic_info.n_steps - 1;
+  jv->name = "joint_pos_end";
+  jv->term_type = TT_COST;
+  pci.cost_infos.push_back(jv);
+
+  TrajOptProb::Ptr prob = ConstructProblem(pci);
+  ASSERT_TRUE(!!prob);
+
+  {
+    sco::BasicTrustRegionSQP opt(prob);
+    opt.initialize(trajToDblVec(prob->GetInitTraj()));
+    opt.optimize();
+    TrajArray output = getTraj(opt.x(), prob->GetVars());
+    for (auto j = 0; j < output.cols(); ++j)
+      EXPECT_NEAR(output(0, j), start_pos(j), cnt_tol);
+  }
+
+  Eigen::VectorXd new_start = Eigen::VectorXd::Constant(7, -0.2);
+  prob->SetStartState(new_start);
+  EXPECT_ANY_THROW(prob->SetStartState(Eigen::VectorXd::Zero(6)));
+  EXPECT_TRUE(prob->GetInitTraj().row(0).isApprox(new_start.transpose()));
+
+  sco::BasicTrustRegionSQP opt(prob);
+  opt.initialize(trajToDblVec(prob->GetInitTraj()));
+  opt.optimize();
+
+  TrajArray output = getTraj(opt.x(), prob->GetVars());
+  for (auto j = 0; j < output.cols(); ++j)
+    EXPECT_NEAR(output(0, j), new_start(j), cnt_tol);
+  for (auto i = jv->first_step; i <= jv->last_step; ++i)
+  {
+    for (auto j = 0; j < output.cols(); ++j)
+      EXPECT_NEAR(output(i, j), cost_targ, cost_tol);
+  }
+}
+
 ////////////////////////////////////////////////////////////////////
 /**
  * @brief Tests inequality jointPos constraint
@@ -0,0 +1,130 @@
+#include <trajopt_utils/macros.h>
+TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+TRAJOPT_IGNORE_WARNINGS_POP
+
+#include <trajopt/json_codec.hpp>
+#include <trajopt_test_utils.hpp>
+#include <trajopt_utils/logging.hpp>
+
+using namespace json_marshal;
+
+namespace
+{
+std::string readFile(const std::string& fname)
+{
+  std::ifstream fh(fname.c_str());
+  std::stringstream ss;
+  ss << fh.rdbuf();
+  return ss.str();
+}
+
+Json::Value readWithJsonReader(const std::string& doc)
+{
+  Json::Value root;
+  Json::Reader reader;
+  EXPECT_TRUE(reader.parse(doc, root));
+  return root;
+}
+
+std::vector<std::string> testConfigs()
+{
+  std::vector<std::string> configs;
+  for (const char* config : { "arm_around_table.json",
+                              "arm_around_table_continuous.json",
+                              "arm_around_table_time.json",
+                              "box_cast_test.json",
+                              "numerical_ik1.json" })
+    configs.push_back(std::string(TRAJOPT_DIR) + "/test/data/config/" + config);
+  return configs;
+}
+}  // namespace
+
+/** @brief parseJson and the binary format must reproduce what Json::Reader reads from every test config */
+TEST(JsonCodec, RoundTripConfigs)
+{
+  std::vector<std::string> configs = testConfigs();
+  ASSERT_FALSE(configs.empty());
+  for (const std::string& config : configs)
+  {
+    SCOPED_TRACE(config);
+    std::string doc = readFile(config);
+    Json::Value expected = readWithJsonReader(doc);
+
+    Json::Value parsed = parseJson(doc);
+    EXPECT_EQ(expected, parsed);
+
+    std::string binary = toBinary(expected);
+    EXPECT_TRUE(isBinary(binary.data(), binary.size()));
+    EXPECT_FALSE(isBinary(doc.data(), doc.size()));
+    EXPECT_EQ(expected, fromBinary(binary));
+    EXPECT_EQ(binary, toBinary(fromBinary(binary)));
+  }
+}
+
+/** @brief Number types, escapes and comments are read the way Json::Reader reads them */
+TEST(JsonCodec, ValueTypes)
+{
+  const std::string doc = "// leading comment\n"
+                          "{ \"ints\" : [0, -1, 2147483647, 2147483648, -9223372036854775808, 18446744073709551615],\n"
+                          "  \"big\" : [18446744073709551616, -9223372036854775809],\n"
+                          "  \"doubles\" : [1.5, -0.25, 1e3, 2E-2, 1.0],\n"
+                          "  \"mixed\" : [1, 1.0, true, false, null, \"x\"],\n"
+                          "  /* block comment */ \"empty\" : [{}, []],\n"
+                          "  \"str\" : \"q\\\"b\\\\s\\/\\b\\f\\n\\r\\t\\u00e9\\ud83d\\ude00\" }";
+  Json::Value expected = readWithJsonReader(doc);
+  Json::Value parsed = parseJson(doc);
+  EXPECT_EQ(expected, parsed);
+
+  for (Json::ArrayIndex i = 0; i < expected["ints"].size(); ++i)
+    EXPECT_EQ(expected["ints"][i].type(), parsed["ints"][i].type());
+  for (Json::ArrayIndex i = 0; i < expected["big"].size(); ++i)
+    EXPECT_EQ(expected["big"][i].type(), parsed["big"][i].type());
+  EXPECT_EQ(expected["doubles"][4].type(), parsed["doubles"][4].type());
+
+  Json::Value decoded = fromBinary(toBinary(parsed));
+  EXPECT_EQ(parsed, decoded);
+  EXPECT_EQ(Json::intValue, decoded["ints"][0].type());
+  EXPECT_EQ(Json::uintValue, decoded["ints"][3].type());
+  EXPECT_EQ(Json::realValue, decoded["mixed"][1].type());
+}
+
+/** @brief The lenient numbers and the unterminated trailing comment that Json::Reader accepts are read the same way */
+TEST(JsonCodec, ReaderQuirks)
+{
+  for (const char* doc : { "[1.]", "[-1.e2]", "[-]", "[-.5]", "[01.]", "[1e-400]", "[1] /* unterminated" })
+  {
+    SCOPED_TRACE(doc);
+    Json::Value expected = readWithJsonReader(doc);
+    Json::Value parsed = parseJson(std::string(doc));
+    EXPECT_EQ(expected, parsed);
+    EXPECT_EQ(expected[0].type(), parsed[0].type());
+  }
+}
+
+/** @brief Malformed documents and truncated binary requests throw instead of returning a partial value */
+TEST(JsonCodec, Errors)
+{
+  util::gLogLevel = util::LevelFatal;
+  for (const char* doc :
+       { "", "{", "[1, 2", "{\"a\" 1}", "{\"a\": tru}", "[1] 2", "\"abc", "/* x", "[.5]", "[-.]", "[1.e]", "[1e400]" })
+  {
+    SCOPED_TRACE(doc);
+    EXPECT_ANY_THROW(parseJson(std::string(doc)));
+  }
+
+  std::string binary = toBinary(parseJson(std::string("{\"a\": [1.0, 2.0], \"b\": \"text\", \"c\": [1, {}]}")));
+  for (size_t size = 0; size < binary.size(); ++size)
+    EXPECT_ANY_THROW(fromBinary(binary.data(), size));
+  EXPECT_ANY_THROW(fromBinary(binary + "x"));
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -131,6 +131,50 @@ TEST_F(KinematicCostsTest, DynamicCartPoseJacCalculator)
   checkJacobian(f, dfdx, values, 1.0e-5);
 }
 
+TEST_F(KinematicCostsTest, JointVelTimeJacCalculator)
+{
+  CONSOLE_BRIDGE_logDebug("KinematicCostsTest, JointVelTimeJacCalculator");
+
+  const long n_dof = 3;
+  const long n_steps = 5;
+  Eigen::VectorXd targets(n_dof), upper_tols(n_dof), lower_tols(n_dof);
+  targets << 0.1, 0.0, -0.2;
+  upper_tols << 0.5, 0.0, 0.3;
+  lower_tols << -0.5, 0.0, -0.1;
+
+  // Rows of [joint values, 1/dt]
+  Eigen::VectorXd values(n_steps * (n_dof + 1));
+  for (long i = 0; i < values.size(); ++i)
+    values(i) = (i % (n_dof + 1) == n_dof) ? 2.0 + 0.1 * static_cast<double>(i) : std::sin(static_cast<double>(i));
+
+  JointVelTimeErrCalculator f(targets, upper_tols, lower_tols);
+  JointVelTimeJacCalculator dfdx(n_dof);
+
+  // The error must match the single joint calculator applied to each joint
+  Eigen::VectorXd err = f(values);
+  ASSERT_EQ(err.size(), 2 * (n_steps - 1) * n_dof);
+  for (long j = 0; j < n_dof; ++j)
+  {
+    Eigen::VectorXd single(2 * n_steps);
+    for (long i = 0; i < n_steps; ++i)
+    {
+      single(i) = values(i * (n_dof + 1) + j);
+      single(n_steps + i) = values(i * (n_dof + 1) + n_dof);
+    }
+    Eigen::VectorXd expected = JointVelErrCalculator(targets(j), upper_tols(j), lower_tols(j))(single);
+    for (long i = 0; i < n_steps - 1; ++i)
+    {
+      EXPECT_NEAR(err(i * n_dof + j), expected(i), 1e-12);
+      EXPECT_NEAR(err((n_steps - 1 + i) * n_dof + j), expected(n_steps - 1 + i), 1e-12);
+    }
+  }
+
+  Eigen::MatrixXd numerical = sco::calcForwardNumJac(f, values, 1.0e-5);
+  Eigen::MatrixXd analytical = dfdx(values);
+  EXPECT_TRUE(numerical.isApprox(analytical, 1e-5));
+  EXPECT_EQ(dfdx(values).nonZeros(), 3 * err.size());
+}
+
 ////////////////////////////////////////////////////////////////////
 
 int main(int argc, char** argv)
@@ -0,0 +1,84 @@
+#include <trajopt_utils/macros.h>
+TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <boost/filesystem/path.hpp>
+#include <tesseract/tesseract.h>
+TRAJOPT_IGNORE_WARNINGS_POP
+
+#include <trajopt/problem_description.hpp>
+#include <trajopt_sco/optimizers.hpp>
+#include <trajopt_test_utils.hpp>
+#include <trajopt_utils/clock.hpp>
+#include <trajopt_utils/logging.hpp>
+
+using namespace trajopt;
+using namespace std;
+using namespace util;
+using namespace tesseract;
+using namespace tesseract_scene_graph;
+
+/**
+ * @brief Compares increasing the penalty of every constraint with increasing only the penalties of the violated ones.
+ *
+ * Both runs start from the same merit coefficient, so the difference in QP solves comes from the constraints that are
+ * already satisfied not being made stiffer.
+ */
+int main(int /*argc*/, char** /*argv*/)
+{
+  gLogLevel = util::LevelError;
+
+  Tesseract::Ptr tesseract = std::make_shared<Tesseract>();
+  boost::filesystem::path urdf_file(std::string(TRAJOPT_DIR) + "/test/data/arm_around_table.urdf");
+  boost::filesystem::path srdf_file(std::string(TRAJOPT_DIR) + "/test/data/pr2.srdf");
+  ResourceLocatorFn locator = locateResource;
+  if (!tesseract->init(urdf_file, srdf_file, locator))
+  {
+    printf("failed to load the arm_around_table environment\n");
+    return 1;
+  }
+
+  std::unordered_map<std::string, double> ipos;
+  ipos["torso_lift_joint"] = 0.0;
+  tesseract->getEnvironment()->setState(ipos);
+
+  for (const char* config : { "arm_around_table.json",
+                              "arm_around_table_continuous.json",
+                              "arm_around_table_time.json",
+                              "numerical_ik1.json" })
+  {
+    Json::Value root = readJsonFile(std::string(TRAJOPT_DIR) + "/test/data/config/" + config);
+
+    printf("%s\n%14s %30s %10s %10s %10s\n", config, "violated only", "status", "qp solves", "increases", "time [ms]");
+    for (bool violated_only : { false, true })
+    {
+      ProblemConstructionInfo pci(tesseract);
+      pci.fromJson(root);
+      TrajOptProb::Ptr prob = ConstructProblem(pci);
+      if (!prob)
+      {
+        printf("failed to construct %s\n", config);
+        return 1;
+      }
+
+      sco::BasicTrustRegionSQP opt(prob);
+      opt.getParameters() = pci.opt_info;
+      opt.getParameters().merit_coeff_increase_violated_only = violated_only;
+      opt.initialize(trajToDblVec(prob->GetInitTraj()));
+
+      double start = GetClock();
+      sco::OptStatus status = opt.optimize();
+      double elapsed = GetClock() - start;
+
+      const sco::OptResults& results = opt.results();
+      printf("%14s %30s %10d %10d %10.3f\n",
+             violated_only ? "true" : "false",
+             sco::statusToString(status).c_str(),
+             results.n_qp_solves,
+             results.n_merit_increases,
+             1e3 * elapsed);
+    }
+  }
+  return 0;
+}
@@ -118,6 +118,38 @@ TEST_F(PlanningTest, numerical_ik1)
   CONSOLE_BRIDGE_logDebug("planning time: %.3f", GetClock() - tStart);
 }
 
+/** Solves numerical_ik1, moves the cart_pose target with SetCartPoseTarget and solves the same problem again */
+TEST_F(PlanningTest, numerical_ik_retarget)
+{
+  CONSOLE_BRIDGE_logDebug("PlanningTest, numerical_ik_retarget");
+
+  Json::Value root = readJsonFile(std::string(TRAJOPT_DIR) + "/test/data/config/numerical_ik1.json");
+  TrajOptProb::Ptr prob = ConstructProblem(root, tesseract_);
+  ASSERT_TRUE(!!prob);
+
+  Eigen::Isometry3d change_base = prob->GetEnv()->getLinkTransform(prob->GetKin()->getBaseLinkName());
+  Eigen::Isometry3d world_to_target = prob->GetEnv()->getLinkTransform("base_footprint");
+  auto solve = [&prob, &change_base]() {
+    sco::BasicTrustRegionSQP opt(prob);
+    opt.initialize(DblVec(static_cast<size_t>(prob->GetNumDOF()), 0));
+    opt.optimize();
+    Eigen::Isometry3d final_pose;
+    prob->GetKin()->calcFwdKin(final_pose, toVectorXd(opt.x()));
+    return Eigen::Isometry3d(change_base * final_pose);
+  };
+
+  Eigen::Isometry3d goal;
+  goal.setIdentity();
+  goal.translation() << 0.4, 0, 0.8;
+  goal.linear() = Eigen::Quaterniond(0, 0, 1, 0).toRotationMatrix();
+  EXPECT_TRUE(solve().isApprox(world_to_target * goal, 1e-5));
+
+  goal.translation() << 0.5, 0.1, 0.7;
+  prob->SetCartPoseTarget("cart_pose", world_to_target * goal);
+  EXPECT_ANY_THROW(prob->SetCartPoseTarget("no_such_term", goal));
+  EXPECT_TRUE(solve().isApprox(world_to_target * goal, 1e-5));
+}
+
 TEST_F(PlanningTest, arm_around_table)
 {
   CONSOLE_BRIDGE_logDebug("PlanningTest, arm_around_table");
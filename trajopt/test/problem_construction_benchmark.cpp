@@ -0,0 +1,102 @@
+#include <trajopt_utils/macros.h>
+TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <boost/filesystem/path.hpp>
+#include <tesseract/tesseract.h>
+TRAJOPT_IGNORE_WARNINGS_POP
+
+#include <trajopt/problem_description.hpp>
+#include <trajopt_test_utils.hpp>
+#include <trajopt_utils/clock.hpp>
+#include <trajopt_utils/logging.hpp>
+
+using namespace trajopt;
+using namespace std;
+using namespace util;
+using namespace tesseract;
+using namespace tesseract_scene_graph;
+
+namespace
+{
+/** @brief Returns a copy of root where every cost and constraint is repeated n_copies times under a unique name */
+Json::Value replicateTerms(const Json::Value& root, int n_copies)
+{
+  Json::Value out = root;
+  for (const char* key : { "costs", "constraints" })
+  {
+    if (!root.isMember(key))
+      continue;
+
+    Json::Value terms(Json::arrayValue);
+    for (const Json::Value& term : root[key])
+    {
+      for (int i = 0; i < n_copies; ++i)
+      {
+        Json::Value copy = term;
+        std::string name = term.isMember("name") ? term["name"].asString() : term["type"].asString();
+        copy["name"] = name + "_" + std::to_string(i);
+        terms.append(copy);
+      }
+    }
+    out[key] = terms;
+  }
+  return out;
+}
+}  // namespace
+
+/**
+ * @brief Reports the time ConstructProblem takes for a config as the number of terms grows.
+ *
+ * Every term of the config is repeated, so with a shared construction context the time should grow with the number of
+ * costs and constraints added, not with the number of scene graph traversals.
+ */
+int main(int /*argc*/, char** /*argv*/)
+{
+  gLogLevel = util::LevelError;
+  const int n_repeats = 5;
+
+  Tesseract::Ptr tesseract = std::make_shared<Tesseract>();
+  boost::filesystem::path urdf_file(std::string(TRAJOPT_DIR) + "/test/data/arm_around_table.urdf");
+  boost::filesystem::path srdf_file(std::string(TRAJOPT_DIR) + "/test/data/pr2.srdf");
+  ResourceLocatorFn locator = locateResource;
+  if (!tesseract->init(urdf_file, srdf_file, locator))
+  {
+    printf("failed to load the arm_around_table environment\n");
+    return 1;
+  }
+
+  std::unordered_map<std::string, double> ipos;
+  ipos["torso_lift_joint"] = 0.0;
+  tesseract->getEnvironment()->setState(ipos);
+
+  for (const char* config : { "arm_around_table.json", "numerical_ik1.json" })
+  {
+    Json::Value root = readJsonFile(std::string(TRAJOPT_DIR) + "/test/data/config/" + config);
+
+    printf("%s\n%8s %10s %10s %14s\n", config, "copies", "costs", "cnts", "construct [ms]");
+    for (int n_copies : { 1, 4, 16, 64 })
+    {
+      Json::Value replicated = replicateTerms(root, n_copies);
+
+      size_t n_costs = 0;
+      size_t n_cnts = 0;
+      double start = GetClock();
+      for (int r = 0; r < n_repeats; ++r)
+      {
+        TrajOptProb::Ptr prob = ConstructProblem(replicated, tesseract);
+        if (!prob)
+        {
+          printf("failed to construct %s\n", config);
+          return 1;
+        }
+        n_costs = prob->getCosts().size();
+        n_cnts = prob->getConstraints().size();
+      }
+      double elapsed = (GetClock() - start) / n_repeats;
+      printf("%8d %10zu %10zu %14.3f\n", n_copies, n_costs, n_cnts, 1e3 * elapsed);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,167 @@
+#include <trajopt_utils/macros.h>
+TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <gtest/gtest.h>
+#include <boost/filesystem/path.hpp>
+#include <tesseract/tesseract.h>
+#include <unistd.h>
+TRAJOPT_IGNORE_WARNINGS_POP
+
+#include <trajopt/problem_description.hpp>
+#include <trajopt/problem_snapshot.hpp>
+#include <trajopt_test_utils.hpp>
+#include <trajopt_utils/logging.hpp>
+
+using namespace trajopt;
+using namespace std;
+using namespace util;
+using namespace tesseract;
+using namespace tesseract_scene_graph;
+
+class ProblemSnapshotTest : public testing::Test
+{
+public:
+  Tesseract::Ptr tesseract_ = std::make_shared<Tesseract>(); /**< Tesseract */
+  std::string dir_;
+
+  void SetUp() override
+  {
+    boost::filesystem::path urdf_file(std::string(TRAJOPT_DIR) + "/test/data/arm_around_table.urdf");
+    boost::filesystem::path srdf_file(std::string(TRAJOPT_DIR) + "/test/data/pr2.srdf");
+
+    ResourceLocatorFn locator = locateResource;
+    EXPECT_TRUE(tesseract_->init(urdf_file, srdf_file, locator));
+
+    std::unordered_map<std::string, double> ipos;
+    ipos["torso_lift_joint"] = 0.0;
+    tesseract_->getEnvironment()->setState(ipos);
+
+    char dir_template[] = "/tmp/trajopt_snapshot_XXXXXX";
+    ASSERT_TRUE(mkdtemp(dir_template) != nullptr);
+    dir_ = dir_template;
+
+    gLogLevel = util::LevelError;
+  }
+
+  void TearDown() override
+  {
+    std::remove((dir_ + "/problem.snap").c_str());
+    std::remove((dir_ + "/truncated.snap").c_str());
+    std::remove((dir_ + "/corrupt.snap").c_str());
+    rmdir(dir_.c_str());
+  }
+};
+
+/** @brief A saved problem maps with the same variables and initial trajectory and hydrates to the same problem */
+TEST_F(ProblemSnapshotTest, SaveLoadHydrate)
+{
+  Json::Value root = readJsonFile(std::string(TRAJOPT_DIR) + "/test/data/config/arm_around_table.json");
+  TrajOptProb::Ptr prob = ConstructProblem(root, tesseract_);
+  ASSERT_TRUE(!!prob);
+
+  // The snapshot keeps the current start state, not the one of the request
+  Eigen::VectorXd start = prob->GetInitTraj().row(0).transpose();
+  start[0] += 0.1;
+  prob->SetStartState(start);
+
+  std::string path = dir_ + "/problem.snap";
+  ProblemSnapshot::save(path, *prob);
+
+  ProblemSnapshot snapshot(path);
+  ASSERT_EQ(prob->getNumVars(), snapshot.numVars());
+  EXPECT_EQ(prob->GetNumSteps(), snapshot.numSteps());
+  EXPECT_EQ(prob->GetNumDOF(), snapshot.numCols());
+  EXPECT_EQ(prob->GetHasTime(), snapshot.hasTime());
+  for (int i = 0; i < snapshot.numVars(); ++i)
+  {
+    EXPECT_EQ(prob->getLowerBounds()[static_cast<size_t>(i)], snapshot.lowerBounds()[i]);
+    EXPECT_EQ(prob->getUpperBounds()[static_cast<size_t>(i)], snapshot.upperBounds()[i]);
+  }
+  EXPECT_TRUE(prob->GetInitTraj() == snapshot.initTraj());
+  EXPECT_EQ(root, snapshot.request());
+
+  std::vector<std::string> var_names = snapshot.varNames();
+  ASSERT_EQ(prob->getVars().size(), var_names.size());
+  for (size_t i = 0; i < var_names.size(); ++i)
+    EXPECT_EQ(prob->getVars()[i].var_rep->name, var_names[i]);
+  EXPECT_EQ(prob->getCosts().size(), snapshot.costNames().size());
+  EXPECT_EQ(prob->getConstraints().size(), snapshot.cntNames().size());
+
+  TrajOptProb::Ptr hydrated = snapshot.hydrate(tesseract_);
+  ASSERT_TRUE(!!hydrated);
+  EXPECT_TRUE(prob->GetInitTraj() == hydrated->GetInitTraj());
+  EXPECT_EQ(prob->getCosts().size(), hydrated->getCosts().size());
+  EXPECT_EQ(prob->getConstraints().size(), hydrated->getConstraints().size());
+}
+
+/** @brief Problems without a request and damaged files are rejected */
+TEST_F(ProblemSnapshotTest, Errors)
+{
+  Json::Value root = readJsonFile(std::string(TRAJOPT_DIR) + "/test/data/config/arm_around_table.json");
+  ProblemConstructionInfo pci(tesseract_);
+  pci.fromJson(root);
+  TrajOptProb::Ptr prob = ConstructProblem(pci);
+  EXPECT_ANY_THROW(ProblemSnapshot::save(dir_ + "/problem.snap", *prob));
+
+  prob = ConstructProblem(root, tesseract_);
+  ProblemSnapshot::save(dir_ + "/problem.snap", *prob);
+  std::ifstream in(dir_ + "/problem.snap", std::ios::binary);
+  std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  std::ofstream out(dir_ + "/truncated.snap", std::ios::binary);
+  out.write(data.data(), static_cast<std::streamsize>(data.size() / 2));
+  out.close();
+
+  EXPECT_ANY_THROW(ProblemSnapshot(dir_ + "/truncated.snap"));
+  EXPECT_ANY_THROW(ProblemSnapshot(dir_ + "/missing.snap"));
+}
+
+/** @brief Section offsets that wrap around or break the alignment of the doubles are rejected */
+TEST_F(ProblemSnapshotTest, CorruptFiles)
+{
+  Json::Value root = readJsonFile(std::string(TRAJOPT_DIR) + "/test/data/config/arm_around_table.json");
+  TrajOptProb::Ptr prob = ConstructProblem(root, tesseract_);
+  ProblemSnapshot::save(dir_ + "/problem.snap", *prob);
+  std::ifstream in(dir_ + "/problem.snap", std::ios::binary);
+  const std::string saved((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  in.close();
+
+  // Header fields, see ProblemSnapshot::Header
+  const size_t n_steps_field = 24;
+  const size_t bounds_offset_field = 56;
+  const size_t init_traj_offset_field = 64;
+  auto field = [&saved](size_t offset) {
+    uint64_t value;
+    std::memcpy(&value, &saved[offset], sizeof(value));
+    return value;
+  };
+  auto expectRejected = [this, &saved](const std::vector<std::pair<size_t, uint64_t>>& fields) {
+    std::string data = saved;
+    for (const std::pair<size_t, uint64_t>& f : fields)
+      std::memcpy(&data[f.first], &f.second, sizeof(uint64_t));
+    std::ofstream out(dir_ + "/corrupt.snap", std::ios::binary);
+    out.write(data.data(), static_cast<std::streamsize>(data.size()));
+    out.close();
+    EXPECT_ANY_THROW(ProblemSnapshot(dir_ + "/corrupt.snap"));
+  };
+
+  // bounds_offset + 2 * n_vars * sizeof(double) wraps around to before init_traj_offset
+  expectRejected({ { bounds_offset_field, ~uint64_t(7) } });
+  // The initial trajectory, one step shorter, still ends before the names but its doubles are misaligned
+  expectRejected({ { init_traj_offset_field, field(init_traj_offset_field) + 4 },
+                   { n_steps_field, field(n_steps_field) - 1 } });
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,96 @@
+#include <trajopt_utils/macros.h>
+TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <gtest/gtest.h>
+#include <boost/filesystem/path.hpp>
+#include <tesseract/tesseract.h>
+TRAJOPT_IGNORE_WARNINGS_POP
+
+#include <trajopt/problem_description.hpp>
+#include <trajopt/receding_horizon.hpp>
+#include <trajopt/utils.hpp>
+#include <trajopt_test_utils.hpp>
+#include <trajopt_utils/logging.hpp>
+
+using namespace trajopt;
+using namespace std;
+using namespace util;
+using namespace tesseract;
+using namespace tesseract_scene_graph;
+
+class RecedingHorizonTest : public testing::Test
+{
+public:
+  Tesseract::Ptr tesseract_ = std::make_shared<Tesseract>(); /**< Tesseract */
+
+  void SetUp() override
+  {
+    boost::filesystem::path urdf_file(std::string(TRAJOPT_DIR) + "/test/data/arm_around_table.urdf");
+    boost::filesystem::path srdf_file(std::string(TRAJOPT_DIR) + "/test/data/pr2.srdf");
+
+    ResourceLocatorFn locator = locateResource;
+    EXPECT_TRUE(tesseract_->init(urdf_file, srdf_file, locator));
+
+    std::unordered_map<std::string, double> ipos;
+    ipos["torso_lift_joint"] = 0.0;
+    tesseract_->getEnvironment()->setState(ipos);
+
+    gLogLevel = util::LevelError;
+  }
+};
+
+/** @brief Shifting drops the executed rows and repeats the last one */
+TEST(ShiftTraj, RepeatsLastRow)
+{
+  TrajArray traj(4, 2);
+  traj << 0, 10, 1, 11, 2, 12, 3, 13;
+
+  TrajArray shifted = shiftTraj(traj, 1);
+  ASSERT_EQ(traj.rows(), shifted.rows());
+  for (long i = 0; i < traj.rows(); ++i)
+    EXPECT_TRUE(shifted.row(i) == traj.row(std::min(i + 1, traj.rows() - 1)));
+
+  EXPECT_TRUE(shiftTraj(traj, 0) == traj);
+  for (long i = 0; i < traj.rows(); ++i)
+    EXPECT_TRUE(shiftTraj(traj, 10).row(i) == traj.row(traj.rows() - 1));
+  EXPECT_ANY_THROW(shiftTraj(traj, -1));
+}
+
+/** @brief Replans with a moving goal, each cycle starting where the previous plan was after one step */
+TEST_F(RecedingHorizonTest, MovingGoal)
+{
+  Json::Value root = readJsonFile(std::string(TRAJOPT_DIR) + "/test/data/config/arm_around_table.json");
+  TrajOptProb::Ptr prob = ConstructProblem(root, tesseract_);
+  ASSERT_TRUE(!!prob);
+
+  sco::BasicTrustRegionSQPParameters params;
+  params.max_iter = 5;
+  params.max_time = 0.1;
+  RecedingHorizonPlanner planner(prob, params);
+
+  Eigen::VectorXd goal(7);
+  goal << 0.062, 1.287, 0.1, -1.554, -3.011, -0.268, 2.988;
+  Eigen::VectorXd start = prob->GetInitTraj().row(0).transpose();
+  for (int cycle = 0; cycle < 5; ++cycle)
+  {
+    goal[0] += 0.02;
+    prob->SetJointPosTargets("joint0", goal);
+
+    TrajOptResult::Ptr result = planner.plan(start);
+
+    ASSERT_NE(result->status, sco::OPT_FAILED);
+    for (long j = 0; j < start.size(); ++j)
+      EXPECT_NEAR(result->traj(0, j), start[j], 1e-3);
+
+    // The robot executes one step of the plan
+    start = result->traj.row(1).transpose();
+  }
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
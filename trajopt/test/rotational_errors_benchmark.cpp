@@ -0,0 +1,80 @@
+#include <trajopt_utils/macros.h>
+TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <Eigen/Geometry>
+TRAJOPT_IGNORE_WARNINGS_POP
+
+#include <trajopt/utils.hpp>
+#include <trajopt_utils/clock.hpp>
+#include <trajopt_utils/logging.hpp>
+
+using namespace trajopt;
+using namespace std;
+using namespace util;
+
+namespace
+{
+/** @brief Rotation with the given angle about a random axis */
+Eigen::Matrix3d randomRotation(std::mt19937& gen, double angle)
+{
+  std::normal_distribution<double> normal;
+  Eigen::Vector3d axis(normal(gen), normal(gen), normal(gen));
+  return Eigen::AngleAxisd(angle, axis.normalized()).toRotationMatrix();
+}
+
+/** @brief Packs rotations into the 9 x N layout used by calcRotationalErrors */
+Eigen::Matrix<double, 9, Eigen::Dynamic> packRotations(const AlignedVector<Eigen::Matrix3d>& rotations)
+{
+  Eigen::Matrix<double, 9, Eigen::Dynamic> out(9, static_cast<Eigen::Index>(rotations.size()));
+  for (size_t i = 0; i < rotations.size(); ++i)
+    Eigen::Map<Eigen::Matrix3d>(out.col(static_cast<Eigen::Index>(i)).data()) = rotations[i];
+  return out;
+}
+}  // namespace
+
+/**
+ * @brief Reports the time per rotation of calcRotationalError and of the batched calcRotationalErrors.
+ *
+ * The batched errors are checked against the single pose version, the benchmark returns 1 if they differ.
+ */
+int main(int /*argc*/, char** /*argv*/)
+{
+  gLogLevel = util::LevelError;
+  std::mt19937 gen(4);
+  std::uniform_real_distribution<double> uniform(0, M_PI - 1e-6);
+  const int n_evals = 100;
+  int n_mismatches = 0;
+
+  printf("%8s %16s %16s\n", "n", "single [ns]", "batch [ns]");
+  for (int n : { 8, 64, 512 })
+  {
+    AlignedVector<Eigen::Matrix3d> rotations;
+    for (int i = 0; i < n; ++i)
+      rotations.push_back(randomRotation(gen, uniform(gen)));
+    Eigen::Matrix<double, 9, Eigen::Dynamic> packed = packRotations(rotations);
+
+    Eigen::Matrix3Xd single(3, n);
+    double t0 = GetClock();
+    for (int k = 0; k < n_evals; ++k)
+      for (int i = 0; i < n; ++i)
+        single.col(i) = calcRotationalError(rotations[static_cast<size_t>(i)]);
+    double t1 = GetClock();
+    Eigen::Matrix3Xd batch;
+    for (int k = 0; k < n_evals; ++k)
+      batch = calcRotationalErrors(packed);
+    double t2 = GetClock();
+
+    for (int i = 0; i < n; ++i)
+    {
+      if ((single.col(i) - batch.col(i)).norm() > 1e-12)
+        ++n_mismatches;
+    }
+    printf("%8d %16.3f %16.3f\n", n, 1e9 * (t1 - t0) / (n_evals * n), 1e9 * (t2 - t1) / (n_evals * n));
+  }
+
+  if (n_mismatches > 0)
+    printf("%d batched errors differ from calcRotationalError\n", n_mismatches);
+  return (n_mismatches == 0) ? 0 : 1;
+}
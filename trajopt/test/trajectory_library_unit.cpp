@@ -0,0 +1,192 @@
+#include <trajopt_utils/macros.h>
+TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <gtest/gtest.h>
+TRAJOPT_IGNORE_WARNINGS_POP
+
+#include <trajopt/trajectory_library.hpp>
+
+using namespace trajopt;
+using namespace std;
+
+static const int N_STEPS = 6;
+static const int N_DOF = 3;
+static const int GOAL_SIZE = 2;
+
+class TrajectoryLibraryTest : public testing::Test
+{
+public:
+  std::mt19937 rng_{ 42 };
+  std::vector<Eigen::VectorXd> keys_; /**< keys of the entries added, for brute force queries */
+
+  Eigen::VectorXd random(int size)
+  {
+    std::uniform_real_distribution<double> dist(-1, 1);
+    Eigen::VectorXd v(size);
+    for (int i = 0; i < size; ++i)
+      v[i] = dist(rng_);
+    return v;
+  }
+
+  void fill(TrajectoryLibrary& library, int n_entries)
+  {
+    for (int i = 0; i < n_entries; ++i)
+    {
+      Eigen::VectorXd start = random(N_DOF);
+      Eigen::VectorXd goal = random(GOAL_SIZE);
+      TrajArray traj(N_STEPS, N_DOF);
+      for (int j = 0; j < N_STEPS; ++j)
+        traj.row(j) = random(N_DOF).transpose();
+      traj.row(0) = start.transpose();
+      library.add(start, goal, traj);
+
+      Eigen::VectorXd key(N_DOF + GOAL_SIZE);
+      key << start, goal;
+      keys_.push_back(key);
+    }
+  }
+
+  /** @brief Checks the k nearest entries against a linear scan */
+  void checkQueries(const TrajectoryLibrary& library, size_t k)
+  {
+    for (int i = 0; i < 100; ++i)
+    {
+      Eigen::VectorXd start = random(N_DOF);
+      Eigen::VectorXd goal = random(GOAL_SIZE);
+      Eigen::VectorXd key(N_DOF + GOAL_SIZE);
+      key << start, goal;
+
+      std::vector<size_t> expected(keys_.size());
+      for (size_t j = 0; j < expected.size(); ++j)
+        expected[j] = j;
+      std::sort(expected.begin(), expected.end(), [this, &key](size_t a, size_t b) {
+        return (keys_[a] - key).squaredNorm() < (keys_[b] - key).squaredNorm();
+      });
+      expected.resize(std::min(k, expected.size()));
+
+      EXPECT_EQ(library.query(start, goal, k), expected);
+    }
+  }
+};
+
+TEST_F(TrajectoryLibraryTest, QueryMatchesLinearScan)
+{
+  TrajectoryLibrary library;
+  fill(library, 10);
+  checkQueries(library, 3);
+
+  // Enough entries for the tree to be rebuilt, with some added after it
+  fill(library, 300);
+  checkQueries(library, 1);
+  checkQueries(library, 5);
+  checkQueries(library, 400);
+}
+
+TEST_F(TrajectoryLibraryTest, SaveAndLoad)
+{
+  TrajectoryLibrary library;
+  fill(library, 250);
+
+  std::string path = testing::TempDir() + "trajectory_library_unit.tjtrlib";
+  library.save(path);
+
+  TrajectoryLibrary loaded(path);
+  EXPECT_EQ(loaded.size(), library.size());
+  EXPECT_EQ(loaded.numSteps(), N_STEPS);
+  EXPECT_EQ(loaded.numCols(), N_DOF);
+  for (size_t i = 0; i < library.size(); ++i)
+  {
+    EXPECT_TRUE(loaded.key(i).isApprox(library.key(i)));
+    EXPECT_TRUE(loaded.traj(i).isApprox(library.traj(i)));
+  }
+  checkQueries(loaded, 4);
+
+  // Adding to a loaded library copies it out of the mapping
+  fill(library, 1);
+  loaded.add(keys_.back().head(N_DOF), keys_.back().tail(GOAL_SIZE), library.traj(library.size() - 1));
+  checkQueries(loaded, 4);
+
+  std::remove(path.c_str());
+}
+
+TEST_F(TrajectoryLibraryTest, Seed)
+{
+  TrajectoryLibrary library;
+  fill(library, 50);
+
+  Eigen::VectorXd start = random(N_DOF);
+  Eigen::VectorXd goal = random(GOAL_SIZE);
+  TrajArray seed = library.seed(start, goal);
+  Eigen::Map<const TrajArray> nearest = library.traj(library.query(start, goal, 1)[0]);
+
+  ASSERT_EQ(seed.rows(), N_STEPS);
+  ASSERT_EQ(seed.cols(), N_DOF);
+  EXPECT_TRUE(seed.row(0).isApprox(start.transpose()));
+  EXPECT_TRUE(seed.row(N_STEPS - 1).isApprox(nearest.row(N_STEPS - 1)));
+}
+
+TEST_F(TrajectoryLibraryTest, Errors)
+{
+  TrajectoryLibrary library;
+  EXPECT_THROW(library.seed(random(N_DOF), random(GOAL_SIZE)), std::runtime_error);
+
+  fill(library, 5);
+  EXPECT_THROW(library.add(random(N_DOF), random(GOAL_SIZE), TrajArray::Zero(N_STEPS + 1, N_DOF)),
+               std::runtime_error);
+  EXPECT_THROW(library.add(random(N_DOF), random(GOAL_SIZE + 1), TrajArray::Zero(N_STEPS, N_DOF)),
+               std::runtime_error);
+  EXPECT_THROW(library.query(random(N_DOF), random(GOAL_SIZE + 1), 1), std::runtime_error);
+  EXPECT_THROW(TrajectoryLibrary(testing::TempDir() + "does_not_exist.tjtrlib"), std::runtime_error);
+}
+
+/** Files whose sizes overflow or whose search tree points outside the entries are rejected when loaded */
+TEST_F(TrajectoryLibraryTest, CorruptFiles)
+{
+  TrajectoryLibrary library;
+  fill(library, 20);
+  std::string path = testing::TempDir() + "trajectory_library_unit.tjtrlib";
+  library.save(path);
+  std::ifstream in(path, std::ios::binary);
+  const std::string saved((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  in.close();
+
+  // Header fields, see TrajectoryLibrary::Header
+  const size_t n_entries_field = 16;
+  const size_t key_size_field = 24;
+  const size_t tree_offset_field = 64;
+  uint64_t tree_offset;
+  std::memcpy(&tree_offset, &saved[tree_offset_field], sizeof(tree_offset));
+  const size_t order_field = static_cast<size_t>(tree_offset);
+  const size_t split_field = order_field + 20 * sizeof(uint64_t);
+
+  // n_entries * key_size * sizeof(double) wraps around to 0
+  std::vector<std::pair<size_t, uint64_t>> corruptions{ { n_entries_field, uint64_t(1) << 61 },
+                                                        { key_size_field, uint64_t(1) << 61 },
+                                                        { order_field, 20 },
+                                                        { split_field, N_DOF + GOAL_SIZE } };
+  for (const std::pair<size_t, uint64_t>& corruption : corruptions)
+  {
+    std::string file = saved;
+    std::memcpy(&file[corruption.first], &corruption.second, sizeof(uint64_t));
+    std::ofstream out(path, std::ios::binary);
+    out.write(file.data(), static_cast<std::streamsize>(file.size()));
+    out.close();
+    EXPECT_THROW(TrajectoryLibrary loaded(path), std::runtime_error) << corruption.first;
+  }
+
+  std::remove(path.c_str());
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,131 @@
+#include <trajopt_utils/macros.h>
+TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <cmath>
+#include <gtest/gtest.h>
+#include <random>
+#include <Eigen/Geometry>
+TRAJOPT_IGNORE_WARNINGS_POP
+
+#include <trajopt/utils.hpp>
+#include <trajopt_utils/logging.hpp>
+
+using namespace trajopt;
+using namespace std;
+using namespace util;
+
+namespace
+{
+/** @brief Rotation with the given angle about a random axis */
+Eigen::Matrix3d randomRotation(std::mt19937& gen, double angle)
+{
+  std::normal_distribution<double> normal;
+  Eigen::Vector3d axis(normal(gen), normal(gen), normal(gen));
+  return Eigen::AngleAxisd(angle, axis.normalized()).toRotationMatrix();
+}
+
+/** @brief Packs rotations into the 9 x N layout used by calcRotationalErrors */
+Eigen::Matrix<double, 9, Eigen::Dynamic> packRotations(const AlignedVector<Eigen::Matrix3d>& rotations)
+{
+  Eigen::Matrix<double, 9, Eigen::Dynamic> out(9, static_cast<Eigen::Index>(rotations.size()));
+  for (size_t i = 0; i < rotations.size(); ++i)
+    Eigen::Map<Eigen::Matrix3d>(out.col(static_cast<Eigen::Index>(i)).data()) = rotations[i];
+  return out;
+}
+
+void expectNearRotationalErrors(const AlignedVector<Eigen::Matrix3d>& rotations, double tol)
+{
+  Eigen::Matrix3Xd batch = calcRotationalErrors(packRotations(rotations));
+  ASSERT_EQ(batch.cols(), static_cast<Eigen::Index>(rotations.size()));
+  for (size_t i = 0; i < rotations.size(); ++i)
+  {
+    Eigen::Vector3d expected = calcRotationalError(rotations[i]);
+    Eigen::Vector3d actual = batch.col(static_cast<Eigen::Index>(i));
+    EXPECT_LT((expected - actual).norm(), tol) << "expected: " << expected.transpose()
+                                               << " actual: " << actual.transpose();
+  }
+}
+}  // namespace
+
+/** @brief Compare against calcRotationalError over the full range of angles */
+TEST(UtilsTest, calcRotationalErrors)
+{
+  std::mt19937 gen(0);
+  std::uniform_real_distribution<double> uniform(0, M_PI - 1e-6);
+  AlignedVector<Eigen::Matrix3d> rotations;
+  for (int i = 0; i < 1000; ++i)
+    rotations.push_back(randomRotation(gen, uniform(gen)));
+
+  expectNearRotationalErrors(rotations, 1e-12);
+}
+
+/** @brief Small angles are where the finite difference Jacobians evaluate the error */
+TEST(UtilsTest, calcRotationalErrorsSmallAngles)
+{
+  std::mt19937 gen(1);
+  AlignedVector<Eigen::Matrix3d> rotations;
+  rotations.push_back(Eigen::Matrix3d::Identity());
+  for (double angle : { 1e-12, 1e-9, 1e-7, 1e-5, 1e-3 })
+    for (int i = 0; i < 20; ++i)
+      rotations.push_back(randomRotation(gen, angle));
+
+  expectNearRotationalErrors(rotations, 1e-15);
+
+  // Relative accuracy matters for the finite differences, not only the absolute error
+  Eigen::Matrix3Xd batch = calcRotationalErrors(packRotations(rotations));
+  for (size_t i = 1; i < rotations.size(); ++i)
+  {
+    Eigen::Vector3d expected = calcRotationalError(rotations[i]);
+    EXPECT_LT((expected - batch.col(static_cast<Eigen::Index>(i))).norm(), 1e-9 * expected.norm());
+  }
+}
+
+/** @brief Near pi the axis sign is ambiguous, so compare the rotations the errors represent */
+TEST(UtilsTest, calcRotationalErrorsNearPi)
+{
+  std::mt19937 gen(2);
+  AlignedVector<Eigen::Matrix3d> rotations;
+  for (double angle : { M_PI - 1e-3, M_PI - 1e-6, M_PI })
+    for (int i = 0; i < 20; ++i)
+      rotations.push_back(randomRotation(gen, angle));
+
+  Eigen::Matrix3Xd batch = calcRotationalErrors(packRotations(rotations));
+  for (size_t i = 0; i < rotations.size(); ++i)
+  {
+    Eigen::Vector3d err = batch.col(static_cast<Eigen::Index>(i));
+    EXPECT_LE(err.norm(), M_PI + 1e-12);
+    Eigen::Matrix3d rotation = Eigen::AngleAxisd(err.norm(), err.normalized()).toRotationMatrix();
+    EXPECT_TRUE(rotation.isApprox(rotations[i], 1e-9));
+  }
+}
+
+TEST(UtilsTest, calcTransformErrors)
+{
+  std::mt19937 gen(3);
+  std::uniform_real_distribution<double> uniform(-1, 1);
+  Eigen::Isometry3d t1 = Eigen::Isometry3d::Identity();
+  t1.linear() = randomRotation(gen, 0.7);
+  t1.translation() = Eigen::Vector3d(0.1, -0.2, 0.3);
+
+  AlignedVector<Eigen::Isometry3d> t2;
+  for (int i = 0; i < 100; ++i)
+  {
+    Eigen::Isometry3d pose = Eigen::Isometry3d::Identity();
+    pose.linear() = randomRotation(gen, M_PI * std::abs(uniform(gen)));
+    pose.translation() = Eigen::Vector3d(uniform(gen), uniform(gen), uniform(gen));
+    t2.push_back(pose);
+  }
+
+  Eigen::Matrix<double, 6, Eigen::Dynamic> batch = calcTransformErrors(t1, t2);
+  ASSERT_EQ(batch.cols(), 100);
+  for (size_t i = 0; i < t2.size(); ++i)
+  {
+    Eigen::VectorXd expected = calcTransformError(t1, t2[i]);
+    EXPECT_TRUE(expected.isApprox(batch.col(static_cast<Eigen::Index>(i)), 1e-10));
+  }
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
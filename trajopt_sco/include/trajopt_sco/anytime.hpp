@@ -0,0 +1,75 @@
+#pragma once
+#include <trajopt_utils/macros.h>
+TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <atomic>
+#include <memory>
+TRAJOPT_IGNORE_WARNINGS_POP
+
+#include <trajopt_sco/sco_common.hpp>
+
+namespace sco
+{
+/** @brief A feasible iterate published by an optimizer in anytime mode */
+struct AnytimeSolution
+{
+  DblVec x;
+  double total_cost{ 0 };
+  /** @brief Largest constraint violation, below the constraint tolerance of the optimizer */
+  double max_cnt_viol{ 0 };
+  /** @brief Number of QP solves when the iterate was found */
+  int n_qp_solves{ 0 };
+};
+
+/**
+ * @brief Lock-free single slot mailbox between one optimizer (the producer) and one consumer, e.g. a motion executor
+ *
+ * The mailbox is a triple buffer: the producer writes into its back buffer and swaps it with the middle one, the
+ * consumer swaps the middle buffer with its front buffer. Neither side waits for the other and the consumer always
+ * sees the newest complete solution. Solutions published before the consumer takes them are overwritten.
+ */
+class AnytimeMailbox
+{
+public:
+  using Ptr = std::shared_ptr<AnytimeMailbox>;
+
+  /** @brief Producer side: replaces the published solution */
+  void publish(const AnytimeSolution& solution)
+  {
+    buffers_[back_] = solution;
+    back_ = middle_.exchange(back_ | FRESH) & INDEX;
+  }
+
+  /** @brief Consumer side: takes the newest solution. Returns false if none was published since the last take. */
+  bool take(AnytimeSolution& solution)
+  {
+    if (!(middle_.load() & FRESH))
+      return false;
+    front_ = middle_.exchange(front_) & INDEX;
+    solution = buffers_[front_];
+    return true;
+  }
+
+private:
+  static const int INDEX = 3;
+  static const int FRESH = 4;
+
+  AnytimeSolution buffers_[3];
+  int back_{ 0 };                /**< written by the producer only */
+  int front_{ 1 };               /**< read by the consumer only */
+  std::atomic<int> middle_{ 2 }; /**< index of the middle buffer, FRESH if it was published and not taken yet */
+};
+
+/** @brief Cooperative cancellation of an optimization, checked by the optimizer between its phases */
+class CancellationToken
+{
+public:
+  using Ptr = std::shared_ptr<CancellationToken>;
+
+  void cancel() { cancelled_ = true; }
+  void reset() { cancelled_ = false; }
+  bool isCancelled() const { return cancelled_; }
+
+private:
+  std::atomic<bool> cancelled_{ false };
+};
+}  // namespace sco
@@ -0,0 +1,129 @@
+#pragma once
+#include <trajopt_utils/macros.h>
+TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <Eigen/Core>
+TRAJOPT_IGNORE_WARNINGS_POP
+
+#include <trajopt_sco/solver_interface.hpp>
+
+namespace sco
+{
+/**
+ * BandedQPModel solves a linearly constrained QP with a primal-dual interior point method (Mehrotra
+ * predictor-corrector) whose Newton systems are factored in a band. It solves a problem in the form:
+ * ```
+ * min   1/2*x'Px + q'x
+ * s.t.  Ax == b
+ *       Gx <= h
+ *       lb <= x <= ub
+ * ```
+ *
+ * The QPs of a trajectory optimization are block banded: the costs and constraints of a timestep only touch the
+ * variables of that timestep and of a few neighboring ones. The inequalities are eliminated into the Hessian and the
+ * variables and equality constraints are ordered with reverse Cuthill-McKee, which puts the slack variables added by
+ * the penalty terms next to the timestep they belong to. The quasi-definite system
+ * ```
+ * [P + G'WG + d*I   A'   ]
+ * [A               -d*I  ]
+ * ```
+ * is then factored as LDL' in its envelope, so an iteration costs O(n_steps * band^2) instead of a general sparse
+ * factorization. A term that couples all timesteps (e.g. a dense row) widens the band for every row after it.
+ */
+class BandedQPModel : public Model
+{
+public:
+  /** @brief Interior point settings */
+  struct Settings
+  {
+    int max_iter = 100;            /**< maximum number of interior point iterations */
+    double eps_feas = 1e-8;        /**< relative primal and dual feasibility tolerance */
+    double eps_gap = 1e-9;         /**< relative duality gap tolerance */
+    double regularization = 1e-10; /**< static regularization d of the Newton system */
+    int refinement_steps = 2;      /**< iterative refinement steps per Newton solve */
+  };
+
+  BandedQPModel();
+  virtual ~BandedQPModel();
+
+  Var addVar(const std::string& name) override;
+  Cnt addEqCnt(const AffExpr&, const std::string& name) override;
+  Cnt addIneqCnt(const AffExpr&, const std::string& name) override;
+  Cnt addIneqCnt(const QuadExpr&, const std::string& name) override;
+  void removeVars(const VarVector& vars) override;
+  void removeCnts(const CntVector& cnts) override;
+
+  void update() override;
+  void setVarBounds(const VarVector& vars, const DblVec& lower, const DblVec& upper) override;
+  DblVec getVarValues(const VarVector& vars) const override;
+  virtual CvxOptStatus optimize() override;
+  virtual void setObjective(const AffExpr&) override;
+  virtual void setObjective(const QuadExpr&) override;
+  virtual void writeToFile(const std::string& fname) override;
+  virtual VarVector getVars() const override;
+
+  Settings settings_; /**< interior point settings */
+
+  /** @brief Size of the last factored system and of its envelope, to check the detected structure */
+  size_t getSystemSize() const { return env_first_.size(); }
+  size_t getEnvelopeSize() const { return env_system_.size(); }
+
+private:
+  /** @brief Rows of the constraint matrix in compressed row form, with the duplicate variables of a row merged */
+  struct SparseRows
+  {
+    std::vector<size_t> ptr{ 0 };
+    std::vector<size_t> idx;
+    DblVec val;
+    DblVec rhs;
+
+    size_t size() const { return rhs.size(); }
+    void addRow(const AffExpr& expr);
+    void addRow(size_t var, double coeff, double rhs);
+  };
+
+  /** @brief Builds P, q, A, b, G and h from the objective, constraints and bounds */
+  void buildProblem();
+
+  /** @brief Orders the variables and equality rows with reverse Cuthill-McKee and lays out the envelope */
+  void orderSystem();
+
+  /** @brief Assembles and factors the Newton system for the inequality weights w */
+  void factor(const Eigen::VectorXd& w);
+
+  /** @brief Solves the last factored system with iterative refinement, in the original variable and row order */
+  void solve(const Eigen::VectorXd& rhs_x, const Eigen::VectorXd& rhs_y, Eigen::VectorXd& dx, Eigen::VectorXd& dy);
+
+  /** @brief Solves L*D*L'*v = v in place, in the order of the system */
+  void solveFactored(DblVec& v) const;
+
+  /** @brief out = M * in for the unregularized Newton system, in the order of the system */
+  void multiply(const DblVec& in, DblVec& out) const;
+
+  /** @brief Runs the interior point method on the built problem */
+  CvxOptStatus solveQP();
+
+  VarVector vars_;                 /**< model variables */
+  CntVector cnts_;                 /**< model's constraints */
+  DblVec lbs_, ubs_;               /**< variables bounds */
+  AffExprVector cnt_exprs_;        /**< constraints expressions */
+  ConstraintTypeVector cnt_types_; /**< constraints types */
+  DblVec solution_;                /**< optimizer's solution for current model */
+  QuadExpr objective_;             /**< objective QuadExpr expression */
+
+  std::vector<size_t> P_rows_, P_cols_; /**< lower triangle of P in triplet form */
+  DblVec P_vals_;
+  Eigen::VectorXd q_;
+  SparseRows eq_;   /**< Ax == b */
+  SparseRows ineq_; /**< Gx <= h, including the finite variable bounds */
+
+  std::vector<size_t> perm_;       /**< position in the system of variable i and of equality row n + i */
+  std::vector<size_t> env_first_;  /**< first column of the envelope of each row of the system */
+  std::vector<size_t> env_ptr_;    /**< offset of each row in the envelope, the diagonal is last */
+  DblVec env_base_;                /**< P, A and the regularization in the envelope */
+  DblVec env_system_;              /**< the assembled Newton system */
+  DblVec env_factor_;              /**< L of the factored Newton system */
+  DblVec diag_;                    /**< D of the factored Newton system */
+  DblVec diag_sign_;               /**< sign of each pivot: + for variables, - for equality rows */
+  std::vector<size_t> ineq_slots_; /**< envelope slot of each pair of entries of each inequality row */
+};
+}  // namespace sco
@@ -4,6 +4,16 @@
 
 namespace sco
 {
+/**
+ * @brief Set the maximum number of bpmpd_caller processes solving concurrently
+ *
+ * BPMPD runs in separate processes. Each BPMPDModel::optimize() leases one for the duration of the solve and blocks
+ * while all are busy. Processes are started on demand. The default is the number of hardware threads, or the
+ * TRAJOPT_BPMPD_WORKERS environment variable if set.
+ */
+void setBPMPDWorkerPoolSize(size_t size);
+size_t getBPMPDWorkerPoolSize();
+
 class BPMPDModel : public Model
 {
 public:
@@ -16,8 +26,6 @@ public:
 
   QuadExpr m_objective;
 
-  int m_pipeIn, m_pipeOut, m_pid;
-
   BPMPDModel();
   ~BPMPDModel() override;
 
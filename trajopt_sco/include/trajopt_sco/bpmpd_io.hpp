@@ -4,7 +4,9 @@ TRAJOPT_IGNORE_WARNINGS_PUSH
 #include <string>
 #include <vector>
 #include <assert.h>
+#include <cstring>
 #include <iostream>
+#include <stdint.h>
 #include <stdlib.h>
 #include <unistd.h>
 TRAJOPT_IGNORE_WARNINGS_POP
@@ -107,6 +109,7 @@ struct bpmpd_input
 
 const char EXIT_CHAR = 123;
 const char CHECK_CHAR = 111;
+const char SHM_SOLVE_CHAR = 115;
 
 void ser(int fp, bpmpd_input& bi, SerMode mode)
 {
@@ -165,4 +168,60 @@ void ser(int fp, bpmpd_output& bo, SerMode mode)
   ser(fp, bo.code, mode);
   ser(fp, bo.opt, mode);
 }
+/**
+ * @brief Problem sizes, return code and objective at the start of the shared memory region
+ *
+ * When bpmpd_caller is started with the file descriptor of a shared memory region (memfd) as its argument, the problem
+ * is not serialized through the pipe. The caller writes the problem into the region, sends SHM_SOLVE_CHAR followed by
+ * the uint64 size of the region, and bpmpd_caller writes the solution in place and replies with CHECK_CHAR.
+ */
+struct bpmpd_shm_header
+{
+  int m, n, nz, qn, qnz, code;
+  double opt;
+};
+
+/** @brief Pointers into a shared memory region holding a problem and its solution */
+struct bpmpd_shm
+{
+  bpmpd_shm_header* header;
+  double *acolnzs, *qcolnzs, *rhs, *obj, *lbound, *ubound, *primal, *dual;
+  int *acolcnt, *acolidx, *qcolcnt, *qcolidx, *status;
+};
+
+/** @brief Bytes needed for a problem with the sizes in header. Doubles are placed before ints to keep them aligned. */
+inline size_t shm_size(const bpmpd_shm_header& h)
+{
+  size_t m = static_cast<size_t>(h.m), n = static_cast<size_t>(h.n);
+  size_t nz = static_cast<size_t>(h.nz), qnz = static_cast<size_t>(h.qnz);
+  return sizeof(bpmpd_shm_header) + sizeof(double) * (nz + qnz + m + n + 4 * (n + m)) +
+         sizeof(int) * (2 * n + nz + qnz + (n + m));
+}
+
+/** @brief Lay out the arrays for the sizes stored in the header at the start of base */
+inline bpmpd_shm shm_view(void* base)
+{
+  bpmpd_shm v;
+  v.header = static_cast<bpmpd_shm_header*>(base);
+  size_t m = static_cast<size_t>(v.header->m), n = static_cast<size_t>(v.header->n);
+  size_t nz = static_cast<size_t>(v.header->nz), qnz = static_cast<size_t>(v.header->qnz);
+
+  double* d = reinterpret_cast<double*>(v.header + 1);
+  v.acolnzs = d;
+  v.qcolnzs = v.acolnzs + nz;
+  v.rhs = v.qcolnzs + qnz;
+  v.obj = v.rhs + m;
+  v.lbound = v.obj + n;
+  v.ubound = v.lbound + n + m;
+  v.primal = v.ubound + n + m;
+  v.dual = v.primal + n + m;
+
+  int* i = reinterpret_cast<int*>(v.dual + n + m);
+  v.acolcnt = i;
+  v.acolidx = v.acolcnt + n;
+  v.qcolcnt = v.acolidx + nz;
+  v.qcolidx = v.qcolcnt + n;
+  v.status = v.qcolidx + qnz;
+  return v;
+}
 }  // namespace bpmpd_io
@@ -0,0 +1,78 @@
+#pragma once
+#include <trajopt_utils/macros.h>
+TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+TRAJOPT_IGNORE_WARNINGS_POP
+
+#include <trajopt_sco/optimizers.hpp>
+
+namespace sco
+{
+/**
+ * @brief Writes the iteration results of BasicTrustRegionSQP to a compact binary file
+ *
+ * The file replaces the per-iteration CSV logs. Values are stored in native byte order:
+ *
+ *   header:  char[8] magic "SCOITLOG", uint32 version, uint32 n_vars, uint32 n_costs, uint32 n_cnts,
+ *            then the var, cost and constraint names, each as uint32 length followed by the characters
+ *   records: one per trust region step, (RECORD_HEADER_SIZE + n_vars + 3 * n_costs + 4 * n_cnts) float64
+ *            [old_merit, model_merit, new_merit, merit_improve_ratio, merit_error_coeff (the largest),
+ *             new_x, old_cost_vals, model_cost_vals, new_cost_vals, old_cnt_viols, model_cnt_viols, new_cnt_viols,
+ *             merit_error_coeffs]
+ *
+ * Records are handed to a background thread through a bounded queue, so the optimizer does not wait on the disk
+ * unless the queue is full. trajopt/scripts/convert_iteration_log.py converts a log back to the CSV files.
+ */
+class IterationLogWriter
+{
+public:
+  static const char MAGIC[8];
+  static const uint32_t VERSION = 2;
+  static const size_t RECORD_HEADER_SIZE = 5;
+
+  /**
+   * @brief Opens the file and writes the header. If the file can not be opened an error is logged and write() does
+   * nothing
+   * @param max_queued_records Records waiting for the writer thread before write() blocks
+   */
+  IterationLogWriter(const std::string& path,
+                     const std::vector<std::string>& var_names,
+                     const std::vector<std::string>& cost_names,
+                     const std::vector<std::string>& cnt_names,
+                     size_t max_queued_records = 64);
+
+  /** @brief Writes the remaining records and closes the file */
+  ~IterationLogWriter();
+
+  IterationLogWriter(const IterationLogWriter&) = delete;
+  IterationLogWriter& operator=(const IterationLogWriter&) = delete;
+
+  bool isOpen() const { return stream_ != nullptr; }
+
+  /** @brief Queue a record of the results of a trust region step */
+  void write(const BasicTrustRegionSQPResults& results);
+
+private:
+  void run();
+
+  std::FILE* stream_;
+  size_t record_size_;
+  size_t max_queued_records_;
+
+  std::deque<std::vector<double>> queue_;
+  /** @brief Buffers of written records, reused to avoid an allocation per record */
+  std::vector<std::vector<double>> free_;
+  bool done_;
+  std::mutex mutex_;
+  std::condition_variable not_empty_;
+  std::condition_variable not_full_;
+  std::thread thread_;
+};
+}  // namespace sco
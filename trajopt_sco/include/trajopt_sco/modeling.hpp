@@ -33,6 +33,9 @@ public:
   void addAffExpr(const AffExpr&);
   void addQuadExpr(const QuadExpr&);
   void addHinge(const AffExpr&, double coeff);
+  /** Adds coeff * (hinge(expr - upper) + hinge(lower - expr)). When lower <= upper at most one side can be active, so
+   * both sides share a single auxiliary variable instead of the two that separate hinges would add */
+  void addSoftBound(const AffExpr&, double lower, double upper, double coeff);
   void addAbs(const AffExpr&, double coeff);
   void addHinges(const AffExprVector&);
   void addL1Norm(const AffExprVector&);
@@ -110,6 +113,12 @@ public:
   virtual ConvexObjective::Ptr convex(const DblVec& x, Model* model) = 0;
   /** Get problem variables associated with this cost */
   virtual VarVector getVars() = 0;
+  /** True if the cost is exactly quadratic (or affine / hinge of affine) so convex() does not depend on x. The
+   * optimizer then adds its convex model once and keeps it in the model for every iteration */
+  virtual bool isConvex() { return false; }
+  /** Forget state kept from earlier convexifications, e.g. a quasi-Newton Hessian. Called at the start of every
+   * optimization and when the function of the cost changes */
+  virtual void reset() {}
   std::string name() { return name_; }
   void setName(const std::string& name) { name_ = name; }
   Cost() : name_("unnamed") {}
@@ -198,8 +207,10 @@ public:
   /** Note: in the current implementation, this function just adds the
    * constraint to the
    * model. So if you're not careful, you might end up with an infeasible
-   * problem. */
-  void addLinearConstraint(const AffExpr&, ConstraintType type);
+   * problem. The returned handle can be passed to removeLinearConstraints. */
+  Cnt addLinearConstraint(const AffExpr&, ConstraintType type);
+  /** Remove constraints added with addLinearConstraint */
+  void removeLinearConstraints(const CntVector& cnts);
   /** Add nonlinear cost function */
   void addCost(Cost::Ptr);
   /** Add nonlinear constraint function */
@@ -209,6 +220,8 @@ public:
   /** Find closest point to solution vector x that satisfies linear inequality
    * constraints */
   DblVec getCentralFeasiblePoint(const DblVec& x);
+  /** Clamps x to the variable bounds. A QP is only solved if the clamped point violates a linear constraint, and its
+   * solution is reused while x, the bounds and the linear constraints stay the same. */
   DblVec getClosestFeasiblePoint(const DblVec& x);
 
   std::vector<Constraint::Ptr> getConstraints() const;
@@ -232,6 +245,15 @@ protected:
   std::vector<Constraint::Ptr> eqcnts_;
   std::vector<Constraint::Ptr> ineqcnts_;
 
+  /** Constraints added with addLinearConstraint, to check points against without solving a QP */
+  CntVector linear_cnts_;
+  AffExprVector linear_cnt_exprs_;
+  ConstraintTypeVector linear_cnt_types_;
+
+  /** Last point projected with a QP and its projection, cleared when the bounds or linear constraints change */
+  DblVec closest_feasible_x_;
+  DblVec closest_feasible_point_;
+
   OptProb(OptProb&);
 };
 
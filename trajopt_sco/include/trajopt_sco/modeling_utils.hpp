@@ -18,6 +18,42 @@ enum PenaltyType
   HINGE
 };
 
+/** @brief Quasi-Newton approximation of the curvature of a cost term that is not given to the QP otherwise */
+enum QuasiNewtonType
+{
+  QN_NONE,
+  QN_BFGS, /**< damped BFGS, stays positive definite */
+  QN_SR1   /**< symmetric rank one, may be indefinite, only its positive part is used */
+};
+
+/**
+Hessian approximation of a cost term, updated from the gradients at successive convexification points. The first
+update scales an identity matrix by y'y / s'y, where s and y are the differences of the points and gradients. BFGS
+uses Powell's damping so that the approximation stays positive definite when s'y is small or negative, e.g. across a
+kink of an ABS or HINGE penalty.
+ */
+class QuasiNewtonHessian
+{
+public:
+  QuasiNewtonHessian(QuasiNewtonType type = QN_NONE) : type_(type) {}
+
+  /** @brief Updates the approximation with the gradient at x. Points closer than 1e-10 to the last one are skipped. */
+  void update(const Eigen::VectorXd& x, const Eigen::VectorXd& grad);
+  /** @brief Forgets the approximation and the last point, e.g. when the problem changes */
+  void reset();
+
+  QuasiNewtonType type() const { return type_; }
+  /** @brief True once two distinct points were seen */
+  bool valid() const { return hess_.size() > 0; }
+  /** @brief The positive semidefinite part of the approximation */
+  Eigen::MatrixXd hessian() const;
+
+private:
+  QuasiNewtonType type_;
+  Eigen::VectorXd x_, grad_;
+  Eigen::MatrixXd hess_;
+};
+
 /**
 x is the big solution vector of the whole problem. vars are variables that
 index into the vector x
@@ -31,6 +67,17 @@ DblVec getDblVec(const DblVec& x, const VarVector& vars);
 
 AffExpr affFromValGrad(double y, const Eigen::VectorXd& x, const Eigen::VectorXd& dydx, const VarVector& vars);
 
+/**
+Linearize the rows of an error function about x. The Jacobian is taken from dfdx or sparse_dfdx if provided, otherwise
+it is calculated numerically. With a sparse Jacobian only the stored entries of each row appear in its expression.
+ */
+std::vector<AffExpr> linearizeErrFunc(const VectorOfVector& f,
+                                      const MatrixOfVector::Ptr& dfdx,
+                                      const SparseMatrixOfVector::Ptr& sparse_dfdx,
+                                      const Eigen::VectorXd& x,
+                                      const VarVector& vars,
+                                      double epsilon);
+
 class CostFromFunc : public Cost
 {
 public:
@@ -41,12 +88,17 @@ public:
   double value(const DblVec& x) override;
   ConvexObjective::Ptr convex(const DblVec& x, Model* model) override;
   VarVector getVars() override { return vars_; }
+  /** @brief Replaces the diagonal Hessian by a quasi-Newton approximation once it is available. Ignored with
+   * full_hessian. */
+  void setQuasiNewton(QuasiNewtonType type) { qn_hessian_ = QuasiNewtonHessian(type); }
+  void reset() override { qn_hessian_.reset(); }
 
 protected:
   ScalarOfVector::Ptr f_;
   VarVector vars_;
   bool full_hessian_;
   double epsilon_;
+  QuasiNewtonHessian qn_hessian_;
 };
 
 class CostFromErrFunc : public Cost
@@ -65,17 +117,32 @@ public:
                   const Eigen::VectorXd& coeffs,
                   PenaltyType pen_type,
                   const std::string& name);
+  /// supply error function and sparse gradient
+  CostFromErrFunc(VectorOfVector::Ptr f,
+                  SparseMatrixOfVector::Ptr dfdx,
+                  const VarVector& vars,
+                  const Eigen::VectorXd& coeffs,
+                  PenaltyType pen_type,
+                  const std::string& name);
   double value(const DblVec& x) override;
   ConvexObjective::Ptr convex(const DblVec& x, Model* model) override;
   VarVector getVars() override { return vars_; }
+  /** @brief The error function, e.g. to change its target between optimizations */
+  VectorOfVector::Ptr getErrFunc() const { return f_; }
+  /** @brief Adds a quasi-Newton approximation of the curvature to the ABS and HINGE penalties, which are only
+   * linearized otherwise. Ignored for SQUARED. */
+  void setQuasiNewton(QuasiNewtonType type) { qn_hessian_ = QuasiNewtonHessian(type); }
+  void reset() override { qn_hessian_.reset(); }
 
 protected:
   VectorOfVector::Ptr f_;
   MatrixOfVector::Ptr dfdx_;
+  SparseMatrixOfVector::Ptr sparse_dfdx_;
   VarVector vars_;
   Eigen::VectorXd coeffs_;
   PenaltyType pen_type_;
   double epsilon_;
+  QuasiNewtonHessian qn_hessian_;
 };
 
 class ConstraintFromErrFunc : public Constraint
@@ -96,14 +163,24 @@ public:
                         const Eigen::VectorXd& coeffs,
                         ConstraintType type,
                         const std::string& name);
+  /// supply error function and sparse gradient
+  ConstraintFromErrFunc(VectorOfVector::Ptr f,
+                        SparseMatrixOfVector::Ptr dfdx,
+                        const VarVector& vars,
+                        const Eigen::VectorXd& coeffs,
+                        ConstraintType type,
+                        const std::string& name);
   DblVec value(const DblVec& x) override;
   ConvexConstraints::Ptr convex(const DblVec& x, Model* model) override;
   ConstraintType type() override { return type_; }
   VarVector getVars() override { return vars_; }
+  /** @brief The error function, e.g. to change its target between optimizations */
+  VectorOfVector::Ptr getErrFunc() const { return f_; }
 
 protected:
   VectorOfVector::Ptr f_;
   MatrixOfVector::Ptr dfdx_;
+  SparseMatrixOfVector::Ptr sparse_dfdx_;
   VarVector vars_;
   Eigen::VectorXd coeffs_;
   ConstraintType type_;
@@ -2,6 +2,7 @@
 #include <trajopt_utils/macros.h>
 TRAJOPT_IGNORE_WARNINGS_PUSH
 #include <Eigen/Dense>
+#include <Eigen/Sparse>
 #include <functional>
 #include <memory>
 TRAJOPT_IGNORE_WARNINGS_POP
@@ -45,6 +46,22 @@ public:
   using func = std::function<Eigen::MatrixXd(const Eigen::VectorXd&)>;
   static MatrixOfVector::Ptr construct(const func&);
 };
+/**
+ * @brief Analytic Jacobian returned in row-major sparse form
+ *
+ * Used for error functions that span many variables but where each row only depends on a few of them, e.g. a
+ * trajectory-wide finite difference. Only the stored entries are turned into terms when convexifying.
+ */
+class SparseMatrixOfVector
+{
+public:
+  using Ptr = std::shared_ptr<SparseMatrixOfVector>;
+  using SparseMatrix = Eigen::SparseMatrix<double, Eigen::RowMajor>;
+
+  virtual SparseMatrix operator()(const Eigen::VectorXd& x) const = 0;
+  SparseMatrix call(const Eigen::VectorXd& x) const { return operator()(x); }
+  virtual ~SparseMatrixOfVector() {}
+};
 
 Eigen::VectorXd calcForwardNumGrad(const ScalarOfVector& f, const Eigen::VectorXd& x, double epsilon);
 Eigen::MatrixXd calcForwardNumJac(const VectorOfVector& f, const Eigen::VectorXd& x, double epsilon);
@@ -2,9 +2,11 @@
 #include <trajopt_utils/macros.h>
 TRAJOPT_IGNORE_WARNINGS_PUSH
 #include <functional>
+#include <map>
 #include <string>
 TRAJOPT_IGNORE_WARNINGS_POP
 
+#include <trajopt_sco/anytime.hpp>
 #include <trajopt_sco/modeling.hpp>
 /*
  * Algorithms for non-convex, constrained optimization
@@ -18,14 +20,70 @@ enum OptStatus
   OPT_SCO_ITERATION_LIMIT,  // hit iteration limit before convergence
   OPT_PENALTY_ITERATION_LIMIT,
   OPT_FAILED,
-  INVALID
+  INVALID,
+  OPT_TIME_LIMIT,  // hit max_time before convergence
+  OPT_CANCELLED    // stopped through the cancellation token
 };
 static const char* OptStatus_strings[] = { "CONVERGED",
                                            "SCO_ITERATION_LIMIT",
                                            "PENALTY_ITERATION_LIMIT",
                                            "FAILED",
-                                           "INVALID" };
+                                           "INVALID",
+                                           "TIME_LIMIT",
+                                           "CANCELLED" };
 inline std::string statusToString(OptStatus status) { return OptStatus_strings[status]; }
+/** @brief Time (s) spent in each phase of an optimization */
+struct OptPhaseTiming
+{
+  /** @brief Convexifying the costs and constraints. This includes collision checking */
+  double convexify{ 0 };
+  /** @brief Adding the convex terms to the QP model and setting its objective */
+  double qp_build{ 0 };
+  /** @brief Solving the QP, including the initial projection onto the variable bounds */
+  double qp_solve{ 0 };
+  /** @brief Evaluating the exact and model costs and constraints for the merit */
+  double evaluate{ 0 };
+
+  double sum() const { return convexify + qp_build + qp_solve + evaluate; }
+  OptPhaseTiming& operator+=(const OptPhaseTiming& other);
+};
+
+/** @brief Time (s) spent in a cost or constraint */
+struct OptTermTiming
+{
+  double convexify{ 0 };
+  double evaluate{ 0 };
+};
+
+/**
+ * @brief Timing report of an optimization
+ *
+ * Only filled if timing is enabled in the optimizer parameters (see BasicTrustRegionSQPParameters::record_timing).
+ */
+struct OptTiming
+{
+  /** @brief Wall time of the whole optimization */
+  double total{ 0 };
+  /** @brief Phase times summed over the optimization */
+  OptPhaseTiming phases;
+  /** @brief Phase times of each sqp iteration */
+  std::vector<OptPhaseTiming> iterations;
+  /** @brief Cost times summed by cost name */
+  std::map<std::string, OptTermTiming> costs;
+  /** @brief Constraint times summed by constraint name */
+  std::map<std::string, OptTermTiming> cnts;
+
+  void clear()
+  {
+    total = 0;
+    phases = OptPhaseTiming();
+    iterations.clear();
+    costs.clear();
+    cnts.clear();
+  }
+};
+std::ostream& operator<<(std::ostream& o, const OptTiming& t);
+
 struct OptResults
 {
   DblVec x;  // solution estimate
@@ -33,15 +91,29 @@ struct OptResults
   double total_cost;
   DblVec cost_vals;
   DblVec cnt_viols;
+  DblVec merit_error_coeffs;  // penalty coefficient of each constraint when the optimization ended
   int n_func_evals, n_qp_solves;
+  int n_merit_increases;    // number of penalty iterations that increased at least one coefficient
+  int n_rejected_steps;     // QP solves whose step was rejected and the trust region shrunk
+  int n_filter_steps;       // steps accepted by the filter that the merit ratio test would have rejected
+  int n_backtrack_steps;    // rejected steps that were accepted after backtracking along them
+  DblVec trust_box_scales;  // trust region scale of each variable when the optimization ended
+  OptTiming timing;
   void clear()
   {
     x.clear();
     status = INVALID;
     cost_vals.clear();
     cnt_viols.clear();
+    merit_error_coeffs.clear();
     n_func_evals = 0;
     n_qp_solves = 0;
+    n_merit_increases = 0;
+    n_rejected_steps = 0;
+    n_filter_steps = 0;
+    n_backtrack_steps = 0;
+    trust_box_scales.clear();
+    timing.clear();
   }
   OptResults() { clear(); }
 };
@@ -63,11 +135,24 @@ public:
   OptResults& results() { return results_; }
   using Callback = std::function<void(OptProb*, OptResults&)>;
   void addCallback(const Callback& f);  // called before each iteration
+  /**
+   * @brief Anytime mode: every feasible iterate that improves on the last published one is published to mailbox while
+   * the optimization runs. Null disables it.
+   */
+  void setAnytimeMailbox(const AnytimeMailbox::Ptr& mailbox) { mailbox_ = mailbox; }
+  /** @brief The optimization returns OPT_CANCELLED at the next phase boundary after token is cancelled */
+  void setCancellationToken(const CancellationToken::Ptr& token) { cancellation_token_ = token; }
+
 protected:
   std::vector<Callback> callbacks_;
   void callCallbacks();
   OptProb::Ptr prob_;
   OptResults results_;
+  AnytimeMailbox::Ptr mailbox_;
+  CancellationToken::Ptr cancellation_token_;
+
+  /** @brief True if the cancellation token was cancelled */
+  bool cancelled() const { return cancellation_token_ && cancellation_token_->isCancelled(); }
 };
 
 struct BasicTrustRegionSQPParameters
@@ -92,12 +177,47 @@ struct BasicTrustRegionSQPParameters
   double max_merit_coeff_increases;   // number of times that we jack up penalty
                                       // coefficient
   double merit_coeff_increase_ratio;  // ratio that we increate coeff each time
-  double max_time;                    // not yet implemented
-  double merit_error_coeff;           // initial penalty coefficient
+  double max_time;                    // wall time (s) after which no new sqp iteration is started
+  double merit_error_coeff;           // initial penalty coefficient of each constraint
   double trust_box_size;              // current size of trust region (component-wise)
 
-  bool log_results;     // Log results to file
+  /** @brief Only increase the penalty coefficients of the constraints that are still violated, instead of all */
+  bool merit_coeff_increase_violated_only;
+
+  /**
+   * @brief Also accept steps that the filter accepts, i.e. that improve the total cost or the total constraint violation
+   * compared to the current point and every point in the filter, even if the merit did not improve enough
+   */
+  bool use_filter;
+  /** @brief Fraction of the violation of a filter point by which a step has to improve on it (see use_filter) */
+  double filter_margin;
+
+  /**
+   * @brief Number of points x + alpha * d along a rejected QP step d that are evaluated before the trust region is
+   * shrunk, with alpha = backtrack_ratio, backtrack_ratio^2, ... A point is accepted if its exact merit improvement is
+   * at least improve_ratio_threshold * alpha times the predicted improvement of the full step. 0 disables backtracking.
+   */
+  int max_backtrack_steps;
+  double backtrack_ratio;  // ratio by which alpha is reduced at each backtracking step
+
+  /**
+   * @brief Scale of the trust region of each variable, the box of variable i is trust_box_size * trust_box_scales[i]
+   *
+   * Empty means 1 for all variables. A shorter vector whose size divides the number of variables is repeated, so for a
+   * trajectory stored row by row it holds one scale per column, e.g. per joint and for the time column.
+   */
+  DblVec trust_box_scales;
+  /**
+   * @brief Adapt the scales from the accepted steps: the scale of a variable whose step reached its box is multiplied
+   * by trust_box_scale_ratio, the scale of a variable that used less than a quarter of its box is divided by it. The
+   * scales stay within [0.1, 10] times their initial value.
+   */
+  bool adapt_trust_box_scales;
+  double trust_box_scale_ratio;
+
+  bool log_results;     // Log results to file (log_dir/trajopt_iterations.bin, see IterationLogWriter)
   std::string log_dir;  // Directory to store log results (Default: /tmp)
+  bool record_timing;   // Record the time spent in each phase and term in OptResults::timing
 
   BasicTrustRegionSQPParameters();
 };
@@ -130,12 +250,12 @@ struct BasicTrustRegionSQPResults
   DblVec new_cnt_viols;
   /** @brief The previous iterations constraint (exact) values */
   DblVec old_cnt_viols;
-  /** @brief The previous iterations (exact) merit = vecSum(old_cost_vals) + merit_error_coeff * vecSum(old_cnt_viols)
+  /** @brief The previous iterations (exact) merit = vecSum(old_cost_vals) + vecDot(merit_error_coeffs, old_cnt_viols)
    */
   double old_merit;
-  /** @brief The models merit = vecSum(model_cost_vals) + merit_error_coeff * vecSum(model_cnt_viols) */
+  /** @brief The models merit = vecSum(model_cost_vals) + vecDot(merit_error_coeffs, model_cnt_viols) */
   double model_merit;
-  /** @brief The exact merit = vecSum(new_cost_vals) + merit_error_coeff * vecSum(new_cnt_viols) */
+  /** @brief The exact merit = vecSum(new_cost_vals) + vecDot(merit_error_coeffs, new_cnt_viols) */
   double new_merit;
   /**
    * @brief A measure of improvement approximated using values from the model.
@@ -152,7 +272,9 @@ struct BasicTrustRegionSQPResults
    * merit_improve_ratio = exact_merit_improve / approx_merit_improve;
    */
   double merit_improve_ratio;
-  /** @brief This is the penalty applied to the constraints for this iteration */
+  /** @brief The penalty applied to each constraint for this iteration */
+  DblVec merit_error_coeffs;
+  /** @brief The largest penalty applied to a constraint for this iteration */
   double merit_error_coeff;
   /** @brief Variable names */
   const std::vector<std::string> var_names;
@@ -174,7 +296,9 @@ struct BasicTrustRegionSQPResults
    * @param cnt_cost_models The current constraint cost models
    * @param constraints The current exact constraints
    * @param costs The current exact costs
-   * @param merit_error_coeff The iteration penalty to apply to constraints
+   * @param merit_error_coeffs The iteration penalty to apply to each constraint
+   * @param cost_times If not null or empty, the time spent evaluating each cost is added to its entry
+   * @param cnt_times If not null or empty, the time spent evaluating each constraint is added to its entry
    */
   void update(const OptResults& prev_opt_results,
               const Model& model,
@@ -183,18 +307,12 @@ struct BasicTrustRegionSQPResults
               const std::vector<ConvexObjective::Ptr>& cnt_cost_models,
               const std::vector<Constraint::Ptr>& constraints,
               const std::vector<Cost::Ptr>& costs,
-              const double merit_error_coeff);
+              const DblVec& merit_error_coeffs,
+              DblVec* cost_times = nullptr,
+              DblVec* cnt_times = nullptr);
 
   /** @brief Print current results to the terminal */
   void print() const;
-  /** @brief Write solver results to a file */
-  void writeSolver(std::FILE* stream, bool header = false) const;
-  /** @brief Write variable values to a file */
-  void writeVars(std::FILE* stream, bool header = false) const;
-  /** @brief Write cost results to file */
-  void writeCosts(std::FILE* stream, bool header = false) const;
-  /** @brief Write constraint results to file */
-  void writeConstraints(std::FILE* stream, bool header = false) const;
 };
 
 class BasicTrustRegionSQP : public Optimizer
@@ -224,7 +342,13 @@ public:
 protected:
   void adjustTrustRegion(double ratio);
   void setTrustBoxConstraints(const DblVec& x);
+  /** @brief Expands trust_box_scales to one scale per variable */
+  void initTrustBoxScales();
+  /** @brief Adapts the scales to the accepted step from x to new_x (see adapt_trust_box_scales) */
+  void adaptTrustBoxScales(const DblVec& x, const DblVec& new_x);
   Model::Ptr model_;
   BasicTrustRegionSQPParameters param_;
+  DblVec trust_box_scales_;          // scale of the trust region of each variable
+  DblVec initial_trust_box_scales_;  // scales at the start of the optimization, to bound the adaptation
 };
 }  // namespace sco
@@ -179,6 +179,7 @@ public:
     BPMPD,
     OSQP,
     QPOASES,
+    BANDED,
     AUTO_SOLVER
   };
 
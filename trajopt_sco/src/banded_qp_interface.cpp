@@ -0,0 +1,732 @@
+#include <trajopt_utils/macros.h>
+TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+TRAJOPT_IGNORE_WARNINGS_POP
+
+#include <trajopt_sco/banded_qp_interface.hpp>
+#include <trajopt_utils/logging.hpp>
+
+namespace sco
+{
+namespace
+{
+const double BANDED_INFINITY = std::numeric_limits<double>::infinity();
+
+/** @brief Pivots closer to zero (or of the wrong sign) are replaced, the refinement corrects the solution */
+const double MIN_PIVOT = 1e-13;
+const double REPLACED_PIVOT = 1e-8;
+
+double maxAbs(const Eigen::VectorXd& v) { return v.size() == 0 ? 0. : v.lpNorm<Eigen::Infinity>(); }
+
+/** @brief out = M * x for the rows of M */
+void multiplyRows(const std::vector<size_t>& ptr,
+                  const std::vector<size_t>& idx,
+                  const DblVec& val,
+                  const Eigen::VectorXd& x,
+                  Eigen::VectorXd& out)
+{
+  const size_t m = ptr.size() - 1;
+  out.resize(static_cast<Eigen::Index>(m));
+  for (size_t r = 0; r < m; ++r)
+  {
+    double sum = 0.;
+    for (size_t k = ptr[r]; k < ptr[r + 1]; ++k)
+      sum += val[k] * x[static_cast<Eigen::Index>(idx[k])];
+    out[static_cast<Eigen::Index>(r)] = sum;
+  }
+}
+
+/** @brief out += M' * y for the rows of M */
+void addMultiplyRowsTransposed(const std::vector<size_t>& ptr,
+                               const std::vector<size_t>& idx,
+                               const DblVec& val,
+                               const Eigen::VectorXd& y,
+                               Eigen::VectorXd& out)
+{
+  const size_t m = ptr.size() - 1;
+  for (size_t r = 0; r < m; ++r)
+  {
+    const double yr = y[static_cast<Eigen::Index>(r)];
+    for (size_t k = ptr[r]; k < ptr[r + 1]; ++k)
+      out[static_cast<Eigen::Index>(idx[k])] += val[k] * yr;
+  }
+}
+
+/** @brief Largest step in [0, 1] that keeps v + step * dv >= 0 */
+double maxStep(const Eigen::VectorXd& v, const Eigen::VectorXd& dv)
+{
+  double step = 1.;
+  for (Eigen::Index i = 0; i < v.size(); ++i)
+  {
+    if (dv[i] < 0.)
+      step = std::min(step, -v[i] / dv[i]);
+  }
+  return step;
+}
+
+/**
+ * @brief Breadth first search from start over the unnumbered nodes
+ * @return The number of levels, last_level is set to the nodes of the last level
+ */
+size_t bfsLevels(size_t start,
+                 const std::vector<size_t>& adj_ptr,
+                 const std::vector<size_t>& adj,
+                 const std::vector<bool>& numbered,
+                 std::vector<size_t>& stamp,
+                 size_t stamp_value,
+                 std::vector<size_t>& last_level)
+{
+  std::vector<size_t> level{ start };
+  stamp[start] = stamp_value;
+  size_t n_levels = 0;
+  while (!level.empty())
+  {
+    ++n_levels;
+    std::vector<size_t> next;
+    for (size_t u : level)
+    {
+      for (size_t k = adj_ptr[u]; k < adj_ptr[u + 1]; ++k)
+      {
+        size_t v = adj[k];
+        if (!numbered[v] && stamp[v] != stamp_value)
+        {
+          stamp[v] = stamp_value;
+          next.push_back(v);
+        }
+      }
+    }
+    if (next.empty())
+      last_level = level;
+    level.swap(next);
+  }
+  return n_levels;
+}
+
+/** @brief Member-wise copy, AffExpr has a user-declared copy constructor but no assignment operator */
+void assignAffExpr(AffExpr& to, const AffExpr& from)
+{
+  to.constant = from.constant;
+  to.coeffs = from.coeffs;
+  to.vars = from.vars;
+}
+}  // namespace
+
+Model::Ptr createBandedQPModel()
+{
+  Model::Ptr out(new BandedQPModel());
+  return out;
+}
+
+void BandedQPModel::SparseRows::addRow(const AffExpr& expr)
+{
+  std::vector<std::pair<size_t, double>> entries;
+  entries.reserve(expr.size());
+  for (size_t i = 0; i < expr.size(); ++i)
+    entries.emplace_back(static_cast<size_t>(expr.vars[i].var_rep->index), expr.coeffs[i]);
+  std::sort(entries.begin(), entries.end());
+
+  for (size_t i = 0; i < entries.size();)
+  {
+    size_t j = i;
+    double coeff = 0.;
+    for (; j < entries.size() && entries[j].first == entries[i].first; ++j)
+      coeff += entries[j].second;
+    if (coeff != 0.)
+    {
+      idx.push_back(entries[i].first);
+      val.push_back(coeff);
+    }
+    i = j;
+  }
+  ptr.push_back(idx.size());
+  rhs.push_back(-expr.constant);
+}
+
+void BandedQPModel::SparseRows::addRow(size_t var, double coeff, double row_rhs)
+{
+  idx.push_back(var);
+  val.push_back(coeff);
+  ptr.push_back(idx.size());
+  rhs.push_back(row_rhs);
+}
+
+BandedQPModel::BandedQPModel() = default;
+
+BandedQPModel::~BandedQPModel() = default;
+
+Var BandedQPModel::addVar(const std::string& name)
+{
+  vars_.push_back(new VarRep(static_cast<int>(vars_.size()), name, this));
+  lbs_.push_back(-BANDED_INFINITY);
+  ubs_.push_back(BANDED_INFINITY);
+  return vars_.back();
+}
+
+Cnt BandedQPModel::addEqCnt(const AffExpr& expr, const std::string& /*name*/)
+{
+  cnts_.push_back(new CntRep(static_cast<int>(cnts_.size()), this));
+  cnt_exprs_.push_back(expr);
+  cnt_types_.push_back(EQ);
+  return cnts_.back();
+}
+
+Cnt BandedQPModel::addIneqCnt(const AffExpr& expr, const std::string& /*name*/)
+{
+  cnts_.push_back(new CntRep(static_cast<int>(cnts_.size()), this));
+  cnt_exprs_.push_back(expr);
+  cnt_types_.push_back(INEQ);
+  return cnts_.back();
+}
+
+Cnt BandedQPModel::addIneqCnt(const QuadExpr&, const std::string& /*name*/)
+{
+  throw std::runtime_error("NOT IMPLEMENTED");
+  return Cnt();
+}
+
+void BandedQPModel::removeVars(const VarVector& vars)
+{
+  for (const Var& var : vars)
+    var.var_rep->removed = true;
+}
+
+void BandedQPModel::removeCnts(const CntVector& cnts)
+{
+  for (const Cnt& cnt : cnts)
+    cnt.cnt_rep->removed = true;
+}
+
+void BandedQPModel::update()
+{
+  {
+    size_t inew = 0;
+    for (size_t iold = 0; iold < vars_.size(); ++iold)
+    {
+      const Var& var = vars_[iold];
+      if (!var.var_rep->removed)
+      {
+        vars_[inew].var_rep = var.var_rep;
+        lbs_[inew] = lbs_[iold];
+        ubs_[inew] = ubs_[iold];
+        var.var_rep->index = static_cast<int>(inew);
+        ++inew;
+      }
+      else
+        delete var.var_rep;
+    }
+    vars_.resize(inew);
+    lbs_.resize(inew);
+    ubs_.resize(inew);
+  }
+  {
+    size_t inew = 0;
+    for (size_t iold = 0; iold < cnts_.size(); ++iold)
+    {
+      const Cnt& cnt = cnts_[iold];
+      if (!cnt.cnt_rep->removed)
+      {
+        cnts_[inew].cnt_rep = cnt.cnt_rep;
+        assignAffExpr(cnt_exprs_[inew], cnt_exprs_[iold]);
+        cnt_types_[inew] = cnt_types_[iold];
+        cnt.cnt_rep->index = static_cast<int>(inew);
+        ++inew;
+      }
+      else
+        delete cnt.cnt_rep;
+    }
+    cnts_.resize(inew);
+    cnt_exprs_.resize(inew);
+    cnt_types_.resize(inew);
+  }
+}
+
+void BandedQPModel::setVarBounds(const VarVector& vars, const DblVec& lower, const DblVec& upper)
+{
+  for (size_t i = 0; i < vars.size(); ++i)
+  {
+    const size_t varind = static_cast<size_t>(vars[i].var_rep->index);
+    lbs_[varind] = lower[i];
+    ubs_[varind] = upper[i];
+  }
+}
+
+DblVec BandedQPModel::getVarValues(const VarVector& vars) const
+{
+  DblVec out(vars.size());
+  for (size_t i = 0; i < vars.size(); ++i)
+    out[i] = solution_[static_cast<size_t>(vars[i].var_rep->index)];
+  return out;
+}
+
+void BandedQPModel::buildProblem()
+{
+  const size_t n = vars_.size();
+
+  P_rows_.clear();
+  P_cols_.clear();
+  P_vals_.clear();
+  for (size_t i = 0; i < objective_.size(); ++i)
+  {
+    if (objective_.coeffs[i] == 0.)
+      continue;
+    size_t r = static_cast<size_t>(objective_.vars1[i].var_rep->index);
+    size_t c = static_cast<size_t>(objective_.vars2[i].var_rep->index);
+    if (r < c)
+      std::swap(r, c);
+    P_rows_.push_back(r);
+    P_cols_.push_back(c);
+    P_vals_.push_back(r == c ? 2. * objective_.coeffs[i] : objective_.coeffs[i]);
+  }
+
+  q_ = Eigen::VectorXd::Zero(static_cast<Eigen::Index>(n));
+  const AffExpr& aff = objective_.affexpr;
+  for (size_t i = 0; i < aff.size(); ++i)
+    q_[aff.vars[i].var_rep->index] += aff.coeffs[i];
+
+  eq_ = SparseRows();
+  ineq_ = SparseRows();
+  for (size_t i = 0; i < cnt_exprs_.size(); ++i)
+  {
+    if (cnt_types_[i] == EQ)
+      eq_.addRow(cnt_exprs_[i]);
+    else
+      ineq_.addRow(cnt_exprs_[i]);
+  }
+
+  for (size_t i = 0; i < n; ++i)
+  {
+    // A fixed variable has no interior, it is constrained with an equality instead
+    if (lbs_[i] == ubs_[i])
+    {
+      eq_.addRow(i, 1., lbs_[i]);
+      continue;
+    }
+    if (std::isfinite(lbs_[i]))
+      ineq_.addRow(i, -1., -lbs_[i]);
+    if (std::isfinite(ubs_[i]))
+      ineq_.addRow(i, 1., ubs_[i]);
+  }
+}
+
+void BandedQPModel::orderSystem()
+{
+  const size_t n = vars_.size();
+  const size_t n_nodes = n + eq_.size();
+
+  // Adjacency of the variables and equality rows in the Newton system
+  std::vector<std::pair<size_t, size_t>> edges;
+  for (size_t k = 0; k < P_vals_.size(); ++k)
+  {
+    if (P_rows_[k] != P_cols_[k])
+      edges.emplace_back(P_rows_[k], P_cols_[k]);
+  }
+  for (size_t r = 0; r < ineq_.size(); ++r)
+  {
+    for (size_t a = ineq_.ptr[r]; a < ineq_.ptr[r + 1]; ++a)
+      for (size_t b = ineq_.ptr[r]; b < a; ++b)
+        edges.emplace_back(ineq_.idx[a], ineq_.idx[b]);
+  }
+  for (size_t r = 0; r < eq_.size(); ++r)
+  {
+    for (size_t a = eq_.ptr[r]; a < eq_.ptr[r + 1]; ++a)
+      edges.emplace_back(n + r, eq_.idx[a]);
+  }
+
+  std::vector<size_t> adj_ptr(n_nodes + 1, 0);
+  for (const auto& edge : edges)
+  {
+    ++adj_ptr[edge.first + 1];
+    ++adj_ptr[edge.second + 1];
+  }
+  for (size_t i = 0; i < n_nodes; ++i)
+    adj_ptr[i + 1] += adj_ptr[i];
+  std::vector<size_t> adj(adj_ptr.back());
+  {
+    std::vector<size_t> fill(adj_ptr.begin(), adj_ptr.end() - 1);
+    for (const auto& edge : edges)
+    {
+      adj[fill[edge.first]++] = edge.second;
+      adj[fill[edge.second]++] = edge.first;
+    }
+  }
+  // Remove the duplicate edges of terms that touch the same pair of nodes
+  {
+    size_t out = 0;
+    size_t begin = 0;
+    for (size_t i = 0; i < n_nodes; ++i)
+    {
+      size_t end = adj_ptr[i + 1];
+      std::sort(adj.begin() + static_cast<long>(begin), adj.begin() + static_cast<long>(end));
+      size_t row_begin = out;
+      for (size_t k = begin; k < end; ++k)
+      {
+        if (out == row_begin || adj[out - 1] != adj[k])
+          adj[out++] = adj[k];
+      }
+      begin = end;
+      adj_ptr[i + 1] = out;
+    }
+    adj.resize(out);
+  }
+  auto degree = [&adj_ptr](size_t u) { return adj_ptr[u + 1] - adj_ptr[u]; };
+
+  // Reverse Cuthill-McKee, started from a pseudo-peripheral node of each connected component
+  std::vector<size_t> by_degree(n_nodes);
+  for (size_t i = 0; i < n_nodes; ++i)
+    by_degree[i] = i;
+  std::stable_sort(
+      by_degree.begin(), by_degree.end(), [&degree](size_t a, size_t b) { return degree(a) < degree(b); });
+
+  std::vector<size_t> order;
+  order.reserve(n_nodes);
+  std::vector<bool> numbered(n_nodes, false);
+  std::vector<size_t> stamp(n_nodes, 0);
+  size_t stamp_value = 0;
+  for (size_t seed : by_degree)
+  {
+    if (numbered[seed])
+      continue;
+
+    size_t start = seed;
+    std::vector<size_t> last_level;
+    size_t n_levels = bfsLevels(start, adj_ptr, adj, numbered, stamp, ++stamp_value, last_level);
+    for (int sweep = 0; sweep < 4; ++sweep)
+    {
+      size_t candidate = *std::min_element(
+          last_level.begin(), last_level.end(), [&degree](size_t a, size_t b) { return degree(a) < degree(b); });
+      std::vector<size_t> candidate_last_level;
+      size_t candidate_levels =
+          bfsLevels(candidate, adj_ptr, adj, numbered, stamp, ++stamp_value, candidate_last_level);
+      if (candidate_levels <= n_levels)
+        break;
+      start = candidate;
+      n_levels = candidate_levels;
+      last_level.swap(candidate_last_level);
+    }
+
+    size_t head = order.size();
+    order.push_back(start);
+    numbered[start] = true;
+    std::vector<size_t> neighbors;
+    while (head < order.size())
+    {
+      size_t u = order[head++];
+      neighbors.clear();
+      for (size_t k = adj_ptr[u]; k < adj_ptr[u + 1]; ++k)
+      {
+        if (!numbered[adj[k]])
+        {
+          numbered[adj[k]] = true;
+          neighbors.push_back(adj[k]);
+        }
+      }
+      std::stable_sort(
+          neighbors.begin(), neighbors.end(), [&degree](size_t a, size_t b) { return degree(a) < degree(b); });
+      order.insert(order.end(), neighbors.begin(), neighbors.end());
+    }
+  }
+  std::reverse(order.begin(), order.end());
+
+  perm_.resize(n_nodes);
+  for (size_t p = 0; p < n_nodes; ++p)
+    perm_[order[p]] = p;
+
+  // Envelope of the lower triangle, the fill of the factorization stays inside it
+  env_first_.resize(n_nodes);
+  env_ptr_.resize(n_nodes + 1);
+  env_ptr_[0] = 0;
+  diag_sign_.resize(n_nodes);
+  for (size_t p = 0; p < n_nodes; ++p)
+  {
+    size_t u = order[p];
+    size_t first = p;
+    for (size_t k = adj_ptr[u]; k < adj_ptr[u + 1]; ++k)
+      first = std::min(first, perm_[adj[k]]);
+    env_first_[p] = first;
+    env_ptr_[p + 1] = env_ptr_[p] + p - first + 1;
+    diag_sign_[p] = (u < n) ? 1. : -1.;
+  }
+
+  auto slot = [this](size_t a, size_t b) {
+    size_t row = std::max(a, b);
+    return env_ptr_[row] + std::min(a, b) - env_first_[row];
+  };
+
+  env_base_.assign(env_ptr_.back(), 0.);
+  for (size_t p = 0; p < n_nodes; ++p)
+    env_base_[env_ptr_[p + 1] - 1] = diag_sign_[p] * settings_.regularization;
+  for (size_t k = 0; k < P_vals_.size(); ++k)
+    env_base_[slot(perm_[P_rows_[k]], perm_[P_cols_[k]])] += P_vals_[k];
+  for (size_t r = 0; r < eq_.size(); ++r)
+  {
+    for (size_t a = eq_.ptr[r]; a < eq_.ptr[r + 1]; ++a)
+      env_base_[slot(perm_[n + r], perm_[eq_.idx[a]])] += eq_.val[a];
+  }
+
+  ineq_slots_.clear();
+  for (size_t r = 0; r < ineq_.size(); ++r)
+  {
+    for (size_t a = ineq_.ptr[r]; a < ineq_.ptr[r + 1]; ++a)
+      for (size_t b = ineq_.ptr[r]; b <= a; ++b)
+        ineq_slots_.push_back(slot(perm_[ineq_.idx[a]], perm_[ineq_.idx[b]]));
+  }
+
+  LOG_DEBUG("banded QP: %zu variables, %zu equalities, %zu inequalities, envelope %zu (%.1f per row)",
+            n,
+            eq_.size(),
+            ineq_.size(),
+            env_base_.size(),
+            n_nodes == 0 ? 0. : static_cast<double>(env_base_.size()) / static_cast<double>(n_nodes));
+}
+
+void BandedQPModel::factor(const Eigen::VectorXd& w)
+{
+  env_system_ = env_base_;
+  size_t i_slot = 0;
+  for (size_t r = 0; r < ineq_.size(); ++r)
+  {
+    const double wr = w[static_cast<Eigen::Index>(r)];
+    for (size_t a = ineq_.ptr[r]; a < ineq_.ptr[r + 1]; ++a)
+      for (size_t b = ineq_.ptr[r]; b <= a; ++b)
+        env_system_[ineq_slots_[i_slot++]] += wr * ineq_.val[a] * ineq_.val[b];
+  }
+
+  // Row oriented LDL' in the envelope. While row i is computed it holds L(i, j) * D(j).
+  env_factor_ = env_system_;
+  const size_t n_nodes = env_first_.size();
+  diag_.resize(n_nodes);
+  for (size_t i = 0; i < n_nodes; ++i)
+  {
+    const size_t fi = env_first_[i];
+    double* row_i = &env_factor_[env_ptr_[i]];
+    for (size_t j = fi; j < i; ++j)
+    {
+      const size_t fj = env_first_[j];
+      const double* row_j = &env_factor_[env_ptr_[j]];
+      double sum = row_i[j - fi];
+      for (size_t k = std::max(fi, fj); k < j; ++k)
+        sum -= row_i[k - fi] * row_j[k - fj];
+      row_i[j - fi] = sum;
+    }
+
+    double d = row_i[i - fi];
+    for (size_t j = fi; j < i; ++j)
+    {
+      const double l = row_i[j - fi] / diag_[j];
+      d -= l * row_i[j - fi];
+      row_i[j - fi] = l;
+    }
+    if (diag_sign_[i] * d < MIN_PIVOT)
+      d = diag_sign_[i] * REPLACED_PIVOT;
+    diag_[i] = d;
+  }
+}
+
+void BandedQPModel::solveFactored(DblVec& v) const
+{
+  const size_t n_nodes = env_first_.size();
+  for (size_t i = 0; i < n_nodes; ++i)
+  {
+    const size_t fi = env_first_[i];
+    const double* row_i = &env_factor_[env_ptr_[i]];
+    double sum = v[i];
+    for (size_t k = fi; k < i; ++k)
+      sum -= row_i[k - fi] * v[k];
+    v[i] = sum;
+  }
+  for (size_t i = 0; i < n_nodes; ++i)
+    v[i] /= diag_[i];
+  for (size_t i = n_nodes; i-- > 0;)
+  {
+    const size_t fi = env_first_[i];
+    const double* row_i = &env_factor_[env_ptr_[i]];
+    const double vi = v[i];
+    for (size_t k = fi; k < i; ++k)
+      v[k] -= row_i[k - fi] * vi;
+  }
+}
+
+void BandedQPModel::multiply(const DblVec& in, DblVec& out) const
+{
+  const size_t n_nodes = env_first_.size();
+  out.assign(n_nodes, 0.);
+  for (size_t i = 0; i < n_nodes; ++i)
+  {
+    const size_t fi = env_first_[i];
+    const double* row_i = &env_system_[env_ptr_[i]];
+    double sum = (row_i[i - fi] - diag_sign_[i] * settings_.regularization) * in[i];
+    for (size_t k = fi; k < i; ++k)
+    {
+      sum += row_i[k - fi] * in[k];
+      out[k] += row_i[k - fi] * in[i];
+    }
+    out[i] += sum;
+  }
+}
+
+void BandedQPModel::solve(const Eigen::VectorXd& rhs_x,
+                          const Eigen::VectorXd& rhs_y,
+                          Eigen::VectorXd& dx,
+                          Eigen::VectorXd& dy)
+{
+  const size_t n = static_cast<size_t>(rhs_x.size());
+  const size_t n_nodes = env_first_.size();
+  DblVec rhs(n_nodes);
+  for (size_t i = 0; i < n; ++i)
+    rhs[perm_[i]] = rhs_x[static_cast<Eigen::Index>(i)];
+  for (size_t r = 0; r + n < n_nodes; ++r)
+    rhs[perm_[n + r]] = rhs_y[static_cast<Eigen::Index>(r)];
+
+  DblVec sol = rhs;
+  solveFactored(sol);
+  DblVec residual;
+  for (int step = 0; step < settings_.refinement_steps; ++step)
+  {
+    multiply(sol, residual);
+    for (size_t i = 0; i < n_nodes; ++i)
+      residual[i] = rhs[i] - residual[i];
+    solveFactored(residual);
+    for (size_t i = 0; i < n_nodes; ++i)
+      sol[i] += residual[i];
+  }
+
+  dx.resize(rhs_x.size());
+  dy.resize(rhs_y.size());
+  for (size_t i = 0; i < n; ++i)
+    dx[static_cast<Eigen::Index>(i)] = sol[perm_[i]];
+  for (size_t r = 0; r + n < n_nodes; ++r)
+    dy[static_cast<Eigen::Index>(r)] = sol[perm_[n + r]];
+}
+
+CvxOptStatus BandedQPModel::solveQP()
+{
+  using Eigen::VectorXd;
+  const Eigen::Index n = static_cast<Eigen::Index>(vars_.size());
+  const Eigen::Index n_ineq = static_cast<Eigen::Index>(ineq_.size());
+  const VectorXd b = Eigen::Map<const VectorXd>(eq_.rhs.data(), static_cast<Eigen::Index>(eq_.size()));
+  const VectorXd h = Eigen::Map<const VectorXd>(ineq_.rhs.data(), n_ineq);
+
+  auto multiplyP = [this, n](const VectorXd& x, VectorXd& out) {
+    out = VectorXd::Zero(n);
+    for (size_t k = 0; k < P_vals_.size(); ++k)
+    {
+      const Eigen::Index r = static_cast<Eigen::Index>(P_rows_[k]);
+      const Eigen::Index c = static_cast<Eigen::Index>(P_cols_[k]);
+      out[r] += P_vals_[k] * x[c];
+      if (r != c)
+        out[c] += P_vals_[k] * x[r];
+    }
+  };
+
+  const double tol_p = settings_.eps_feas * (1. + std::max(maxAbs(b), maxAbs(h)));
+  const double tol_d = settings_.eps_feas * (1. + maxAbs(q_));
+
+  // Start from the minimizer of 1/2 x'Px + q'x + 1/2 |Gx - h|^2 subject to Ax == b, with s shifted to be positive
+  VectorXd x, y, s, z;
+  VectorXd rhs_x = -q_;
+  addMultiplyRowsTransposed(ineq_.ptr, ineq_.idx, ineq_.val, h, rhs_x);
+  factor(VectorXd::Ones(n_ineq));
+  solve(rhs_x, b, x, y);
+  multiplyRows(ineq_.ptr, ineq_.idx, ineq_.val, x, s);
+  s = h - s;
+  if (n_ineq > 0 && s.minCoeff() < 1.)
+    s.array() += 1. - s.minCoeff();
+  z = VectorXd::Ones(n_ineq);
+
+  VectorXd r_d, r_p, r_g, Px, Gx, Gdx, t, rhs_y;
+  VectorXd dx, dy, ds, dz, dx_aff, dy_aff, ds_aff, dz_aff;
+  double pres = BANDED_INFINITY;
+  double dres = BANDED_INFINITY;
+  double gap = BANDED_INFINITY;
+  double pobj = 0.;
+  for (int iter = 0; iter < settings_.max_iter; ++iter)
+  {
+    multiplyP(x, Px);
+    r_d = Px + q_;
+    addMultiplyRowsTransposed(eq_.ptr, eq_.idx, eq_.val, y, r_d);
+    addMultiplyRowsTransposed(ineq_.ptr, ineq_.idx, ineq_.val, z, r_d);
+    multiplyRows(eq_.ptr, eq_.idx, eq_.val, x, r_p);
+    r_p -= b;
+    multiplyRows(ineq_.ptr, ineq_.idx, ineq_.val, x, Gx);
+    r_g = Gx + s - h;
+
+    pres = std::max(maxAbs(r_p), maxAbs(r_g));
+    dres = maxAbs(r_d);
+    gap = s.dot(z);
+    pobj = 0.5 * x.dot(Px) + q_.dot(x);
+    LOG_DEBUG("banded QP iter %i: pobj %g, pres %g, dres %g, gap %g", iter, pobj, pres, dres, gap);
+    if (!std::isfinite(pres + dres + gap))
+      break;
+    if (pres <= tol_p && dres <= tol_d && gap <= settings_.eps_gap * (1. + std::fabs(pobj)))
+    {
+      solution_.assign(x.data(), x.data() + n);
+      return CVX_SOLVED;
+    }
+
+    const double mu = (n_ineq > 0) ? gap / static_cast<double>(n_ineq) : 0.;
+    const VectorXd w = z.cwiseQuotient(s);
+    factor(w);
+
+    // Newton step for the complementarity residual r_sz, with ds and dz eliminated
+    auto newtonStep = [&](const VectorXd& r_sz, VectorXd& dx_, VectorXd& dy_, VectorXd& ds_, VectorXd& dz_) {
+      t = (z.cwiseProduct(r_g) - r_sz).cwiseQuotient(s);
+      rhs_x = -r_d;
+      addMultiplyRowsTransposed(ineq_.ptr, ineq_.idx, ineq_.val, -t, rhs_x);
+      rhs_y = -r_p;
+      solve(rhs_x, rhs_y, dx_, dy_);
+      multiplyRows(ineq_.ptr, ineq_.idx, ineq_.val, dx_, Gdx);
+      dz_ = w.cwiseProduct(Gdx) + t;
+      ds_ = -r_g - Gdx;
+    };
+
+    // Predictor
+    const VectorXd sz = s.cwiseProduct(z);
+    newtonStep(sz, dx_aff, dy_aff, ds_aff, dz_aff);
+    const double step_aff = std::min(maxStep(s, ds_aff), maxStep(z, dz_aff));
+    const double mu_aff =
+        (n_ineq > 0) ? (s + step_aff * ds_aff).dot(z + step_aff * dz_aff) / static_cast<double>(n_ineq) : 0.;
+    const double sigma = (mu > 0.) ? std::pow(mu_aff / mu, 3) : 0.;
+
+    // Corrector
+    VectorXd r_sz = sz + ds_aff.cwiseProduct(dz_aff);
+    r_sz.array() -= sigma * mu;
+    newtonStep(r_sz, dx, dy, ds, dz);
+    const double step = std::min(1., 0.99 * std::min(maxStep(s, ds), maxStep(z, dz)));
+
+    x += step * dx;
+    y += step * dy;
+    s += step * ds;
+    z += step * dz;
+  }
+
+  solution_.assign(x.data(), x.data() + n);
+  if (std::isfinite(pres + dres + gap) && pres <= 1e3 * tol_p && dres <= 1e3 * tol_d &&
+      gap <= 1e3 * settings_.eps_gap * (1. + std::fabs(pobj)))
+  {
+    LOG_WARN("banded QP solver stopped at a solution of reduced accuracy");
+    return CVX_SOLVED;
+  }
+  if (std::isfinite(pres) && pres > 1e3 * tol_p)
+    return CVX_INFEASIBLE;
+  return CVX_FAILED;
+}
+
+CvxOptStatus BandedQPModel::optimize()
+{
+  update();
+  buildProblem();
+  orderSystem();
+  return solveQP();
+}
+
+void BandedQPModel::setObjective(const AffExpr& expr) { assignAffExpr(objective_.affexpr, expr); }
+void BandedQPModel::setObjective(const QuadExpr& expr) { objective_ = expr; }
+void BandedQPModel::writeToFile(const std::string& /*fname*/)
+{
+  return;  // NOT IMPLEMENTED
+}
+VarVector BandedQPModel::getVars() const { return vars_; }
+}  // namespace sco
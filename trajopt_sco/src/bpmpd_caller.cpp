@@ -3,6 +3,7 @@ TRAJOPT_IGNORE_WARNINGS_PUSH
 #include <errno.h>
 #include <iostream>
 #include <string.h>
+#include <sys/mman.h>
 #include <unistd.h>
 #include <trajopt_sco/bpmpd_io.hpp>
 TRAJOPT_IGNORE_WARNINGS_POP
@@ -34,7 +35,69 @@ extern void bpmpd(int*,
                   int*);
 }
 
-int main(int /*argc*/, char** /*argv*/)
+/**
+ * @brief Solve problems passed in the shared memory region fd until the exit character is received
+ *
+ * The region is remapped whenever the caller grew it for a larger problem.
+ */
+static void solveShm(int fd)
+{
+  void* base = nullptr;
+  size_t mapped_size = 0;
+  while (true)
+  {
+    char s = 0;
+    bpmpd_io::ser(STDIN_FILENO, s, bpmpd_io::DESER);
+    if (s != bpmpd_io::SHM_SOLVE_CHAR)
+      exit(0);
+
+    uint64_t size = 0;
+    bpmpd_io::ser(STDIN_FILENO, size, bpmpd_io::DESER);
+    if (size != mapped_size)
+    {
+      if (base != nullptr)
+        munmap(base, mapped_size);
+      mapped_size = static_cast<size_t>(size);
+      base = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      if (base == MAP_FAILED)
+      {
+        std::cerr << "bpmpd_caller: failed to map shared memory: " << strerror(errno) << std::endl;
+        abort();
+      }
+    }
+
+    bpmpd_io::bpmpd_shm v = bpmpd_io::shm_view(base);
+    int memsiz = 0;
+    double BIG = 1e30;
+    bpmpd(&v.header->m,
+          &v.header->n,
+          &v.header->nz,
+          &v.header->qn,
+          &v.header->qnz,
+          v.acolcnt,
+          v.acolidx,
+          v.acolnzs,
+          v.qcolcnt,
+          v.qcolidx,
+          v.qcolnzs,
+          v.rhs,
+          v.obj,
+          v.lbound,
+          v.ubound,
+          v.primal,
+          v.dual,
+          v.status,
+          &BIG,
+          &v.header->code,
+          &v.header->opt,
+          &memsiz);
+
+    char reply = bpmpd_io::CHECK_CHAR;
+    bpmpd_io::ser(STDOUT_FILENO, reply, bpmpd_io::SER);
+  }
+}
+
+int main(int argc, char** argv)
 {
   std::string working_dir = BPMPD_WORKING_DIR;
   int err = chdir(working_dir.c_str());
@@ -44,6 +107,11 @@ int main(int /*argc*/, char** /*argv*/)
     std::cerr << strerror(err) << std::endl;
     abort();
   }
+
+  // Started with the file descriptor of a shared memory region
+  if (argc > 1)
+    solveShm(atoi(argv[1]));
+
   // int counter=0;
   while (true)
   {
@@ -1,8 +1,21 @@
 #include <trajopt_utils/macros.h>
 TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <algorithm>
 #include <cmath>
+#include <condition_variable>
+#include <errno.h>
+#include <fcntl.h>
 #include <fstream>
+#include <memory>
+#include <mutex>
+#include <pthread.h>
 #include <signal.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
 #include <trajopt_sco/bpmpd_io.hpp>
 TRAJOPT_IGNORE_WARNINGS_POP
 
@@ -161,33 +174,51 @@ Model::Ptr createBPMPDModel()
 #define READ 0
 #define WRITE 1
 
-pid_t popen2(const char* command, int* infp, int* outfp)
+/**
+ * @brief Start command through /bin/sh with pipes connected to its stdin and stdout
+ *
+ * The returned pipe ends are close-on-exec, so they are not inherited by other children. inherit_fd (if >= 0) is made
+ * inheritable in the child only.
+ */
+pid_t popen2(const char* command, int* infp, int* outfp, int inherit_fd = -1)
 {
   int p_stdin[2], p_stdout[2];
   pid_t pid;
 
-  if (pipe(p_stdin) != 0 || pipe(p_stdout) != 0)
+  if (pipe2(p_stdin, O_CLOEXEC) != 0)
+    return -1;
+  if (pipe2(p_stdout, O_CLOEXEC) != 0)
+  {
+    close(p_stdin[READ]);
+    close(p_stdin[WRITE]);
     return -1;
+  }
 
   pid = fork();
 
   if (pid < 0)
   {
-    assert(0);
+    close(p_stdin[READ]);
+    close(p_stdin[WRITE]);
+    close(p_stdout[READ]);
+    close(p_stdout[WRITE]);
     return pid;
   }
   else if (pid == 0)
   {
-    close(p_stdin[WRITE]);
     dup2(p_stdin[READ], READ);
-    close(p_stdout[READ]);
     dup2(p_stdout[WRITE], WRITE);
+    if (inherit_fd >= 0)
+      fcntl(inherit_fd, F_SETFD, 0);
 
     execl("/bin/sh", "sh", "-c", command, nullptr);
     perror("execl");
-    exit(1);
+    _exit(1);
   }
 
+  close(p_stdin[READ]);
+  close(p_stdout[WRITE]);
+
   if (infp == nullptr)
     close(p_stdin[WRITE]);
   else
@@ -201,37 +232,394 @@ pid_t popen2(const char* command, int* infp, int* outfp)
   return pid;
 }
 
-static pid_t gPID = 0;
-static int gPipeIn = 0;
-static int gPipeOut = 0;
-
-void fexit()
+namespace
+{
+/** @brief Write all of data. Returns false instead of raising SIGPIPE if the reader is gone. */
+bool writeAll(int fd, const void* data, size_t size)
 {
-  char text[1] = { bpmpd_io::EXIT_CHAR };
-  long n = write(gPipeIn, text, 1);
-  ALWAYS_ASSERT(n == 1);
+  sigset_t pipe_set, old_set;
+  sigemptyset(&pipe_set);
+  sigaddset(&pipe_set, SIGPIPE);
+  pthread_sigmask(SIG_BLOCK, &pipe_set, &old_set);
+
+  const char* p = static_cast<const char*>(data);
+  bool ok = true;
+  while (size > 0)
+  {
+    ssize_t n = write(fd, p, size);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+    {
+      if (errno == EPIPE)
+      {
+        struct timespec zero = { 0, 0 };
+        sigtimedwait(&pipe_set, nullptr, &zero);
+      }
+      ok = false;
+      break;
+    }
+    p += n;
+    size -= static_cast<size_t>(n);
+  }
+
+  pthread_sigmask(SIG_SETMASK, &old_set, nullptr);
+  return ok;
 }
 
-BPMPDModel::BPMPDModel() : m_pipeIn(0), m_pipeOut(0)
+/** @brief Read exactly size bytes. Returns false if the writer is gone. */
+bool readAll(int fd, void* data, size_t size)
 {
-  if (gPID == 0)
+  char* p = static_cast<char*>(data);
+  while (size > 0)
   {
-    atexit(fexit);
-    gPID = popen2(BPMPD_CALLER, &gPipeIn, &gPipeOut);
+    ssize_t n = read(fd, p, size);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    p += n;
+    size -= static_cast<size_t>(n);
   }
+  return true;
+}
+
+template <typename T>
+bool writeValue(int fd, const T& x)
+{
+  return writeAll(fd, &x, sizeof(T));
+}
+
+template <typename T>
+bool readValue(int fd, T& x)
+{
+  return readAll(fd, &x, sizeof(T));
+}
+
+/** @brief Write the size of x followed by its elements, in the layout bpmpd_io::ser reads */
+template <typename T>
+bool writeVector(int fd, const std::vector<T>& x)
+{
+  unsigned long size = x.size();
+  return writeValue(fd, size) && writeAll(fd, x.data(), sizeof(T) * size);
 }
 
-BPMPDModel::~BPMPDModel()
+template <typename T>
+bool readVector(int fd, std::vector<T>& x)
 {
-  // char text[1] = {123};
-  // write(gPipeIn, text, 1);
-  // // kill(m_pid, SIGKILL); // TODO: WHY DOES THIS KILL THE PARENT PROCESS?!
-  // close(m_pipeIn);
-  // close(m_pipeOut);
-  // m_pipeIn=0;
-  // m_pipeOut=0;
+  unsigned long size = 0;
+  if (!readValue(fd, size))
+    return false;
+  x.resize(size);
+  return readAll(fd, x.data(), sizeof(T) * size);
 }
 
+/** @brief Send a problem to a bpmpd_caller started without shared memory, see bpmpd_io::ser(bpmpd_input) */
+bool writeInput(int fd, const bpmpd_io::bpmpd_input& bi)
+{
+  char start = 'z';
+  return writeValue(fd, start) && writeValue(fd, bi.m) && writeValue(fd, bi.n) && writeValue(fd, bi.nz) &&
+         writeValue(fd, bi.qn) && writeValue(fd, bi.qnz) && writeVector(fd, bi.acolcnt) &&
+         writeVector(fd, bi.acolidx) && writeVector(fd, bi.acolnzs) && writeVector(fd, bi.qcolcnt) &&
+         writeVector(fd, bi.qcolidx) && writeVector(fd, bi.qcolnzs) && writeVector(fd, bi.rhs) &&
+         writeVector(fd, bi.obj) && writeVector(fd, bi.lbound) && writeVector(fd, bi.ubound);
+}
+
+/** @brief Receive the solution written by bpmpd_io::ser(bpmpd_output) */
+bool readOutput(int fd, bpmpd_io::bpmpd_output& bo)
+{
+  char check = 0;
+  return readValue(fd, check) && check == bpmpd_io::CHECK_CHAR && readVector(fd, bo.primal) &&
+         readVector(fd, bo.dual) && readVector(fd, bo.status) && readValue(fd, bo.code) && readValue(fd, bo.opt);
+}
+
+/**
+ * @brief A bpmpd_caller process solving one problem at a time
+ *
+ * Problems are written into a shared memory region (memfd) inherited by the process instead of being serialized
+ * through the pipe, which then only carries a few bytes per solve. If the region can not be created or grown the
+ * process is (re)started without it and problems are serialized through the pipe. The two protocols are never mixed
+ * on one process.
+ */
+class BPMPDWorker
+{
+public:
+  BPMPDWorker() : pid_(0), pipe_in_(-1), pipe_out_(-1), shm_fd_(-1), shm_base_(nullptr), shm_size_(0) {}
+  ~BPMPDWorker() { stop(); }
+  BPMPDWorker(const BPMPDWorker&) = delete;
+  BPMPDWorker& operator=(const BPMPDWorker&) = delete;
+
+  /** @brief Start the process, passing problems through shared memory if use_shm and the region can be created */
+  bool start(bool use_shm = true)
+  {
+    std::string command = std::string("exec ") + BPMPD_CALLER;
+#ifdef __linux__
+    if (use_shm)
+    {
+      shm_fd_ = static_cast<int>(syscall(SYS_memfd_create, "bpmpd", MFD_CLOEXEC));
+      if (shm_fd_ >= 0)
+        command += " " + std::to_string(shm_fd_);
+      else
+        LOG_WARN("failed to create shared memory for BPMPD, problems are sent through a pipe");
+    }
+#endif
+    pid_ = popen2(command.c_str(), &pipe_in_, &pipe_out_, shm_fd_);
+    if (pid_ <= 0)
+    {
+      pid_ = 0;
+      stop();
+      return false;
+    }
+    return true;
+  }
+
+  /** @brief Ask the process to exit and wait for it. A process that is stuck or was not asked nicely is killed. */
+  void stop(bool graceful = true)
+  {
+    if (pid_ > 0)
+    {
+      char exit_char = bpmpd_io::EXIT_CHAR;
+      if (!graceful || !writeAll(pipe_in_, &exit_char, 1))
+        kill(pid_, SIGKILL);
+      waitpid(pid_, nullptr, 0);
+      pid_ = 0;
+    }
+    if (pipe_in_ >= 0)
+      close(pipe_in_);
+    if (pipe_out_ >= 0)
+      close(pipe_out_);
+    if (shm_base_ != nullptr)
+      munmap(shm_base_, shm_size_);
+    if (shm_fd_ >= 0)
+      close(shm_fd_);
+    pipe_in_ = pipe_out_ = shm_fd_ = -1;
+    shm_base_ = nullptr;
+    shm_size_ = 0;
+  }
+
+  /** @brief Health check. Reaps the process if it exited. */
+  bool alive()
+  {
+    if (pid_ <= 0)
+      return false;
+    if (waitpid(pid_, nullptr, WNOHANG) == 0)
+      return true;
+    pid_ = 0;
+    return false;
+  }
+
+  /** @brief Solve the problem. Returns false if the process died or could not be restarted, it is stopped then. */
+  bool solve(bpmpd_io::bpmpd_input& bi, size_t n, DblVec& soln, int& code)
+  {
+    bpmpd_io::bpmpd_shm_header header;
+    header.m = bi.m;
+    header.n = bi.n;
+    header.nz = bi.nz;
+    header.qn = bi.qn;
+    header.qnz = bi.qnz;
+    header.code = 0;
+    header.opt = 0;
+    if (shm_fd_ >= 0 && !reserveShm(bpmpd_io::shm_size(header)))
+    {
+      // The process reads shared memory requests only, so it has to be restarted to use the pipe
+      LOG_WARN("failed to grow the shared memory for BPMPD, restarting bpmpd_caller to send problems through a pipe");
+      stop();
+      if (!start(false))
+        return false;
+    }
+
+    if (shm_fd_ < 0)
+    {
+      bpmpd_io::bpmpd_output bo;
+      if (!writeInput(pipe_in_, bi) || !readOutput(pipe_out_, bo) || bo.primal.size() < n)
+      {
+        stop(false);
+        return false;
+      }
+      soln = DblVec(bo.primal.begin(), bo.primal.begin() + static_cast<long int>(n));
+      code = bo.code;
+      return true;
+    }
+
+    *static_cast<bpmpd_io::bpmpd_shm_header*>(shm_base_) = header;
+    bpmpd_io::bpmpd_shm v = bpmpd_io::shm_view(shm_base_);
+    std::copy(bi.acolcnt.begin(), bi.acolcnt.end(), v.acolcnt);
+    std::copy(bi.acolidx.begin(), bi.acolidx.end(), v.acolidx);
+    std::copy(bi.acolnzs.begin(), bi.acolnzs.end(), v.acolnzs);
+    std::copy(bi.qcolcnt.begin(), bi.qcolcnt.end(), v.qcolcnt);
+    std::copy(bi.qcolidx.begin(), bi.qcolidx.end(), v.qcolidx);
+    std::copy(bi.qcolnzs.begin(), bi.qcolnzs.end(), v.qcolnzs);
+    std::copy(bi.rhs.begin(), bi.rhs.end(), v.rhs);
+    std::copy(bi.obj.begin(), bi.obj.end(), v.obj);
+    std::copy(bi.lbound.begin(), bi.lbound.end(), v.lbound);
+    std::copy(bi.ubound.begin(), bi.ubound.end(), v.ubound);
+
+    char request = bpmpd_io::SHM_SOLVE_CHAR;
+    uint64_t size = shm_size_;
+    char reply = 0;
+    if (!writeAll(pipe_in_, &request, 1) || !writeAll(pipe_in_, &size, sizeof(size)) ||
+        !readAll(pipe_out_, &reply, 1) || reply != bpmpd_io::CHECK_CHAR)
+    {
+      stop(false);
+      return false;
+    }
+
+    soln = DblVec(v.primal, v.primal + n);
+    code = v.header->code;
+    return true;
+  }
+
+private:
+  /** @brief Grow the shared memory region to at least size bytes. Returns false if that fails. */
+  bool reserveShm(size_t size)
+  {
+    if (size <= shm_size_)
+      return true;
+
+    size = std::max(size, 2 * shm_size_);
+    if (ftruncate(shm_fd_, static_cast<off_t>(size)) != 0)
+      return false;
+    if (shm_base_ != nullptr)
+      munmap(shm_base_, shm_size_);
+    shm_base_ = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd_, 0);
+    if (shm_base_ == MAP_FAILED)
+    {
+      shm_base_ = nullptr;
+      shm_size_ = 0;
+      return false;
+    }
+    shm_size_ = size;
+    return true;
+  }
+
+  pid_t pid_;
+  int pipe_in_, pipe_out_;
+  int shm_fd_;
+  void* shm_base_;
+  size_t shm_size_;
+};
+
+/**
+ * @brief bpmpd_caller processes shared by all BPMPDModels
+ *
+ * Each optimize() leases a worker for the duration of the solve, so concurrent solves never share a pipe. Workers are
+ * started on demand up to the pool size and reused afterwards. Workers that died are restarted when leased. The
+ * pool is a function local static, so the idle workers are shut down when the program exits.
+ */
+class BPMPDWorkerPool
+{
+public:
+  static BPMPDWorkerPool& instance()
+  {
+    static BPMPDWorkerPool pool;
+    return pool;
+  }
+
+  /** @brief Blocks while all workers are leased */
+  std::unique_ptr<BPMPDWorker> lease()
+  {
+    std::unique_ptr<BPMPDWorker> worker;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      available_.wait(lock, [this] { return leased_ < size_; });
+      ++leased_;
+      if (!idle_.empty())
+      {
+        worker = std::move(idle_.back());
+        idle_.pop_back();
+      }
+    }
+
+    if (worker && !worker->alive())
+    {
+      LOG_WARN("bpmpd_caller exited unexpectedly, restarting it");
+      worker->stop();
+      worker.reset();
+    }
+    if (!worker)
+    {
+      worker.reset(new BPMPDWorker());
+      if (!worker->start())
+      {
+        release(nullptr);
+        PRINT_AND_THROW("failed to start " << BPMPD_CALLER);
+      }
+    }
+    return worker;
+  }
+
+  /** @brief Return a leased worker. Null if the worker was lost. */
+  void release(std::unique_ptr<BPMPDWorker> worker)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      --leased_;
+      if (worker && idle_.size() + leased_ < size_)
+        idle_.push_back(std::move(worker));
+    }
+    available_.notify_one();
+  }
+
+  void setSize(size_t size)
+  {
+    std::vector<std::unique_ptr<BPMPDWorker>> stopped;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      size_ = std::max<size_t>(size, 1);
+      while (idle_.size() + leased_ > size_ && !idle_.empty())
+      {
+        stopped.push_back(std::move(idle_.back()));
+        idle_.pop_back();
+      }
+    }
+    available_.notify_all();
+  }
+
+  size_t size()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return size_;
+  }
+
+private:
+  BPMPDWorkerPool() : size_(std::max<size_t>(std::thread::hardware_concurrency(), 1)), leased_(0)
+  {
+    const char* size_env = getenv("TRAJOPT_BPMPD_WORKERS");
+    if (size_env != nullptr)
+      size_ = static_cast<size_t>(std::max(atoi(size_env), 1));
+  }
+
+  std::mutex mutex_;
+  std::condition_variable available_;
+  std::vector<std::unique_ptr<BPMPDWorker>> idle_;
+  size_t size_;
+  size_t leased_;
+};
+
+/** @brief Returns the worker to the pool when destroyed, also when the solve throws */
+class BPMPDWorkerLease
+{
+public:
+  BPMPDWorkerLease() : worker_(BPMPDWorkerPool::instance().lease()) {}
+  ~BPMPDWorkerLease() { BPMPDWorkerPool::instance().release(std::move(worker_)); }
+  BPMPDWorkerLease(const BPMPDWorkerLease&) = delete;
+  BPMPDWorkerLease& operator=(const BPMPDWorkerLease&) = delete;
+
+  BPMPDWorker* operator->() { return worker_.get(); }
+
+private:
+  std::unique_ptr<BPMPDWorker> worker_;
+};
+}  // namespace
+
+void setBPMPDWorkerPoolSize(size_t size) { BPMPDWorkerPool::instance().setSize(size); }
+
+size_t getBPMPDWorkerPoolSize() { return BPMPDWorkerPool::instance().size(); }
+
+BPMPDModel::BPMPDModel() = default;
+
+BPMPDModel::~BPMPDModel() = default;
+
 Var BPMPDModel::addVar(const std::string& name)
 {
   m_vars.push_back(new VarRep(static_cast<int>(m_vars.size()), name, this));
@@ -490,15 +878,19 @@ CvxOptStatus BPMPDModel::optimize()
                            obj,
                            lbound,
                            ubound);
-  bpmpd_io::ser(gPipeIn, bi, bpmpd_io::SER);
-
-  // std::cout << "serialization time:" << end-start << std::endl;
 
-  bpmpd_io::bpmpd_output bo;
-  bpmpd_io::ser(gPipeOut, bo, bpmpd_io::DESER);
-
-  m_soln = DblVec(bo.primal.begin(), bo.primal.begin() + static_cast<long int>(n));
-  int retcode = bo.code;
+  int retcode = 0;
+  BPMPDWorkerLease worker;
+  if (!worker->solve(bi, n, m_soln, retcode))
+  {
+    // The process may have died while idle, before the lease could notice. Retry once on a new one.
+    LOG_WARN("bpmpd_caller exited while solving, restarting it");
+    if (!worker->start() || !worker->solve(bi, n, m_soln, retcode))
+    {
+      LOG_ERROR("bpmpd_caller exited while solving, it is restarted for the next solve");
+      return CVX_FAILED;
+    }
+  }
 
   if (retcode == 2)
     return CVX_SOLVED;
@@ -0,0 +1,141 @@
+#include <trajopt_utils/macros.h>
+TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <algorithm>
+#include <cassert>
+TRAJOPT_IGNORE_WARNINGS_POP
+
+#include <trajopt_sco/iteration_log.hpp>
+#include <trajopt_utils/logging.hpp>
+
+namespace sco
+{
+const char IterationLogWriter::MAGIC[8] = { 'S', 'C', 'O', 'I', 'T', 'L', 'O', 'G' };
+const uint32_t IterationLogWriter::VERSION;
+const size_t IterationLogWriter::RECORD_HEADER_SIZE;
+
+/** @brief Size of the stdio buffer of the log file. Records are only flushed to disk when it is full */
+static const size_t STREAM_BUFFER_SIZE = 1 << 20;
+
+static void writeUInt32(std::FILE* stream, size_t value)
+{
+  uint32_t v = static_cast<uint32_t>(value);
+  std::fwrite(&v, sizeof(v), 1, stream);
+}
+
+static void writeNames(std::FILE* stream, const std::vector<std::string>& names)
+{
+  for (const std::string& name : names)
+  {
+    writeUInt32(stream, name.size());
+    std::fwrite(name.data(), 1, name.size(), stream);
+  }
+}
+
+static std::vector<double>::iterator append(std::vector<double>::iterator it, const DblVec& values)
+{
+  return std::copy(values.begin(), values.end(), it);
+}
+
+IterationLogWriter::IterationLogWriter(const std::string& path,
+                                       const std::vector<std::string>& var_names,
+                                       const std::vector<std::string>& cost_names,
+                                       const std::vector<std::string>& cnt_names,
+                                       size_t max_queued_records)
+  : stream_(std::fopen(path.c_str(), "wb"))
+  , record_size_(RECORD_HEADER_SIZE + var_names.size() + 3 * cost_names.size() + 4 * cnt_names.size())
+  , max_queued_records_(std::max<size_t>(max_queued_records, 1))
+  , done_(false)
+{
+  if (stream_ == nullptr)
+  {
+    LOG_ERROR("failed to open iteration log %s", path.c_str());
+    return;
+  }
+
+  std::setvbuf(stream_, nullptr, _IOFBF, STREAM_BUFFER_SIZE);
+  std::fwrite(MAGIC, 1, sizeof(MAGIC), stream_);
+  writeUInt32(stream_, VERSION);
+  writeUInt32(stream_, var_names.size());
+  writeUInt32(stream_, cost_names.size());
+  writeUInt32(stream_, cnt_names.size());
+  writeNames(stream_, var_names);
+  writeNames(stream_, cost_names);
+  writeNames(stream_, cnt_names);
+
+  thread_ = std::thread(&IterationLogWriter::run, this);
+}
+
+IterationLogWriter::~IterationLogWriter()
+{
+  if (stream_ == nullptr)
+    return;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    done_ = true;
+  }
+  not_empty_.notify_one();
+  thread_.join();
+  std::fclose(stream_);
+}
+
+void IterationLogWriter::write(const BasicTrustRegionSQPResults& results)
+{
+  if (stream_ == nullptr)
+    return;
+
+  std::vector<double> record;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_full_.wait(lock, [this] { return queue_.size() < max_queued_records_; });
+    if (!free_.empty())
+    {
+      record.swap(free_.back());
+      free_.pop_back();
+    }
+  }
+
+  record.resize(record_size_);
+  auto it = record.begin();
+  *it++ = results.old_merit;
+  *it++ = results.model_merit;
+  *it++ = results.new_merit;
+  *it++ = results.merit_improve_ratio;
+  *it++ = results.merit_error_coeff;
+  it = append(it, results.new_x);
+  it = append(it, results.old_cost_vals);
+  it = append(it, results.model_cost_vals);
+  it = append(it, results.new_cost_vals);
+  it = append(it, results.old_cnt_viols);
+  it = append(it, results.model_cnt_viols);
+  it = append(it, results.new_cnt_viols);
+  it = append(it, results.merit_error_coeffs);
+  assert(it == record.end());
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    queue_.push_back(std::move(record));
+  }
+  not_empty_.notify_one();
+}
+
+void IterationLogWriter::run()
+{
+  std::vector<double> record;
+  for (;;)
+  {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (!record.empty())
+        free_.push_back(std::move(record));
+      not_empty_.wait(lock, [this] { return done_ || !queue_.empty(); });
+      if (queue_.empty())
+        return;
+      record = std::move(queue_.front());
+      queue_.pop_front();
+    }
+    not_full_.notify_one();
+    std::fwrite(record.data(), sizeof(double), record.size(), stream_);
+  }
+}
+}  // namespace sco
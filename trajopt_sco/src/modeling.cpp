@@ -26,6 +26,26 @@ void ConvexObjective::addHinge(const AffExpr& affexpr, double coeff)
   exprInc(quad_, hinge_cost);
 }
 
+void ConvexObjective::addSoftBound(const AffExpr& affexpr, double lower, double upper, double coeff)
+{
+  if (lower > upper)
+  {
+    addHinge(exprSub(affexpr, upper), coeff);
+    addHinge(exprSub(AffExpr(lower), affexpr), coeff);
+    return;
+  }
+
+  Var slack = model_->addVar("soft_bound", 0, INFINITY);
+  vars_.push_back(slack);
+  // expr - upper <= slack
+  ineqs_.push_back(exprSub(affexpr, upper));
+  exprDec(ineqs_.back(), slack);
+  // lower - expr <= slack
+  ineqs_.push_back(exprSub(AffExpr(lower), affexpr));
+  exprDec(ineqs_.back(), slack);
+  exprInc(quad_, exprMult(AffExpr(slack), coeff));
+}
+
 void ConvexObjective::addAbs(const AffExpr& affexpr, double coeff)
 {
   Var neg = model_->addVar("neg", 0, INFINITY);
@@ -178,6 +198,7 @@ VarVector OptProb::createVariables(const std::vector<std::string>& var_names, co
     upper_bounds_.push_back(ub[i]);
   }
   model_->update();
+  closest_feasible_x_.clear();
   return VarVector(vars_.end() - static_cast<long int>(n_add), vars_.end());
 }
 
@@ -185,16 +206,28 @@ void OptProb::setLowerBounds(const DblVec& lb)
 {
   assert(lb.size() == vars_.size());
   lower_bounds_ = lb;
+  closest_feasible_x_.clear();
 }
 
 void OptProb::setUpperBounds(const DblVec& ub)
 {
   assert(ub.size() == vars_.size());
   upper_bounds_ = ub;
+  closest_feasible_x_.clear();
+}
+
+void OptProb::setLowerBounds(const DblVec& lb, const VarVector& vars)
+{
+  setVec(lower_bounds_, vars, lb);
+  closest_feasible_x_.clear();
+}
+
+void OptProb::setUpperBounds(const DblVec& ub, const VarVector& vars)
+{
+  setVec(upper_bounds_, vars, ub);
+  closest_feasible_x_.clear();
 }
 
-void OptProb::setLowerBounds(const DblVec& lb, const VarVector& vars) { setVec(lower_bounds_, vars, lb); }
-void OptProb::setUpperBounds(const DblVec& ub, const VarVector& vars) { setVec(upper_bounds_, vars, ub); }
 void OptProb::addCost(Cost::Ptr cost) { costs_.push_back(cost); }
 void OptProb::addConstraint(Constraint::Ptr cnt)
 {
@@ -225,12 +258,34 @@ std::vector<Constraint::Ptr> OptProb::getConstraints() const
   return out;
 }
 
-void OptProb::addLinearConstraint(const AffExpr& expr, ConstraintType type)
+Cnt OptProb::addLinearConstraint(const AffExpr& expr, ConstraintType type)
 {
-  if (type == EQ)
-    model_->addEqCnt(expr, "");
-  else
-    model_->addIneqCnt(expr, "");
+  Cnt cnt = (type == EQ) ? model_->addEqCnt(expr, "") : model_->addIneqCnt(expr, "");
+  linear_cnts_.push_back(cnt);
+  linear_cnt_exprs_.push_back(expr);
+  linear_cnt_types_.push_back(type);
+  closest_feasible_x_.clear();
+  return cnt;
+}
+
+void OptProb::removeLinearConstraints(const CntVector& cnts)
+{
+  for (const Cnt& cnt : cnts)
+  {
+    for (size_t i = 0; i < linear_cnts_.size(); ++i)
+    {
+      if (linear_cnts_[i].cnt_rep == cnt.cnt_rep)
+      {
+        linear_cnts_.erase(linear_cnts_.begin() + static_cast<long int>(i));
+        linear_cnt_exprs_.erase(linear_cnt_exprs_.begin() + static_cast<long int>(i));
+        linear_cnt_types_.erase(linear_cnt_types_.begin() + static_cast<long int>(i));
+        break;
+      }
+    }
+  }
+  closest_feasible_x_.clear();
+  model_->removeCnts(cnts);
+  model_->update();
 }
 
 DblVec OptProb::getCentralFeasiblePoint(const DblVec& x)
@@ -246,6 +301,27 @@ DblVec OptProb::getClosestFeasiblePoint(const DblVec& x)
 {
   LOG_DEBUG("getClosestFeasiblePoint");
   assert(vars_.size() == x.size());
+
+  // The projection onto the bounds alone is the clamped point, which is also the projection onto the bounds and the
+  // linear constraints if it satisfies them
+  DblVec clamped(x.size());
+  for (size_t i = 0; i < x.size(); ++i)
+    clamped[i] = fmin(fmax(x[i], lower_bounds_[i]), upper_bounds_[i]);
+
+  const double tol = 1e-9;
+  bool feasible = true;
+  for (size_t i = 0; i < linear_cnt_exprs_.size() && feasible; ++i)
+  {
+    double val = linear_cnt_exprs_[i].value(clamped);
+    double viol = (linear_cnt_types_[i] == EQ) ? fabs(val) : pospart(val);
+    feasible = viol <= tol;
+  }
+  if (feasible)
+    return clamped;
+
+  if (!closest_feasible_x_.empty() && closest_feasible_x_ == x)
+    return closest_feasible_point_;
+
   QuadExpr obj;
   for (unsigned i = 0; i < x.size(); ++i)
   {
@@ -261,6 +337,8 @@ DblVec OptProb::getClosestFeasiblePoint(const DblVec& x)
                     "problem with variable bounds (e.g. joint limits). wrote "
                     "to /tmp/fail.lp");
   }
-  return model_->getVarValues(vars_);
+  closest_feasible_x_ = x;
+  closest_feasible_point_ = model_->getVarValues(vars_);
+  return closest_feasible_point_;
 }
 }  // namespace sco
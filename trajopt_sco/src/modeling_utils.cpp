@@ -1,6 +1,8 @@
 #include <trajopt_utils/macros.h>
 TRAJOPT_IGNORE_WARNINGS_PUSH
 #include <Eigen/Eigenvalues>
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 TRAJOPT_IGNORE_WARNINGS_POP
 
@@ -13,6 +15,111 @@ namespace sco
 {
 const double DEFAULT_EPSILON = 1e-5;
 
+namespace
+{
+/** @brief The positive semidefinite part of a symmetric matrix, without its negative eigenvalues */
+Eigen::MatrixXd positivePart(const Eigen::MatrixXd& hess)
+{
+  Eigen::MatrixXd pos_hess = Eigen::MatrixXd::Zero(hess.rows(), hess.cols());
+  Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> es(hess);
+  Eigen::VectorXd eigvals = es.eigenvalues();
+  Eigen::MatrixXd eigvecs = es.eigenvectors();
+  for (long int i = 0, end = hess.rows(); i != end; ++i)
+  {  // tricky --- eigen size() is signed
+    if (eigvals(i) > 0)
+      pos_hess += eigvals(i) * eigvecs.col(i) * eigvecs.col(i).transpose();
+  }
+  return pos_hess;
+}
+
+/** @brief The quadratic val + grad'(z - x) + 1/2 (z - x)'hess(z - x) of the variables z */
+QuadExpr quadFromValGradHess(double val,
+                             const Eigen::VectorXd& x,
+                             const Eigen::VectorXd& grad,
+                             const Eigen::MatrixXd& hess,
+                             const VarVector& vars)
+{
+  QuadExpr quad;
+  quad.affexpr.constant = val - grad.dot(x) + .5 * x.dot(hess * x);
+  quad.affexpr.vars = vars;
+  quad.affexpr.coeffs = util::toDblVec(grad - hess * x);
+
+  size_t nquadterms = static_cast<size_t>((x.size() * (x.size() + 1)) / 2);
+  quad.coeffs.reserve(nquadterms);
+  quad.vars1.reserve(nquadterms);
+  quad.vars2.reserve(nquadterms);
+  for (long int i = 0, end = x.size(); i != end; ++i)
+  {  // tricky --- eigen size() is signed
+    quad.vars1.push_back(vars[static_cast<size_t>(i)]);
+    quad.vars2.push_back(vars[static_cast<size_t>(i)]);
+    quad.coeffs.push_back(hess(i, i) / 2);
+    for (long int j = i + 1; j != end; ++j)
+    {  // tricky --- eigen size() is signed
+      quad.vars1.push_back(vars[static_cast<size_t>(i)]);
+      quad.vars2.push_back(vars[static_cast<size_t>(j)]);
+      quad.coeffs.push_back(hess(i, j));
+    }
+  }
+  return quad;
+}
+}  // namespace
+
+void QuasiNewtonHessian::update(const Eigen::VectorXd& x, const Eigen::VectorXd& grad)
+{
+  if (type_ == QN_NONE)
+    return;
+
+  if (x_.size() != x.size())
+  {
+    x_ = x;
+    grad_ = grad;
+    hess_.resize(0, 0);
+    return;
+  }
+
+  Eigen::VectorXd s = x - x_;
+  if (s.norm() < 1e-10)
+    return;
+  Eigen::VectorXd y = grad - grad_;
+  x_ = x;
+  grad_ = grad;
+
+  double sy = s.dot(y);
+  if (!valid())
+  {
+    double scale = (sy > 0) ? y.squaredNorm() / sy : y.norm() / s.norm();
+    if (!(scale > 0) || !std::isfinite(scale))
+      return;
+    hess_ = scale * Eigen::MatrixXd::Identity(x.size(), x.size());
+  }
+
+  Eigen::VectorXd hs = hess_ * s;
+  double shs = s.dot(hs);
+  if (type_ == QN_BFGS)
+  {
+    // Powell's damping: r replaces y so that s'r >= 0.2 s'Bs
+    double theta = (sy >= 0.2 * shs) ? 1 : 0.8 * shs / (shs - sy);
+    Eigen::VectorXd r = theta * y + (1 - theta) * hs;
+    hess_ += r * r.transpose() / s.dot(r) - hs * hs.transpose() / shs;
+  }
+  else
+  {
+    Eigen::VectorXd r = y - hs;
+    double rs = r.dot(s);
+    if (std::abs(rs) > 1e-8 * s.norm() * r.norm())
+      hess_ += r * r.transpose() / rs;
+  }
+}
+
+void QuasiNewtonHessian::reset()
+{
+  x_.resize(0);
+  grad_.resize(0);
+  hess_.resize(0, 0);
+}
+
+Eigen::MatrixXd QuasiNewtonHessian::hessian() const { return positivePart(hess_); }
+
 Eigen::VectorXd getVec(const DblVec& x, const VarVector& vars)
 {
   Eigen::VectorXd out(vars.size());
@@ -39,6 +146,45 @@ AffExpr affFromValGrad(double y, const Eigen::VectorXd& x, const Eigen::VectorXd
   return aff;
 }
 
+std::vector<AffExpr> linearizeErrFunc(const VectorOfVector& f,
+                                      const MatrixOfVector::Ptr& dfdx,
+                                      const SparseMatrixOfVector::Ptr& sparse_dfdx,
+                                      const Eigen::VectorXd& x,
+                                      const VarVector& vars,
+                                      double epsilon)
+{
+  Eigen::VectorXd y = f(x);
+  std::vector<AffExpr> out;
+  out.reserve(static_cast<size_t>(y.size()));
+  if (sparse_dfdx)
+  {
+    SparseMatrixOfVector::SparseMatrix jac = sparse_dfdx->call(x);
+    assert(jac.rows() == y.size() && jac.cols() == x.size());
+    for (int i = 0; i < jac.outerSize(); ++i)
+    {
+      out.emplace_back();
+      AffExpr& aff = out.back();
+      aff.constant = y[i];
+      aff.coeffs.reserve(static_cast<size_t>(jac.row(i).nonZeros()));
+      aff.vars.reserve(static_cast<size_t>(jac.row(i).nonZeros()));
+      for (SparseMatrixOfVector::SparseMatrix::InnerIterator it(jac, i); it; ++it)
+      {
+        if (fabs(it.value()) <= 1e-7)
+          continue;
+        aff.constant -= it.value() * x[it.col()];
+        aff.coeffs.push_back(it.value());
+        aff.vars.push_back(vars[static_cast<size_t>(it.col())]);
+      }
+    }
+    return out;
+  }
+
+  Eigen::MatrixXd jac = (dfdx) ? dfdx->call(x) : calcForwardNumJac(f, x, epsilon);
+  for (int i = 0; i < jac.rows(); ++i)
+    out.push_back(affFromValGrad(y[i], x, jac.row(i), vars));
+  return out;
+}
+
 CostFromFunc::CostFromFunc(ScalarOfVector::Ptr f, const VarVector& vars, const std::string& name, bool full_hessian)
   : Cost(name), f_(f), vars_(vars), full_hessian_(full_hessian), epsilon_(DEFAULT_EPSILON)
 {
@@ -60,6 +206,13 @@ ConvexObjective::Ptr CostFromFunc::convex(const DblVec& xin, Model* model)
     double val;
     Eigen::VectorXd grad, hess;
     calcGradAndDiagHess(*f_, x, epsilon_, val, grad, hess);
+    qn_hessian_.update(x, grad);
+    if (qn_hessian_.valid())
+    {
+      out->addQuadExpr(quadFromValGradHess(val, x, grad, qn_hessian_.hessian(), vars_));
+      return out;
+    }
+
     hess = hess.cwiseMax(Eigen::VectorXd::Zero(hess.size()));
     QuadExpr& quad = out->quad_;
     quad.affexpr.constant = val - grad.dot(x) + .5 * x.dot(hess.cwiseProduct(x));
@@ -75,38 +228,7 @@ ConvexObjective::Ptr CostFromFunc::convex(const DblVec& xin, Model* model)
     Eigen::VectorXd grad;
     Eigen::MatrixXd hess;
     calcGradHess(f_, x, epsilon_, val, grad, hess);
-
-    Eigen::MatrixXd pos_hess = Eigen::MatrixXd::Zero(x.size(), x.size());
-    Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> es(hess);
-    Eigen::VectorXd eigvals = es.eigenvalues();
-    Eigen::MatrixXd eigvecs = es.eigenvectors();
-    for (long int i = 0, end = x.size(); i != end; ++i)
-    {  // tricky --- eigen size() is signed
-      if (eigvals(i) > 0)
-        pos_hess += eigvals(i) * eigvecs.col(i) * eigvecs.col(i).transpose();
-    }
-
-    QuadExpr& quad = out->quad_;
-    quad.affexpr.constant = val - grad.dot(x) + .5 * x.dot(pos_hess * x);
-    quad.affexpr.vars = vars_;
-    quad.affexpr.coeffs = util::toDblVec(grad - pos_hess * x);
-
-    size_t nquadterms = static_cast<size_t>((x.size() * (x.size() - 1)) / 2);
-    quad.coeffs.reserve(nquadterms);
-    quad.vars1.reserve(nquadterms);
-    quad.vars2.reserve(nquadterms);
-    for (long int i = 0, end = x.size(); i != end; ++i)
-    {  // tricky --- eigen size() is signed
-      quad.vars1.push_back(vars_[static_cast<size_t>(i)]);
-      quad.vars2.push_back(vars_[static_cast<size_t>(i)]);
-      quad.coeffs.push_back(pos_hess(i, i) / 2);
-      for (long int j = i + 1; j != end; ++j)
-      {  // tricky --- eigen size() is signed
-        quad.vars1.push_back(vars_[static_cast<size_t>(i)]);
-        quad.vars2.push_back(vars_[static_cast<size_t>(j)]);
-        quad.coeffs.push_back(pos_hess(i, j));
-      }
-    }
+    out->addQuadExpr(quadFromValGradHess(val, x, grad, positivePart(hess), vars_));
   }
 
   return out;
@@ -129,6 +251,15 @@ CostFromErrFunc::CostFromErrFunc(VectorOfVector::Ptr f,
   : Cost(name), f_(f), dfdx_(dfdx), vars_(vars), coeffs_(coeffs), pen_type_(pen_type), epsilon_(DEFAULT_EPSILON)
 {
 }
+CostFromErrFunc::CostFromErrFunc(VectorOfVector::Ptr f,
+                                 SparseMatrixOfVector::Ptr dfdx,
+                                 const VarVector& vars,
+                                 const Eigen::VectorXd& coeffs,
+                                 PenaltyType pen_type,
+                                 const std::string& name)
+  : Cost(name), f_(f), sparse_dfdx_(dfdx), vars_(vars), coeffs_(coeffs), pen_type_(pen_type), epsilon_(DEFAULT_EPSILON)
+{
+}
 double CostFromErrFunc::value(const DblVec& xin)
 {
   Eigen::VectorXd x = getVec(xin, vars_);
@@ -157,12 +288,11 @@ double CostFromErrFunc::value(const DblVec& xin)
 ConvexObjective::Ptr CostFromErrFunc::convex(const DblVec& xin, Model* model)
 {
   Eigen::VectorXd x = getVec(xin, vars_);
-  Eigen::MatrixXd jac = (dfdx_) ? dfdx_->call(x) : calcForwardNumJac(*f_, x, epsilon_);
+  std::vector<AffExpr> affs = linearizeErrFunc(*f_, dfdx_, sparse_dfdx_, x, vars_, epsilon_);
   ConvexObjective::Ptr out(new ConvexObjective(model));
-  Eigen::VectorXd y = f_->call(x);
-  for (int i = 0; i < jac.rows(); ++i)
+  for (int i = 0; i < static_cast<int>(affs.size()); ++i)
   {
-    AffExpr aff = affFromValGrad(y[i], x, jac.row(i), vars_);
+    AffExpr& aff = affs[static_cast<size_t>(i)];
     double weight = 1;
     if (coeffs_.size() > 0)
     {
@@ -196,6 +326,34 @@ ConvexObjective::Ptr CostFromErrFunc::convex(const DblVec& xin, Model* model)
         assert(0 && "unreachable");
     }
   }
+
+  if (qn_hessian_.type() != QN_NONE && pen_type_ != SQUARED)
+  {
+    // (Sub)gradient of the penalty at x from the linearized rows, which are scaled by their coefficients already
+    Eigen::VectorXd grad = Eigen::VectorXd::Zero(x.size());
+    for (size_t i = 0; i < affs.size(); ++i)
+    {
+      if (coeffs_.size() > 0 && coeffs_[static_cast<long int>(i)] == 0)
+        continue;
+
+      const AffExpr& aff = affs[i];
+      double err = aff.value(xin);
+      double slope = (pen_type_ == ABS) ? ((err > 0) - (err < 0)) : (err > 0);
+      if (slope == 0)
+        continue;
+      for (size_t j = 0; j < aff.vars.size(); ++j)
+      {
+        auto it = std::find_if(vars_.begin(), vars_.end(), [&aff, j](const Var& var) {
+          return var.var_rep == aff.vars[j].var_rep;
+        });
+        grad[it - vars_.begin()] += slope * aff.coeffs[j];
+      }
+    }
+
+    qn_hessian_.update(x, grad);
+    if (qn_hessian_.valid())
+      out->addQuadExpr(quadFromValGradHess(0, x, Eigen::VectorXd::Zero(x.size()), qn_hessian_.hessian(), vars_));
+  }
   return out;
 }
 
@@ -218,6 +376,16 @@ ConstraintFromErrFunc::ConstraintFromErrFunc(VectorOfVector::Ptr f,
 {
 }
 
+ConstraintFromErrFunc::ConstraintFromErrFunc(VectorOfVector::Ptr f,
+                                             SparseMatrixOfVector::Ptr dfdx,
+                                             const VarVector& vars,
+                                             const Eigen::VectorXd& coeffs,
+                                             ConstraintType type,
+                                             const std::string& name)
+  : Constraint(name), f_(f), sparse_dfdx_(dfdx), vars_(vars), coeffs_(coeffs), type_(type), epsilon_(DEFAULT_EPSILON)
+{
+}
+
 DblVec ConstraintFromErrFunc::value(const DblVec& xin)
 {
   Eigen::VectorXd x = getVec(xin, vars_);
@@ -230,12 +398,11 @@ DblVec ConstraintFromErrFunc::value(const DblVec& xin)
 ConvexConstraints::Ptr ConstraintFromErrFunc::convex(const DblVec& xin, Model* model)
 {
   Eigen::VectorXd x = getVec(xin, vars_);
-  Eigen::MatrixXd jac = (dfdx_) ? dfdx_->call(x) : calcForwardNumJac(*f_, x, epsilon_);
+  std::vector<AffExpr> affs = linearizeErrFunc(*f_, dfdx_, sparse_dfdx_, x, vars_, epsilon_);
   ConvexConstraints::Ptr out(new ConvexConstraints(model));
-  Eigen::VectorXd y = f_->call(x);
-  for (int i = 0; i < jac.rows(); ++i)
+  for (int i = 0; i < static_cast<int>(affs.size()); ++i)
   {
-    AffExpr aff = affFromValGrad(y[i], x, jac.row(i), vars_);
+    AffExpr& aff = affs[static_cast<size_t>(i)];
     if (coeffs_.size() > 0)
     {
       if (coeffs_[i] == 0)
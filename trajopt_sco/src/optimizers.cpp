@@ -1,16 +1,20 @@
 #include <trajopt_utils/macros.h>
 TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <algorithm>
 #include <boost/format.hpp>
 #include <cmath>
 #include <cstdio>
+#include <memory>
 #include <stdio.h>
 TRAJOPT_IGNORE_WARNINGS_POP
 
 #include <trajopt_sco/expr_ops.hpp>
+#include <trajopt_sco/iteration_log.hpp>
 #include <trajopt_sco/modeling.hpp>
 #include <trajopt_sco/optimizers.hpp>
 #include <trajopt_sco/sco_common.hpp>
 #include <trajopt_sco/solver_interface.hpp>
+#include <trajopt_utils/clock.hpp>
 #include <trajopt_utils/logging.hpp>
 #include <trajopt_utils/macros.h>
 #include <trajopt_utils/stl_to_string.hpp>
@@ -24,7 +28,39 @@ std::ostream& operator<<(std::ostream& o, const OptResults& r)
     << "cost values: " << util::Str(r.cost_vals) << std::endl
     << "constraint violations: " << util::Str(r.cnt_viols) << std::endl
     << "n func evals: " << r.n_func_evals << std::endl
-    << "n qp solves: " << r.n_qp_solves << std::endl;
+    << "n qp solves: " << r.n_qp_solves << std::endl
+    << "n rejected steps: " << r.n_rejected_steps << std::endl
+    << "n filter steps: " << r.n_filter_steps << std::endl
+    << "n backtrack steps: " << r.n_backtrack_steps << std::endl;
+  if (r.timing.total > 0)
+    o << r.timing;
+  return o;
+}
+
+OptPhaseTiming& OptPhaseTiming::operator+=(const OptPhaseTiming& other)
+{
+  convexify += other.convexify;
+  qp_build += other.qp_build;
+  qp_solve += other.qp_solve;
+  evaluate += other.evaluate;
+  return *this;
+}
+
+std::ostream& operator<<(std::ostream& o, const OptTiming& t)
+{
+  o << boost::format("timing (%i iterations): total %.3fs, convexify %.3fs, qp build %.3fs, qp solve %.3fs, "
+                     "evaluate %.3fs") %
+           t.iterations.size() % t.total % t.phases.convexify % t.phases.qp_build % t.phases.qp_solve %
+           t.phases.evaluate
+    << std::endl;
+  for (const auto& cost : t.costs)
+    o << boost::format("  cost %s: convexify %.3fs, evaluate %.3fs") % cost.first % cost.second.convexify %
+             cost.second.evaluate
+      << std::endl;
+  for (const auto& cnt : t.cnts)
+    o << boost::format("  constraint %s: convexify %.3fs, evaluate %.3fs") % cnt.first % cnt.second.convexify %
+             cnt.second.evaluate
+      << std::endl;
   return o;
 }
 
@@ -32,42 +68,80 @@ std::ostream& operator<<(std::ostream& o, const OptResults& r)
 ////////// private utility functions for  sqp /////////
 //////////////////////////////////////////////////
 
-static DblVec evaluateCosts(const std::vector<Cost::Ptr>& costs, const DblVec& x)
+/** @brief Returns the accumulator of entry i in times, or null if times is null or empty */
+static double* timeSlot(DblVec* times, size_t i)
+{
+  return (times != nullptr && !times->empty()) ? &(*times)[i] : nullptr;
+}
+
+static DblVec evaluateCosts(const std::vector<Cost::Ptr>& costs, const DblVec& x, DblVec* times = nullptr)
 {
   DblVec out(costs.size());
   for (size_t i = 0; i < costs.size(); ++i)
   {
+    util::ScopedTimer timer(timeSlot(times, i));
     out[i] = costs[i]->value(x);
   }
   return out;
 }
-static DblVec evaluateConstraintViols(const std::vector<Constraint::Ptr>& constraints, const DblVec& x)
+static DblVec evaluateConstraintViols(const std::vector<Constraint::Ptr>& constraints,
+                                      const DblVec& x,
+                                      DblVec* times = nullptr)
 {
   DblVec out(constraints.size());
   for (size_t i = 0; i < constraints.size(); ++i)
   {
+    util::ScopedTimer timer(timeSlot(times, i));
     out[i] = constraints[i]->violation(x);
   }
   return out;
 }
+/** @brief Convexifies the costs which declare themselves convex. Entries for all other costs are left null */
+static std::vector<ConvexObjective::Ptr> convexifyConvexCosts(const std::vector<Cost::Ptr>& costs,
+                                                              const DblVec& x,
+                                                              Model* model,
+                                                              DblVec* times = nullptr)
+{
+  std::vector<ConvexObjective::Ptr> out(costs.size());
+  for (size_t i = 0; i < costs.size(); ++i)
+  {
+    if (costs[i]->isConvex())
+    {
+      util::ScopedTimer timer(timeSlot(times, i));
+      out[i] = costs[i]->convex(x, model);
+    }
+  }
+  return out;
+}
+/** @brief Convexifies the costs, reusing the models in convex_cost_models where they exist */
 static std::vector<ConvexObjective::Ptr> convexifyCosts(const std::vector<Cost::Ptr>& costs,
+                                                        const std::vector<ConvexObjective::Ptr>& convex_cost_models,
                                                         const DblVec& x,
-                                                        Model* model)
+                                                        Model* model,
+                                                        DblVec* times = nullptr)
 {
   std::vector<ConvexObjective::Ptr> out(costs.size());
   for (size_t i = 0; i < costs.size(); ++i)
   {
+    if (convex_cost_models[i])
+    {
+      out[i] = convex_cost_models[i];
+      continue;
+    }
+    util::ScopedTimer timer(timeSlot(times, i));
     out[i] = costs[i]->convex(x, model);
   }
   return out;
 }
 static std::vector<ConvexConstraints::Ptr> convexifyConstraints(const std::vector<Constraint::Ptr>& cnts,
                                                                 const DblVec& x,
-                                                                Model* model)
+                                                                Model* model,
+                                                                DblVec* times = nullptr)
 {
   std::vector<ConvexConstraints::Ptr> out(cnts.size());
   for (size_t i = 0; i < cnts.size(); ++i)
   {
+    util::ScopedTimer timer(timeSlot(times, i));
     out[i] = cnts[i]->convex(x, model);
   }
   return out;
@@ -116,28 +190,52 @@ static std::vector<std::string> getVarNames(const VarVector& vars)
   return out;
 }
 
-// todo: use different coeffs for each constraint
+/** @brief Turns each convexified constraint into an l1 penalty weighted by its entry in err_coeffs */
 std::vector<ConvexObjective::Ptr> cntsToCosts(const std::vector<ConvexConstraints::Ptr>& cnts,
-                                              double err_coeff,
+                                              const DblVec& err_coeffs,
                                               Model* model)
 {
+  assert(cnts.size() == err_coeffs.size());
   std::vector<ConvexObjective::Ptr> out;
-  for (const ConvexConstraints::Ptr& cnt : cnts)
+  for (size_t i = 0; i < cnts.size(); ++i)
   {
     ConvexObjective::Ptr obj(new ConvexObjective(model));
-    for (const AffExpr& aff : cnt->eqs_)
+    for (const AffExpr& aff : cnts[i]->eqs_)
     {
-      obj->addAbs(aff, err_coeff);
+      obj->addAbs(aff, err_coeffs[i]);
     }
-    for (const AffExpr& aff : cnt->ineqs_)
+    for (const AffExpr& aff : cnts[i]->ineqs_)
     {
-      obj->addHinge(aff, err_coeff);
+      obj->addHinge(aff, err_coeffs[i]);
     }
     out.push_back(obj);
   }
   return out;
 }
 
+/**
+ * @brief Multiplies the penalty coefficients of the constraints violated by more than cnt_tolerance (of all
+ * constraints if violated_only is false) by ratio
+ * @return True if any coefficient was increased
+ */
+static bool increaseMeritCoeffs(DblVec& coeffs,
+                                const DblVec& cnt_viols,
+                                double cnt_tolerance,
+                                double ratio,
+                                bool violated_only)
+{
+  bool increased = false;
+  for (size_t i = 0; i < coeffs.size(); ++i)
+  {
+    if (!violated_only || cnt_viols[i] >= cnt_tolerance)
+    {
+      coeffs[i] *= ratio;
+      increased = true;
+    }
+  }
+  return increased;
+}
+
 void Optimizer::addCallback(const Callback& cb) { callbacks_.push_back(cb); }
 void Optimizer::callCallbacks()
 {
@@ -170,11 +268,19 @@ BasicTrustRegionSQPParameters::BasicTrustRegionSQPParameters()
   cnt_tolerance = 1e-4;
   max_merit_coeff_increases = 5;
   merit_coeff_increase_ratio = 10;
+  merit_coeff_increase_violated_only = true;
+  use_filter = false;
+  filter_margin = 1e-5;
+  max_backtrack_steps = 0;
+  backtrack_ratio = 0.5;
+  adapt_trust_box_scales = false;
+  trust_box_scale_ratio = 1.5;
   max_time = static_cast<double>(INFINITY);
   merit_error_coeff = 10;
   trust_box_size = 1e-1;
   log_results = false;
   log_dir = "/tmp";
+  record_timing = false;
 }
 
 BasicTrustRegionSQP::BasicTrustRegionSQP() {}
@@ -194,33 +300,99 @@ void BasicTrustRegionSQP::setTrustBoxConstraints(const DblVec& x)
   DblVec lbtrust(x.size()), ubtrust(x.size());
   for (size_t i = 0; i < x.size(); ++i)
   {
-    lbtrust[i] = fmax(x[i] - param_.trust_box_size, lb[i]);
-    ubtrust[i] = fmin(x[i] + param_.trust_box_size, ub[i]);
+    double size = param_.trust_box_size * trust_box_scales_[i];
+    lbtrust[i] = fmax(x[i] - size, lb[i]);
+    ubtrust[i] = fmin(x[i] + size, ub[i]);
   }
   model_->setVarBounds(vars, lbtrust, ubtrust);
 }
 
-#if 0
-struct MultiCritFilter {
-  /**
-   * Checks if you're making an improvement on a multidimensional objective
-   * Given a set of past error vectors, the improvement is defined as
-   * min_{olderrvec in past_err_vecs} | olderrvec - errvec |^+
-   */
-  vector<DblVec> errvecs;
-  double improvement(const DblVec& errvec) {
-    double leastImprovement=INFINITY;
-    for (const DblVec& olderrvec : errvecs) {
-      double improvement=0;
-      for (int i=0; i < errvec.size(); ++i) improvement += pospart(olderrvec[i] - errvec[i]);
-      leastImprovement = fmin(leastImprovement, improvement);
+void BasicTrustRegionSQP::initTrustBoxScales()
+{
+  const size_t n_vars = prob_->getVars().size();
+  const DblVec& scales = param_.trust_box_scales;
+  if (scales.empty())
+  {
+    trust_box_scales_.assign(n_vars, 1);
+  }
+  else
+  {
+    if (n_vars % scales.size() != 0)
+      PRINT_AND_THROW(boost::format("trust_box_scales has %i entries, which does not divide the %i variables") %
+                      scales.size() % n_vars);
+    trust_box_scales_.resize(n_vars);
+    for (size_t i = 0; i < n_vars; ++i)
+    {
+      if (!(scales[i % scales.size()] > 0))
+        PRINT_AND_THROW("trust_box_scales must be positive");
+      trust_box_scales_[i] = scales[i % scales.size()];
     }
-    return leastImprovement;
   }
-  void insert(const DblVec& x) {errvecs.push_back(x);}
-  bool empty() {return errvecs.size() > 0;}
+  initial_trust_box_scales_ = trust_box_scales_;
+}
+
+void BasicTrustRegionSQP::adaptTrustBoxScales(const DblVec& x, const DblVec& new_x)
+{
+  const DblVec& lb = prob_->getLowerBounds();
+  const DblVec& ub = prob_->getUpperBounds();
+  for (size_t i = 0; i < x.size(); ++i)
+  {
+    // A variable stopped by its bounds says nothing about its box
+    if (new_x[i] <= lb[i] || new_x[i] >= ub[i])
+      continue;
+
+    double size = param_.trust_box_size * trust_box_scales_[i];
+    double step = std::fabs(new_x[i] - x[i]);
+    double scale = trust_box_scales_[i];
+    if (step >= 0.99 * size)
+      scale *= param_.trust_box_scale_ratio;
+    else if (step < 0.25 * size)
+      scale /= param_.trust_box_scale_ratio;
+    trust_box_scales_[i] = fmin(fmax(scale, 0.1 * initial_trust_box_scales_[i]), 10 * initial_trust_box_scales_[i]);
+  }
+}
+
+/**
+ * Checks if you're making an improvement on a multidimensional objective, here (total cost, total constraint
+ * violation). A point is acceptable if, compared to each point in the filter, it reduces the violation or the cost by a
+ * margin proportional to the violation of that point, so the violation can not go up without bound while the cost
+ * goes down.
+ */
+struct MultiCritFilter
+{
+  std::vector<DblVec> errvecs;
+  double margin;
+
+  explicit MultiCritFilter(double margin) : margin(margin) {}
+
+  /** @brief Whether errvec improves on olderrvec in at least one criterion */
+  bool improves(const DblVec& olderrvec, const DblVec& errvec) const
+  {
+    return errvec[1] < (1 - margin) * olderrvec[1] || errvec[0] < olderrvec[0] - margin * olderrvec[1];
+  }
+
+  bool acceptable(const DblVec& errvec) const
+  {
+    for (const DblVec& olderrvec : errvecs)
+      if (!improves(olderrvec, errvec))
+        return false;
+    return true;
+  }
+
+  /** @brief Adds errvec and drops the points it dominates */
+  void insert(const DblVec& errvec)
+  {
+    errvecs.erase(std::remove_if(errvecs.begin(),
+                                 errvecs.end(),
+                                 [&errvec](const DblVec& olderrvec) {
+                                   return olderrvec[0] >= errvec[0] && olderrvec[1] >= errvec[1];
+                                 }),
+                  errvecs.end());
+    errvecs.push_back(errvec);
+  }
+
+  bool empty() const { return errvecs.empty(); }
 };
-#endif
 
 BasicTrustRegionSQPResults::BasicTrustRegionSQPResults(const std::vector<std::string>& var_names,
                                                        const std::vector<std::string>& cost_names,
@@ -251,9 +423,12 @@ void BasicTrustRegionSQPResults::update(const OptResults& prev_opt_results,
                                         const std::vector<ConvexObjective::Ptr>& cnt_cost_models,
                                         const std::vector<Constraint::Ptr>& constraints,
                                         const std::vector<Cost::Ptr>& costs,
-                                        const double merit_error_coeff)
+                                        const DblVec& merit_error_coeffs,
+                                        DblVec* cost_times,
+                                        DblVec* cnt_times)
 {
-  this->merit_error_coeff = merit_error_coeff;
+  this->merit_error_coeffs = merit_error_coeffs;
+  merit_error_coeff = merit_error_coeffs.empty() ? 0 : vecMax(merit_error_coeffs);
   model_var_vals = model.getVarValues(model.getVars());
   model_cost_vals = evaluateModelCosts(cost_models, model_var_vals);
   model_cnt_viols = evaluateModelCntViols(cnt_models, model_var_vals);
@@ -267,7 +442,7 @@ void BasicTrustRegionSQPResults::update(const OptResults& prev_opt_results,
     DblVec cnt_costs1 = evaluateModelCosts(cnt_cost_models, model_var_vals);
     DblVec cnt_costs2 = model_cnt_viols;
     for (unsigned i = 0; i < cnt_costs2.size(); ++i)
-      cnt_costs2[i] *= merit_error_coeff;
+      cnt_costs2[i] *= merit_error_coeffs[i];
     LOG_DEBUG("SHOULD BE ALMOST THE SAME: %s ?= %s", CSTR(cnt_costs1), CSTR(cnt_costs2));
     // not exactly the same because cnt_costs1 is based on aux variables,
     // but they might not be at EXACTLY the right value
@@ -275,12 +450,12 @@ void BasicTrustRegionSQPResults::update(const OptResults& prev_opt_results,
 
   old_cost_vals = prev_opt_results.cost_vals;
   old_cnt_viols = prev_opt_results.cnt_viols;
-  new_cost_vals = evaluateCosts(costs, new_x);
-  new_cnt_viols = evaluateConstraintViols(constraints, new_x);
+  new_cost_vals = evaluateCosts(costs, new_x, cost_times);
+  new_cnt_viols = evaluateConstraintViols(constraints, new_x, cnt_times);
 
-  old_merit = vecSum(old_cost_vals) + merit_error_coeff * vecSum(old_cnt_viols);
-  model_merit = vecSum(model_cost_vals) + merit_error_coeff * vecSum(model_cnt_viols);
-  new_merit = vecSum(new_cost_vals) + merit_error_coeff * vecSum(new_cnt_viols);
+  old_merit = vecSum(old_cost_vals) + vecDot(merit_error_coeffs, old_cnt_viols);
+  model_merit = vecSum(model_cost_vals) + vecDot(merit_error_coeffs, model_cnt_viols);
+  new_merit = vecSum(new_cost_vals) + vecDot(merit_error_coeffs, new_cnt_viols);
   approx_merit_improve = old_merit - model_merit;
   exact_merit_improve = old_merit - new_merit;
   merit_improve_ratio = exact_merit_improve / approx_merit_improve;
@@ -332,16 +507,16 @@ void BasicTrustRegionSQPResults::print() const
       if (fabs(approx_improve) > 1e-8)
         std::printf("%15s | %10.3e | %10.3e | %10.3e | %10.3e\n",
                     cnt_names[i].c_str(),
-                    merit_error_coeff * old_cnt_viols[i],
-                    merit_error_coeff * approx_improve,
-                    merit_error_coeff * exact_improve,
+                    merit_error_coeffs[i] * old_cnt_viols[i],
+                    merit_error_coeffs[i] * approx_improve,
+                    merit_error_coeffs[i] * exact_improve,
                     exact_improve / approx_improve);
       else
         std::printf("%15s | %10.3e | %10.3e | %10.3e | %10s\n",
                     cnt_names[i].c_str(),
-                    merit_error_coeff * old_cnt_viols[i],
-                    merit_error_coeff * approx_improve,
-                    merit_error_coeff * exact_improve,
+                    merit_error_coeffs[i] * old_cnt_viols[i],
+                    merit_error_coeffs[i] * approx_improve,
+                    merit_error_coeffs[i] * exact_improve,
                     "  ------  ");
     }
   }
@@ -354,121 +529,6 @@ void BasicTrustRegionSQPResults::print() const
               merit_improve_ratio);
 }
 
-void BasicTrustRegionSQPResults::writeSolver(std::FILE* stream, bool header) const
-{
-  if (header)
-    std::fprintf(stream, "%s,%s,%s,%s,%s\n", "DESCRIPTION", "oldexact", "dapprox", "dexact", "ratio");
-
-  std::fprintf(stream,
-               "%s,%10.3e,%10.3e,%10.3e,%10.3e\n",
-               "Solver",
-               old_merit,
-               approx_merit_improve,
-               exact_merit_improve,
-               merit_improve_ratio);
-  std::fflush(stream);
-}
-
-void BasicTrustRegionSQPResults::writeVars(std::FILE* stream, bool header) const
-{
-  if (header)
-  {
-    std::fprintf(stream, "%s", "NAMES");
-    for (const auto& var : var_names)
-      std::fprintf(stream, ",%s", var.c_str());
-
-    std::fprintf(stream, "\n");
-  }
-
-  std::fprintf(stream, "%s", "VALUES");
-  for (const auto& x : new_x)
-    std::fprintf(stream, ",%e", x);
-
-  std::fprintf(stream, "\n");
-  std::fflush(stream);
-}
-
-void BasicTrustRegionSQPResults::writeCosts(std::FILE* stream, bool header) const
-{
-  if (header)
-  {
-    std::fprintf(stream, "%s", "COST NAMES");
-    for (const auto& name : cost_names)
-      std::fprintf(stream, ",%s,%s,%s,%s", name.c_str(), name.c_str(), name.c_str(), name.c_str());
-
-    std::fprintf(stream, "\n");
-
-    std::fprintf(stream, "%s", "DESCRIPTION");
-    for (size_t i = 0; i < cost_names.size(); ++i)
-      std::fprintf(stream, ",%s,%s,%s,%s", "oldexact", "dapprox", "dexact", "ratio");
-
-    std::fprintf(stream, "\n");
-  }
-
-  std::fprintf(stream, "%s", "COSTS");
-  for (size_t i = 0; i < old_cost_vals.size(); ++i)
-  {
-    double approx_improve = old_cost_vals[i] - model_cost_vals[i];
-    double exact_improve = old_cost_vals[i] - new_cost_vals[i];
-    if (fabs(approx_improve) > 1e-8)
-    {
-      std::fprintf(
-          stream, ",%e,%e,%e,%e", old_cost_vals[i], approx_improve, exact_improve, exact_improve / approx_improve);
-    }
-    else
-    {
-      std::fprintf(stream, ",%e,%e,%e,%s", old_cost_vals[i], approx_improve, exact_improve, "nan");
-    }
-  }
-  std::fprintf(stream, "\n");
-  std::fflush(stream);
-}
-
-void BasicTrustRegionSQPResults::writeConstraints(std::FILE* stream, bool header) const
-{
-  if (header)
-  {
-    std::fprintf(stream, "%s", "CONSTRAINT NAMES");
-    for (const auto& name : cnt_names)
-      std::fprintf(stream, ",%s,%s,%s,%s", name.c_str(), name.c_str(), name.c_str(), name.c_str());
-
-    std::fprintf(stream, "\n");
-
-    std::fprintf(stream, "%s", "DESCRIPTION");
-    for (size_t i = 0; i < cnt_names.size(); ++i)
-      std::fprintf(stream, ",%s,%s,%s,%s", "oldexact", "dapprox", "dexact", "ratio");
-
-    std::fprintf(stream, "\n");
-  }
-
-  std::fprintf(stream, "%s", "CONSTRAINTS");
-  for (size_t i = 0; i < old_cnt_viols.size(); ++i)
-  {
-    double approx_improve = old_cnt_viols[i] - model_cnt_viols[i];
-    double exact_improve = old_cnt_viols[i] - new_cnt_viols[i];
-    if (fabs(approx_improve) > 1e-8)
-    {
-      std::fprintf(stream,
-                   ",%e,%e,%e,%e",
-                   merit_error_coeff * old_cnt_viols[i],
-                   merit_error_coeff * approx_improve,
-                   merit_error_coeff * exact_improve,
-                   exact_improve / approx_improve);
-    }
-    else
-    {
-      std::fprintf(stream,
-                   ",%e,%e,%e,%s",
-                   merit_error_coeff * old_cnt_viols[i],
-                   merit_error_coeff * approx_improve,
-                   merit_error_coeff * exact_improve,
-                   "nan");
-    }
-  }
-  std::fprintf(stream, "\n");
-  std::fflush(stream);
-}
-
 OptStatus BasicTrustRegionSQP::optimize()
 {
   std::vector<std::string> var_names = getVarNames(prob_->getVars());
@@ -477,36 +537,114 @@ OptStatus BasicTrustRegionSQP::optimize()
   std::vector<std::string> cnt_names = getCntNames(constraints);
   BasicTrustRegionSQPResults iteration_results(var_names, cost_names, cnt_names);
 
-  std::FILE* log_solver_stream = nullptr;
-  std::FILE* log_vars_stream = nullptr;
-  std::FILE* log_costs_stream = nullptr;
-  std::FILE* log_constraints_stream = nullptr;
+  // Phase times go to the current iteration and term times are indexed like the problem's costs and constraints. The
+  // term time vectors are left empty unless timing is recorded, which disables their timers.
+  const bool record_timing = param_.record_timing;
+  const double start_time = util::GetClock();
+  results_.timing.clear();
+  OptPhaseTiming* phase_timing = record_timing ? &results_.timing.phases : nullptr;
+  auto phase = [&phase_timing](double OptPhaseTiming::*member) {
+    return (phase_timing != nullptr) ? &(phase_timing->*member) : nullptr;
+  };
+  DblVec cost_convexify_times, cost_evaluate_times, cnt_convexify_times, cnt_evaluate_times;
+  if (record_timing)
+  {
+    cost_convexify_times.assign(cost_names.size(), 0);
+    cost_evaluate_times.assign(cost_names.size(), 0);
+    cnt_convexify_times.assign(cnt_names.size(), 0);
+    cnt_evaluate_times.assign(cnt_names.size(), 0);
+  }
+
+  std::unique_ptr<IterationLogWriter> iteration_log;
   if (param_.log_results || util::GetLogLevel() >= util::LevelDebug)
   {
-    log_solver_stream = std::fopen((param_.log_dir + "/trajopt_solver.log").c_str(), "w");
-    log_vars_stream = std::fopen((param_.log_dir + "/trajopt_vars.log").c_str(), "w");
-    log_costs_stream = std::fopen((param_.log_dir + "/trajopt_costs.log").c_str(), "w");
-    log_constraints_stream = std::fopen((param_.log_dir + "/trajopt_constraints.log").c_str(), "w");
+    iteration_log.reset(
+        new IterationLogWriter(param_.log_dir + "/trajopt_iterations.bin", var_names, cost_names, cnt_names));
   }
 
   if (results_.x.size() == 0)
     PRINT_AND_THROW("you forgot to initialize!");
   if (!prob_)
     PRINT_AND_THROW("you forgot to set the optimization problem");
+  initTrustBoxScales();
+  for (const Cost::Ptr& cost : prob_->getCosts())
+    cost->reset();
 
-  results_.x = prob_->getClosestFeasiblePoint(results_.x);
+  {
+    util::ScopedTimer timer(phase(&OptPhaseTiming::qp_solve));
+    results_.x = prob_->getClosestFeasiblePoint(results_.x);
+  }
 
   assert(results_.x.size() == prob_->getVars().size());
   assert(prob_->getCosts().size() > 0 || constraints.size() > 0);
 
   OptStatus retval = INVALID;
+  results_.merit_error_coeffs.assign(constraints.size(), param_.merit_error_coeff);
+  MultiCritFilter filter(param_.filter_margin);
+
+  // Anytime mode: feasible iterates are published as soon as their cost improves on the last published one
+  double published_cost = static_cast<double>(INFINITY);
+  auto publish = [&]() {
+    if (!mailbox_ || (!results_.cnt_viols.empty() && vecMax(results_.cnt_viols) >= param_.cnt_tolerance))
+      return;
+    double total_cost = vecSum(results_.cost_vals);
+    if (total_cost >= published_cost)
+      return;
+    published_cost = total_cost;
+    AnytimeSolution solution;
+    solution.x = results_.x;
+    solution.total_cost = total_cost;
+    solution.max_cnt_viol = results_.cnt_viols.empty() ? 0 : vecMax(results_.cnt_viols);
+    solution.n_qp_solves = results_.n_qp_solves;
+    mailbox_->publish(solution);
+  };
+
+  // Costs that are already convex are added to the model once and stay resident for every iteration
+  std::vector<ConvexObjective::Ptr> convex_cost_models;
+  {
+    util::ScopedTimer timer(phase(&OptPhaseTiming::convexify));
+    convex_cost_models = convexifyConvexCosts(prob_->getCosts(), results_.x, model_.get(), &cost_convexify_times);
+  }
+  QuadExpr convex_objective;
+  {
+    util::ScopedTimer timer(phase(&OptPhaseTiming::qp_build));
+    model_->update();
+    for (ConvexObjective::Ptr& cost : convex_cost_models)
+    {
+      if (cost)
+      {
+        cost->addConstraintsToModel();
+        exprInc(convex_objective, cost->quad_);
+      }
+    }
+    model_->update();
+  }
 
   for (int merit_increases = 0; merit_increases < param_.max_merit_coeff_increases; ++merit_increases)
   { /* merit adjustment loop */
     for (int iter = 1;; ++iter)
     { /* sqp loop */
+      // The first iteration always runs, so a time limited optimization still returns an improved point
+      if ((iter > 1 || merit_increases > 0) && util::GetClock() - start_time > param_.max_time)
+      {
+        LOG_INFO("time limit");
+        retval = OPT_TIME_LIMIT;
+        goto cleanup;
+      }
+      if (cancelled())
+      {
+        retval = OPT_CANCELLED;
+        goto cleanup;
+      }
+
       callCallbacks();
 
+      if (record_timing)
+      {
+        results_.timing.iterations.emplace_back();
+        phase_timing = &results_.timing.iterations.back();
+      }
+
       LOG_DEBUG("current iterate: %s", CSTR(results_.x));
       LOG_INFO("iteration %i", iter);
 
@@ -514,10 +652,12 @@ OptStatus BasicTrustRegionSQP::optimize()
       // that
       if (results_.cost_vals.empty() && results_.cnt_viols.empty())
       {  // only happens on the first iteration
-        results_.cnt_viols = evaluateConstraintViols(constraints, results_.x);
-        results_.cost_vals = evaluateCosts(prob_->getCosts(), results_.x);
+        util::ScopedTimer timer(phase(&OptPhaseTiming::evaluate));
+        results_.cnt_viols = evaluateConstraintViols(constraints, results_.x, &cnt_evaluate_times);
+        results_.cost_vals = evaluateCosts(prob_->getCosts(), results_.x, &cost_evaluate_times);
         assert(results_.n_func_evals == 0);
         ++results_.n_func_evals;
+        publish();
       }
 
       // DblVec new_cnt_viols = evaluateConstraintViols(constraints, results_.x);
@@ -532,24 +672,41 @@ OptStatus BasicTrustRegionSQP::optimize()
       //   results_.cost_vals[i] << endl;
       // }
 
-      std::vector<ConvexObjective::Ptr> cost_models = convexifyCosts(prob_->getCosts(), results_.x, model_.get());
-      std::vector<ConvexConstraints::Ptr> cnt_models = convexifyConstraints(constraints, results_.x, model_.get());
-      std::vector<ConvexObjective::Ptr> cnt_cost_models =
-          cntsToCosts(cnt_models, param_.merit_error_coeff, model_.get());
-      model_->update();
-      for (ConvexObjective::Ptr& cost : cost_models)
-        cost->addConstraintsToModel();
-      for (ConvexObjective::Ptr& cost : cnt_cost_models)
-        cost->addConstraintsToModel();
-      model_->update();
-      QuadExpr objective;
-      for (ConvexObjective::Ptr& co : cost_models)
-        exprInc(objective, co->quad_);
-      for (ConvexObjective::Ptr& co : cnt_cost_models)
-        exprInc(objective, co->quad_);
+      std::vector<ConvexObjective::Ptr> cost_models;
+      std::vector<ConvexConstraints::Ptr> cnt_models;
+      {
+        util::ScopedTimer timer(phase(&OptPhaseTiming::convexify));
+        cost_models =
+            convexifyCosts(prob_->getCosts(), convex_cost_models, results_.x, model_.get(), &cost_convexify_times);
+        cnt_models = convexifyConstraints(constraints, results_.x, model_.get(), &cnt_convexify_times);
+      }
+      if (cancelled())
+      {
+        retval = OPT_CANCELLED;
+        goto cleanup;
+      }
 
-      //    objective = cleanupExpr(objective);
-      model_->setObjective(objective);
+      std::vector<ConvexObjective::Ptr> cnt_cost_models;
+      {
+        util::ScopedTimer timer(phase(&OptPhaseTiming::qp_build));
+        cnt_cost_models = cntsToCosts(cnt_models, results_.merit_error_coeffs, model_.get());
+        model_->update();
+        for (size_t i = 0; i < cost_models.size(); ++i)
+          if (!convex_cost_models[i])
+            cost_models[i]->addConstraintsToModel();
+        for (ConvexObjective::Ptr& cost : cnt_cost_models)
+          cost->addConstraintsToModel();
+        model_->update();
+        QuadExpr objective = convex_objective;
+        for (size_t i = 0; i < cost_models.size(); ++i)
+          if (!convex_cost_models[i])
+            exprInc(objective, cost_models[i]->quad_);
+        for (ConvexObjective::Ptr& co : cnt_cost_models)
+          exprInc(objective, co->quad_);
+
+        //    objective = cleanupExpr(objective);
+        model_->setObjective(objective);
+      }
 
       //    if (logging::filter() >= IPI_LEVEL_DEBUG) {
       //      DblVec model_cost_vals;
@@ -562,8 +719,20 @@ OptStatus BasicTrustRegionSQP::optimize()
 
       while (param_.trust_box_size >= param_.min_trust_box_size)
       {
-        setTrustBoxConstraints(results_.x);
-        CvxOptStatus status = model_->optimize();
+        if (cancelled())
+        {
+          retval = OPT_CANCELLED;
+          goto cleanup;
+        }
+        {
+          util::ScopedTimer timer(phase(&OptPhaseTiming::qp_build));
+          setTrustBoxConstraints(results_.x);
+        }
+        CvxOptStatus status;
+        {
+          util::ScopedTimer timer(phase(&OptPhaseTiming::qp_solve));
+          status = model_->optimize();
+        }
 
         ++results_.n_qp_solves;
         if (status != CVX_SOLVED)
@@ -576,31 +745,29 @@ OptStatus BasicTrustRegionSQP::optimize()
           retval = OPT_FAILED;
           goto cleanup;
         }
-
-        iteration_results.update(results_,
-                                 *model_,
-                                 cost_models,
-                                 cnt_models,
-                                 cnt_cost_models,
-                                 constraints,
-                                 prob_->getCosts(),
-                                 param_.merit_error_coeff);
-
-        if (param_.log_results || util::GetLogLevel() >= util::LevelDebug)
+        if (cancelled())
         {
-          if (log_solver_stream != nullptr)
-            iteration_results.writeSolver(log_solver_stream, results_.n_func_evals == 1);
-
-          if (log_vars_stream != nullptr)
-            iteration_results.writeVars(log_vars_stream, results_.n_func_evals == 1);
-
-          if (log_costs_stream != nullptr)
-            iteration_results.writeCosts(log_costs_stream, results_.n_func_evals == 1);
+          retval = OPT_CANCELLED;
+          goto cleanup;
+        }
 
-          if (log_constraints_stream != nullptr)
-            iteration_results.writeConstraints(log_constraints_stream, results_.n_func_evals == 1);
+        {
+          util::ScopedTimer timer(phase(&OptPhaseTiming::evaluate));
+          iteration_results.update(results_,
+                                   *model_,
+                                   cost_models,
+                                   cnt_models,
+                                   cnt_cost_models,
+                                   constraints,
+                                   prob_->getCosts(),
+                                   results_.merit_error_coeffs,
+                                   &cost_evaluate_times,
+                                   &cnt_evaluate_times);
         }
 
+        if (iteration_log)
+          iteration_log->write(iteration_results);
+
         ++results_.n_func_evals;
 
         if (iteration_results.approx_merit_improve < -1e-5)
@@ -627,19 +794,77 @@ OptStatus BasicTrustRegionSQP::optimize()
           retval = OPT_CONVERGED;
           goto penaltyadjustment;
         }
-        else if (iteration_results.exact_merit_improve < 0 ||
-                 iteration_results.merit_improve_ratio < param_.improve_ratio_threshold)
+
+        bool merit_accepts = iteration_results.exact_merit_improve >= 0 &&
+                             iteration_results.merit_improve_ratio >= param_.improve_ratio_threshold;
+        bool filter_accepts = false;
+        DblVec old_errvec;
+        if (!merit_accepts && param_.use_filter)
         {
+          old_errvec = { vecSum(iteration_results.old_cost_vals), vecSum(iteration_results.old_cnt_viols) };
+          DblVec new_errvec{ vecSum(iteration_results.new_cost_vals), vecSum(iteration_results.new_cnt_viols) };
+          filter_accepts = filter.improves(old_errvec, new_errvec) && filter.acceptable(new_errvec);
+        }
+
+        // The exact merit is evaluated along the step before paying for another QP solve. The model is convex and exact
+        // at x, so alpha times the predicted improvement is a lower bound on the model improvement at x + alpha * d.
+        double alpha = 1;
+        for (int k = 0; !merit_accepts && !filter_accepts && k < param_.max_backtrack_steps; ++k)
+        {
+          util::ScopedTimer timer(phase(&OptPhaseTiming::evaluate));
+          alpha *= param_.backtrack_ratio;
+          DblVec x_alpha(results_.x.size());
+          for (size_t i = 0; i < x_alpha.size(); ++i)
+            x_alpha[i] = results_.x[i] + alpha * (iteration_results.new_x[i] - results_.x[i]);
+          DblVec cost_vals = evaluateCosts(prob_->getCosts(), x_alpha, &cost_evaluate_times);
+          DblVec cnt_viols = evaluateConstraintViols(constraints, x_alpha, &cnt_evaluate_times);
+          ++results_.n_func_evals;
+
+          double merit = vecSum(cost_vals) + vecDot(results_.merit_error_coeffs, cnt_viols);
+          double exact_improve = iteration_results.old_merit - merit;
+          if (exact_improve >= param_.improve_ratio_threshold * alpha * iteration_results.approx_merit_improve)
+          {
+            LOG_INFO("accepted step after backtracking to alpha = %.4f", alpha);
+            ++results_.n_backtrack_steps;
+            iteration_results.new_x = x_alpha;
+            iteration_results.new_cost_vals = cost_vals;
+            iteration_results.new_cnt_viols = cnt_viols;
+            merit_accepts = true;
+          }
+        }
+
+        if (!merit_accepts && !filter_accepts)
+        {
+          ++results_.n_rejected_steps;
           adjustTrustRegion(param_.trust_shrink_ratio);
           LOG_INFO("shrunk trust region. new box size: %.4f", param_.trust_box_size);
         }
         else
         {
+          if (merit_accepts && alpha == 1 && param_.adapt_trust_box_scales)
+            adaptTrustBoxScales(results_.x, iteration_results.new_x);
           results_.x = iteration_results.new_x;
           results_.cost_vals = iteration_results.new_cost_vals;
           results_.cnt_viols = iteration_results.new_cnt_viols;
-          adjustTrustRegion(param_.trust_expand_ratio);
-          LOG_INFO("expanded trust region. new box size: %.4f", param_.trust_box_size);
+          publish();
+          if (merit_accepts && alpha < 1)
+          {
+            // The model was only good enough for a fraction of the step
+            adjustTrustRegion(alpha);
+            LOG_INFO("shrunk trust region to the backtracked step. new box size: %.4f", param_.trust_box_size);
+          }
+          else if (merit_accepts)
+          {
+            adjustTrustRegion(param_.trust_expand_ratio);
+            LOG_INFO("expanded trust region. new box size: %.4f", param_.trust_box_size);
+          }
+          else
+          {
+            // The point is left behind in the filter so the iterates can not return to it
+            ++results_.n_filter_steps;
+            filter.insert(old_errvec);
+            LOG_INFO("accepted step by filter. box size: %.4f", param_.trust_box_size);
+          }
           break;
         }
       }
@@ -668,7 +893,13 @@ OptStatus BasicTrustRegionSQP::optimize()
     else
     {
       LOG_INFO("not all constraints are satisfied. increasing penalties");
-      param_.merit_error_coeff *= param_.merit_coeff_increase_ratio;
+      if (increaseMeritCoeffs(results_.merit_error_coeffs,
+                              results_.cnt_viols,
+                              param_.cnt_tolerance,
+                              param_.merit_coeff_increase_ratio,
+                              param_.merit_coeff_increase_violated_only))
+        ++results_.n_merit_increases;
+      param_.merit_error_coeff = vecMax(results_.merit_error_coeffs);
       param_.trust_box_size = fmax(param_.trust_box_size, param_.min_trust_box_size / param_.trust_shrink_ratio * 1.5);
     }
   }
@@ -677,18 +908,33 @@ OptStatus BasicTrustRegionSQP::optimize()
 
 cleanup:
   assert(retval != INVALID && "should never happen");
+  if (retval == OPT_CANCELLED)
+    LOG_INFO("optimization cancelled");
   results_.status = retval;
   results_.total_cost = vecSum(results_.cost_vals);
+  results_.trust_box_scales = trust_box_scales_;
+  if (record_timing)
+  {
+    OptTiming& timing = results_.timing;
+    for (const OptPhaseTiming& iteration : timing.iterations)
+      timing.phases += iteration;
+    for (size_t i = 0; i < cost_names.size(); ++i)
+    {
+      timing.costs[cost_names[i]].convexify += cost_convexify_times[i];
+      timing.costs[cost_names[i]].evaluate += cost_evaluate_times[i];
+    }
+    for (size_t i = 0; i < cnt_names.size(); ++i)
+    {
+      timing.cnts[cnt_names[i]].convexify += cnt_convexify_times[i];
+      timing.cnts[cnt_names[i]].evaluate += cnt_evaluate_times[i];
+    }
+    timing.total = util::GetClock() - start_time;
+  }
   LOG_INFO("\n==================\n%s==================", CSTR(results_));
   callCallbacks();
 
-  if (param_.log_results || util::GetLogLevel() >= util::LevelDebug)
-  {
-    std::fclose(log_solver_stream);
-    std::fclose(log_vars_stream);
-    std::fclose(log_costs_stream);
-    std::fclose(log_constraints_stream);
-  }
+  // Waits for the writer thread to finish the remaining records
+  iteration_log.reset();
 
   return retval;
 }
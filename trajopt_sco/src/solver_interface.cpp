@@ -11,7 +11,7 @@ TRAJOPT_IGNORE_WARNINGS_POP
 
 namespace sco
 {
-const std::vector<std::string> ModelType::MODEL_NAMES_ = { "GUROBI", "BPMPD", "OSQP", "QPOASES", "AUTO_SOLVER" };
+const std::vector<std::string> ModelType::MODEL_NAMES_ = { "GUROBI", "BPMPD", "OSQP", "QPOASES", "BANDED", "AUTO_SOLVER" };
 
 IntVec vars2inds(const VarVector& vars)
 {
@@ -213,6 +213,7 @@ std::vector<ModelType> availableSolvers()
 #ifdef HAVE_QPOASES
   has_solver[ModelType::QPOASES] = true;
 #endif
+  has_solver[ModelType::BANDED] = true;
   size_t n_available_solvers = 0;
   for (auto i = 0; i < ModelType::AUTO_SOLVER; ++i)
     if (has_solver[static_cast<size_t>(i)])
@@ -240,6 +241,7 @@ Model::Ptr createModel(ModelType model_type)
 #ifdef HAVE_QPOASES
   extern Model::Ptr createqpOASESModel();
 #endif
+  extern Model::Ptr createBandedQPModel();
 
   char* solver_env = getenv("TRAJOPT_CONVEX_SOLVER");
 
@@ -297,6 +299,8 @@ Model::Ptr createModel(ModelType model_type)
   if (solver == ModelType::QPOASES)
     return createqpOASESModel();
 #endif
+  if (solver == ModelType::BANDED)
+    return createBandedQPModel();
   std::stringstream solver_instatiation_error;
   solver_instatiation_error << "Failed to create solver: unknown solver " << solver << std::endl;
   PRINT_AND_THROW(solver_instatiation_error.str());
@@ -0,0 +1,129 @@
+#include <trajopt_utils/macros.h>
+TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <thread>
+#include <gtest/gtest.h>
+TRAJOPT_IGNORE_WARNINGS_POP
+
+#include <trajopt_sco/anytime.hpp>
+#include <trajopt_sco/modeling_utils.hpp>
+#include <trajopt_sco/optimizers.hpp>
+#include <trajopt_sco/sco_common.hpp>
+
+using namespace sco;
+
+namespace
+{
+double f_Valley(const Eigen::VectorXd& x) { return sq(x(0) - 1) + sq(0.01 * x(1) - 1); }
+
+OptProb::Ptr valleyProblem()
+{
+  OptProb::Ptr prob(new OptProb());
+  prob->createVariables({ "x_0", "x_1" });
+  prob->addCost(Cost::Ptr(new CostFromFunc(ScalarOfVector::construct(&f_Valley), prob->getVars(), "f", true)));
+  return prob;
+}
+}  // namespace
+
+/** Only the newest published solution is taken, and only once */
+TEST(AnytimeMailbox, NewestOnce)
+{
+  AnytimeMailbox mailbox;
+  AnytimeSolution solution;
+  EXPECT_FALSE(mailbox.take(solution));
+
+  for (int i = 1; i <= 3; ++i)
+  {
+    solution.n_qp_solves = i;
+    mailbox.publish(solution);
+  }
+  AnytimeSolution taken;
+  ASSERT_TRUE(mailbox.take(taken));
+  EXPECT_EQ(taken.n_qp_solves, 3);
+  EXPECT_FALSE(mailbox.take(taken));
+
+  solution.n_qp_solves = 4;
+  mailbox.publish(solution);
+  ASSERT_TRUE(mailbox.take(taken));
+  EXPECT_EQ(taken.n_qp_solves, 4);
+}
+
+/** A consumer thread never sees a partially written solution or an older one after a newer one */
+TEST(AnytimeMailbox, ProducerConsumer)
+{
+  const int n_published = 100000;
+  AnytimeMailbox mailbox;
+  std::thread producer([&mailbox]() {
+    AnytimeSolution solution;
+    for (int i = 1; i <= n_published; ++i)
+    {
+      solution.n_qp_solves = i;
+      solution.x.assign(static_cast<size_t>(1 + i % 7), static_cast<double>(i));
+      mailbox.publish(solution);
+    }
+  });
+
+  int last = 0;
+  AnytimeSolution taken;
+  while (last < n_published)
+  {
+    if (!mailbox.take(taken))
+      continue;
+    ASSERT_GT(taken.n_qp_solves, last);
+    ASSERT_EQ(taken.x.size(), static_cast<size_t>(1 + taken.n_qp_solves % 7));
+    for (double v : taken.x)
+      ASSERT_EQ(v, static_cast<double>(taken.n_qp_solves));
+    last = taken.n_qp_solves;
+  }
+  producer.join();
+}
+
+/** Improving iterates are available in the mailbox while the optimization runs, the last one is the result */
+TEST(Anytime, PublishesImprovingIterates)
+{
+  BasicTrustRegionSQP solver(valleyProblem());
+  AnytimeMailbox::Ptr mailbox = std::make_shared<AnytimeMailbox>();
+  solver.setAnytimeMailbox(mailbox);
+
+  int n_taken = 0;
+  double last_cost = static_cast<double>(INFINITY);
+  auto consume = [&]() {
+    AnytimeSolution solution;
+    if (!mailbox->take(solution))
+      return;
+    EXPECT_LT(solution.total_cost, last_cost);
+    EXPECT_NEAR(solution.total_cost, f_Valley(Eigen::Map<const Eigen::VectorXd>(solution.x.data(), 2)), 1e-9);
+    last_cost = solution.total_cost;
+    ++n_taken;
+  };
+  solver.addCallback([&](OptProb*, OptResults&) { consume(); });
+
+  solver.initialize({ 0, 0 });
+  EXPECT_EQ(solver.optimize(), OPT_CONVERGED);
+  consume();
+  EXPECT_GT(n_taken, 2);
+  EXPECT_DOUBLE_EQ(last_cost, solver.results().total_cost);
+}
+
+/** A cancelled optimization stops at the next phase boundary and keeps the last accepted iterate */
+TEST(Anytime, Cancellation)
+{
+  BasicTrustRegionSQP solver(valleyProblem());
+  CancellationToken::Ptr token = std::make_shared<CancellationToken>();
+  solver.setCancellationToken(token);
+
+  int n_iterations = 0;
+  solver.addCallback([&](OptProb*, OptResults&) {
+    if (++n_iterations == 3)
+      token->cancel();
+  });
+
+  solver.initialize({ 0, 0 });
+  EXPECT_EQ(solver.optimize(), OPT_CANCELLED);
+  EXPECT_EQ(solver.results().status, OPT_CANCELLED);
+  EXPECT_LT(solver.results().total_cost, f_Valley(Eigen::Vector2d(0, 0)));
+  EXPECT_EQ(solver.results().n_qp_solves, 2);
+
+  token->reset();
+  solver.initialize({ 0, 0 });
+  EXPECT_EQ(solver.optimize(), OPT_CONVERGED);
+}
@@ -0,0 +1,64 @@
+#include <trajopt_utils/macros.h>
+TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <string>
+#include <gtest/gtest.h>
+TRAJOPT_IGNORE_WARNINGS_POP
+
+#include <trajopt_sco/banded_qp_interface.hpp>
+#include <trajopt_sco/expr_ops.hpp>
+#include <trajopt_sco/solver_interface.hpp>
+#include "trajectory_qp.hpp"
+
+using namespace sco;
+
+/** Minimizing the squared velocity between a fixed start and goal gives the straight line, without any slack */
+TEST(BandedQP, StraightLine)
+{
+  const int n_steps = 30;
+  BandedQPModel banded;
+  Model& model = banded;
+  VarVector vars;
+  for (int t = 0; t < n_steps; ++t)
+    vars.push_back(model.addVar("x" + std::to_string(t), -10., 10.));
+  model.update();
+
+  QuadExpr objective;
+  for (int t = 0; t + 1 < n_steps; ++t)
+    exprInc(objective, exprSquare(exprSub(AffExpr(vars[static_cast<size_t>(t + 1)]), vars[static_cast<size_t>(t)])));
+  model.setObjective(objective);
+  model.addEqCnt(exprSub(AffExpr(vars.front()), 1.), "start");
+  model.addEqCnt(exprSub(AffExpr(vars.back()), 4.), "goal");
+
+  ASSERT_EQ(model.optimize(), CVX_SOLVED);
+  DblVec x = model.getVarValues(vars);
+  for (int t = 0; t < n_steps; ++t)
+    EXPECT_NEAR(x[static_cast<size_t>(t)], 1. + 3. * t / (n_steps - 1), 1e-6);
+}
+
+/** An infeasible QP is reported as such */
+TEST(BandedQP, Infeasible)
+{
+  BandedQPModel banded;
+  Model& model = banded;
+  Var x = model.addVar("x", 0., 1.);
+  model.update();
+  model.setObjective(exprSquare(x));
+  model.addEqCnt(exprSub(AffExpr(x), 2.), "out_of_bounds");
+  EXPECT_EQ(model.optimize(), CVX_INFEASIBLE);
+}
+
+/** The slacks created after all joints are ordered next to their steps, so the band does not grow with n_steps */
+TEST(BandedQP, EnvelopeIsLinearInSteps)
+{
+  double per_row[2];
+  int steps[2] = { 20, 500 };
+  for (int i = 0; i < 2; ++i)
+  {
+    BandedQPModel model;
+    TrajectoryQP qp(model, steps[i], 7);
+    ASSERT_EQ(model.optimize(), CVX_SOLVED);
+    per_row[i] = static_cast<double>(model.getEnvelopeSize()) / static_cast<double>(model.getSystemSize());
+  }
+  EXPECT_LT(per_row[1], 1.5 * per_row[0]);
+}
+
@@ -0,0 +1,71 @@
+#include <trajopt_utils/macros.h>
+TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+#include <vector>
+TRAJOPT_IGNORE_WARNINGS_POP
+
+#include <trajopt_sco/solver_interface.hpp>
+#include <trajopt_utils/clock.hpp>
+#include "trajectory_qp.hpp"
+
+using namespace sco;
+
+/**
+ * Reports the solve time of each available solver on trajectory QPs from 20 to 500 steps.
+ *
+ * The interior point solvers are checked against the banded solver, the benchmark returns 1 if they disagree.
+ */
+int main(int /*argc*/, char** /*argv*/)
+{
+  const int n_dof = 7;
+  // The banded solver runs first, the other solvers are checked against its solution
+  std::vector<ModelType> solvers{ ModelType::BANDED };
+  for (const ModelType& solver : availableSolvers())
+  {
+    if (!(solver == ModelType::BANDED))
+      solvers.push_back(solver);
+  }
+
+  printf("%8s %8s", "steps", "vars");
+  for (const ModelType& solver : solvers)
+  {
+    std::stringstream name;
+    name << solver << " [ms]";
+    printf(" %14s", name.str().c_str());
+  }
+  printf("\n");
+
+  int n_mismatches = 0;
+  for (int n_steps : { 20, 50, 100, 200, 500 })
+  {
+    printf("%8d %8d", n_steps, n_steps * (n_dof + 1) - 1);
+    double banded_cost = 0.;
+    for (const ModelType& solver : solvers)
+    {
+      Model::Ptr model = createModel(solver);
+      TrajectoryQP qp(*model, n_steps, n_dof);
+
+      double start = util::GetClock();
+      CvxOptStatus status = model->optimize();
+      double elapsed = util::GetClock() - start;
+      printf(" %14.3f", 1e3 * elapsed);
+
+      // OSQP is only solved to 1e-4, the interior point solvers should agree
+      if (status != CVX_SOLVED || solver == ModelType::OSQP)
+        continue;
+      DblVec x = model->getVarValues(model->getVars());
+      double cost = qp.objective.value(x);
+      if (solver == ModelType::BANDED)
+        banded_cost = cost;
+      else if (std::fabs(cost - banded_cost) > 1e-4 * (1. + std::fabs(cost)))
+        ++n_mismatches;
+    }
+    printf("\n");
+  }
+
+  if (n_mismatches > 0)
+    printf("%d solutions differ from the banded solver\n", n_mismatches);
+  return (n_mismatches == 0) ? 0 : 1;
+}
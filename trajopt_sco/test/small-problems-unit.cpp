@@ -3,12 +3,16 @@ TRAJOPT_IGNORE_WARNINGS_PUSH
 #include <Eigen/Dense>
 #include <boost/format.hpp>
 #include <cmath>
+#include <cstring>
+#include <fstream>
 #include <gtest/gtest.h>
 #include <iostream>
 #include <sstream>
+#include <unistd.h>
 TRAJOPT_IGNORE_WARNINGS_POP
 
 #include <trajopt_sco/expr_op_overloads.hpp>
+#include <trajopt_sco/iteration_log.hpp>
 #include <trajopt_sco/modeling_utils.hpp>
 #include <trajopt_sco/optimizers.hpp>
 #include <trajopt_sco/sco_common.hpp>
@@ -84,12 +88,103 @@ TEST_P(SQP, QuadraticNonseparable)
   // todo: checks on number of iterations and function evaluates
 }
 
-void testProblem(ScalarOfVector::Ptr f,
-                 VectorOfVector::Ptr g,
-                 ConstraintType cnt_type,
-                 const DblVec& init,
-                 const DblVec& sol,
-                 ModelType convex_solver)
+/** @brief (x0 - 1)^2 + x1^2 + 10 * hinge(1 - x1). Exactly convex, counts how often it is convexified */
+class ConvexHingeCost : public Cost
+{
+public:
+  ConvexHingeCost(const VarVector& vars) : Cost("convex_hinge"), vars_(vars) {}
+  double value(const DblVec& x) override
+  {
+    double x0 = vars_[0].value(x), x1 = vars_[1].value(x);
+    return sq(x0 - 1) + sq(x1) + 10 * pospart(1 - x1);
+  }
+  ConvexObjective::Ptr convex(const DblVec& /*x*/, Model* model) override
+  {
+    ++n_convex_calls_;
+    ConvexObjective::Ptr out(new ConvexObjective(model));
+    out->addQuadExpr(exprSquare(exprAdd(AffExpr(vars_[0]), -1)));
+    out->addQuadExpr(exprSquare(vars_[1]));
+    out->addHinge(exprSub(AffExpr(1), AffExpr(vars_[1])), 10);
+    return out;
+  }
+  VarVector getVars() override { return vars_; }
+  bool isConvex() override { return true; }
+
+  VarVector vars_;
+  int n_convex_calls_{ 0 };
+};
+
+TEST_P(SQP, ConvexCostConvexifiedOnce)
+{
+  OptProb::Ptr prob;
+  setupProblem(prob, 2, GetParam());
+  std::shared_ptr<ConvexHingeCost> cost(new ConvexHingeCost(prob->getVars()));
+  prob->addCost(cost);
+  BasicTrustRegionSQP solver(prob);
+  BasicTrustRegionSQPParameters& params = solver.getParameters();
+  params.trust_box_size = 1;
+  params.min_approx_improve = 1e-8;
+  DblVec x = { 3, -2 };
+  solver.initialize(x);
+  OptStatus status = solver.optimize();
+  ASSERT_EQ(status, OPT_CONVERGED);
+  expectAllNear(solver.x(), { 1, 1 }, 1e-3);
+  EXPECT_GT(solver.results().n_qp_solves, 1);
+  EXPECT_EQ(cost->n_convex_calls_, 1);
+}
+
+/** @brief (x0 - 3)^2 + (x1 + 3)^2 with soft bounds [-1, 1] on both variables */
+class SoftBoundCost : public Cost
+{
+public:
+  SoftBoundCost(const VarVector& vars) : Cost("soft_bound"), vars_(vars) {}
+  double value(const DblVec& x) override
+  {
+    double x0 = vars_[0].value(x), x1 = vars_[1].value(x);
+    return sq(x0 - 3) + sq(x1 + 3) + 10 * (pospart(x0 - 1) + pospart(-1 - x0) + pospart(x1 - 1) + pospart(-1 - x1));
+  }
+  ConvexObjective::Ptr convex(const DblVec& /*x*/, Model* model) override
+  {
+    ConvexObjective::Ptr out(new ConvexObjective(model));
+    out->addQuadExpr(exprSquare(exprAdd(AffExpr(vars_[0]), -3)));
+    out->addQuadExpr(exprSquare(exprAdd(AffExpr(vars_[1]), 3)));
+    out->addSoftBound(AffExpr(vars_[0]), -1, 1, 10);
+    out->addSoftBound(AffExpr(vars_[1]), -1, 1, 10);
+    n_aux_vars_ = out->vars_.size();
+    return out;
+  }
+  VarVector getVars() override { return vars_; }
+
+  VarVector vars_;
+  size_t n_aux_vars_{ 0 };
+};
+
+TEST_P(SQP, SoftBound)
+{
+  OptProb::Ptr prob;
+  setupProblem(prob, 2, GetParam());
+  std::shared_ptr<SoftBoundCost> cost(new SoftBoundCost(prob->getVars()));
+  prob->addCost(cost);
+  BasicTrustRegionSQP solver(prob);
+  BasicTrustRegionSQPParameters& params = solver.getParameters();
+  params.trust_box_size = 10;
+  DblVec x = { 0, 0 };
+  solver.initialize(x);
+  OptStatus status = solver.optimize();
+  ASSERT_EQ(status, OPT_CONVERGED);
+  expectAllNear(solver.x(), { 1, -1 }, 1e-3);
+  // One auxiliary variable per soft bound
+  EXPECT_EQ(cost->n_aux_vars_, 2);
+}
+
+OptResults testProblem(ScalarOfVector::Ptr f,
+                       VectorOfVector::Ptr g,
+                       ConstraintType cnt_type,
+                       const DblVec& init,
+                       const DblVec& sol,
+                       ModelType convex_solver,
+                       bool use_filter = false,
+                       int max_backtrack_steps = 0)
 {
   OptProb::Ptr prob;
   size_t n = init.size();
@@ -103,11 +198,14 @@ void testProblem(ScalarOfVector::Ptr f,
   params.min_trust_box_size = 1e-5;
   params.min_approx_improve = 1e-10;
   params.merit_error_coeff = 1;
+  params.use_filter = use_filter;
+  params.max_backtrack_steps = max_backtrack_steps;
 
   solver.initialize(init);
   OptStatus status = solver.optimize();
   EXPECT_EQ(status, OPT_CONVERGED);
   expectAllNear(solver.x(), sol, .01);
+  return solver.results();
 }
 // http://www.ai7.uni-bayreuth.de/test_problem_coll.pdf
 
@@ -172,6 +270,451 @@ TEST_P(SQP, TP7)
               GetParam());
 }
 
+struct TestProblem
+{
+  double (*f)(const VectorXd&);
+  VectorXd (*g)(const VectorXd&);
+  ConstraintType cnt_type;
+  DblVec init, sol;
+};
+
+std::vector<TestProblem> testProblems()
+{
+  return { { &f_TP1, &g_TP1, INEQ, { -2, 1 }, { 1, 1 } },
+           { &f_TP3, &g_TP3, INEQ, { 10, 1 }, { 0, 0 } },
+           { &f_TP6, &g_TP6, EQ, { 10, 1 }, { 1, 1 } },
+           { &f_TP7, &g_TP7, EQ, { 2, 2 }, { 0., sqrtf(3.) } } };
+}
+
+/** The filter solves the test problems to the same solutions and rejects fewer QP steps than the merit test alone */
+TEST_P(SQP, FilterAcceptance)
+{
+  int rejected[2] = { 0, 0 };
+  int filter_steps = 0;
+  for (const TestProblem& p : testProblems())
+  {
+    for (int use_filter = 0; use_filter < 2; ++use_filter)
+    {
+      OptResults results = testProblem(ScalarOfVector::construct(p.f),
+                                       VectorOfVector::construct(p.g),
+                                       p.cnt_type,
+                                       p.init,
+                                       p.sol,
+                                       GetParam(),
+                                       use_filter == 1);
+      rejected[use_filter] += results.n_rejected_steps;
+      filter_steps += results.n_filter_steps;
+    }
+  }
+  EXPECT_GT(filter_steps, 0);
+  EXPECT_LT(rejected[1], rejected[0]);
+}
+
+/** Backtracking along rejected steps solves the test problems to the same solutions with fewer QP solves */
+TEST_P(SQP, Backtracking)
+{
+  int qp_solves[2] = { 0, 0 };
+  int backtrack_steps = 0;
+  for (const TestProblem& p : testProblems())
+  {
+    for (int backtrack = 0; backtrack < 2; ++backtrack)
+    {
+      OptResults results = testProblem(ScalarOfVector::construct(p.f),
+                                       VectorOfVector::construct(p.g),
+                                       p.cnt_type,
+                                       p.init,
+                                       p.sol,
+                                       GetParam(),
+                                       false,
+                                       backtrack * 3);
+      qp_solves[backtrack] += results.n_qp_solves;
+      backtrack_steps += results.n_backtrack_steps;
+    }
+  }
+  EXPECT_GT(backtrack_steps, 0);
+  EXPECT_LT(qp_solves[1], qp_solves[0]);
+}
+
+double f_BadlyScaled(const VectorXd& x) { return sq(x(0) - 1) + sq(0.01 * x(1) - 1); }
+
+/** Scaling the trust region of the variable that needs a 100 times longer path, or adapting it, saves iterations */
+TEST_P(SQP, TrustBoxScales)
+{
+  int qp_solves[3];
+  for (int mode = 0; mode < 3; ++mode)
+  {
+    OptProb::Ptr prob;
+    setupProblem(prob, 2, GetParam());
+    prob->addCost(Cost::Ptr(new CostFromFunc(ScalarOfVector::construct(&f_BadlyScaled), prob->getVars(), "f", true)));
+    BasicTrustRegionSQP solver(prob);
+    BasicTrustRegionSQPParameters& params = solver.getParameters();
+    params.max_iter = 1000;
+    params.min_approx_improve = 1e-10;
+    if (mode == 1)
+      params.trust_box_scales = { 1, 100 };
+    params.adapt_trust_box_scales = (mode == 2);
+
+    solver.initialize({ 0, 0 });
+    EXPECT_EQ(solver.optimize(), OPT_CONVERGED);
+    expectAllNear(solver.x(), { 1, 100 }, 1e-3);
+    qp_solves[mode] = solver.results().n_qp_solves;
+    ASSERT_EQ(solver.results().trust_box_scales.size(), 2);
+  }
+  EXPECT_LT(qp_solves[1], qp_solves[0]);
+  EXPECT_LT(qp_solves[2], qp_solves[0]);
+}
+
+/** Without time left only the first iteration runs */
+TEST_P(SQP, TimeLimit)
+{
+  OptProb::Ptr prob;
+  setupProblem(prob, 2, GetParam());
+  prob->addCost(Cost::Ptr(new CostFromFunc(ScalarOfVector::construct(&f_BadlyScaled), prob->getVars(), "f", true)));
+  BasicTrustRegionSQP solver(prob);
+  solver.getParameters().max_time = 0;
+  solver.initialize({ 0, 0 });
+  EXPECT_EQ(solver.optimize(), OPT_TIME_LIMIT);
+  EXPECT_EQ(solver.results().status, OPT_TIME_LIMIT);
+  EXPECT_EQ(solver.results().n_qp_solves, 1);
+  EXPECT_LT(solver.results().total_cost, f_BadlyScaled(Eigen::Vector2d(0, 0)));
+}
+
+/** A scale vector that does not divide the variables is rejected */
+TEST_P(SQP, TrustBoxScalesSize)
+{
+  OptProb::Ptr prob;
+  setupProblem(prob, 3, GetParam());
+  prob->addCost(Cost::Ptr(new CostFromFunc(ScalarOfVector::construct(&f_QuadraticSeparable), prob->getVars(), "f")));
+  BasicTrustRegionSQP solver(prob);
+  solver.getParameters().trust_box_scales = { 1, 2 };
+  solver.initialize({ 0, 0, 0 });
+  EXPECT_ANY_THROW(solver.optimize());
+}
+
+/** @brief Analytic Jacobian of g_TP6 in sparse form */
+class SparseJacTP6 : public SparseMatrixOfVector
+{
+public:
+  SparseMatrix operator()(const VectorXd& x) const override
+  {
+    SparseMatrix jac(1, 2);
+    jac.insert(0, 0) = -20 * x(0);
+    jac.insert(0, 1) = 10;
+    return jac;
+  }
+};
+
+TEST_P(SQP, TP6SparseJacobian)
+{
+  OptProb::Ptr prob;
+  setupProblem(prob, 2, GetParam());
+  prob->addCost(Cost::Ptr(new CostFromFunc(ScalarOfVector::construct(&f_TP6), prob->getVars(), "f", true)));
+  prob->addConstraint(Constraint::Ptr(new ConstraintFromErrFunc(VectorOfVector::construct(&g_TP6),
+                                                                SparseMatrixOfVector::Ptr(new SparseJacTP6()),
+                                                                prob->getVars(),
+                                                                VectorXd(),
+                                                                EQ,
+                                                                "g")));
+  BasicTrustRegionSQP solver(prob);
+  BasicTrustRegionSQPParameters& params = solver.getParameters();
+  params.max_iter = 1000;
+  params.min_trust_box_size = 1e-5;
+  params.min_approx_improve = 1e-10;
+  params.merit_error_coeff = 1;
+
+  solver.initialize({ 10, 1 });
+  OptStatus status = solver.optimize();
+  EXPECT_EQ(status, OPT_CONVERGED);
+  expectAllNear(solver.x(), { 1, 1 }, .01);
+}
+
+VectorXd g_Satisfied(const VectorXd& x)
+{
+  VectorXd out(1);
+  out(0) = -1 - sq(x(1));
+  return out;
+}
+
+/** Only the penalty of the constraint that stays violated is increased, the satisfied one keeps its coefficient */
+TEST_P(SQP, PerConstraintMeritCoeffs)
+{
+  for (bool violated_only : { true, false })
+  {
+    OptProb::Ptr prob;
+    setupProblem(prob, 2, GetParam());
+    prob->setLowerBounds({ -10, -10 });
+    prob->setUpperBounds({ 10, 10 });
+    prob->addCost(Cost::Ptr(new CostFromFunc(ScalarOfVector::construct(&f_TP3), prob->getVars(), "f", true)));
+    prob->addConstraint(Constraint::Ptr(
+        new ConstraintFromErrFunc(VectorOfVector::construct(&g_TP3), prob->getVars(), VectorXd(), INEQ, "g")));
+    prob->addConstraint(Constraint::Ptr(
+        new ConstraintFromErrFunc(VectorOfVector::construct(&g_Satisfied), prob->getVars(), VectorXd(), INEQ, "h")));
+    BasicTrustRegionSQP solver(prob);
+    BasicTrustRegionSQPParameters& params = solver.getParameters();
+    params.min_approx_improve = 1e-10;
+    params.merit_error_coeff = 0.05;
+    params.merit_coeff_increase_violated_only = violated_only;
+
+    solver.initialize({ 1, 1 });
+    EXPECT_EQ(solver.optimize(), OPT_CONVERGED);
+    EXPECT_NEAR(solver.x()[1], 0, 1e-3);
+
+    // 0.05 and 0.5 are smaller than the slope of the cost, so g needs two increases
+    const OptResults& results = solver.results();
+    EXPECT_EQ(results.n_merit_increases, 2);
+    ASSERT_EQ(results.merit_error_coeffs.size(), 2);
+    EXPECT_NEAR(results.merit_error_coeffs[0], 5, 1e-9);
+    EXPECT_NEAR(results.merit_error_coeffs[1], violated_only ? 0.05 : 5, 1e-9);
+  }
+}
+
+/** Points that already satisfy the linear constraints are only clamped to the bounds, without solving a QP */
+TEST_P(SQP, ClosestFeasiblePoint)
+{
+  OptProb::Ptr prob;
+  setupProblem(prob, 2, GetParam());
+  prob->setLowerBounds({ -1, -1 });
+  prob->setUpperBounds({ 1, 1 });
+  EXPECT_EQ(prob->getClosestFeasiblePoint({ 2, 0.5 }), DblVec({ 1, 0.5 }));
+
+  AffExpr sum = exprAdd(AffExpr(prob->getVars()[0]), prob->getVars()[1]);
+  exprDec(sum, 1);
+  CntVector cnts{ prob->addLinearConstraint(sum, EQ) };
+  EXPECT_EQ(prob->getClosestFeasiblePoint({ 0.25, 0.75 }), DblVec({ 0.25, 0.75 }));
+
+  DblVec projected = prob->getClosestFeasiblePoint({ 0, 0 });
+  expectAllNear(projected, { 0.5, 0.5 }, 1e-4);
+  EXPECT_EQ(prob->getClosestFeasiblePoint({ 0, 0 }), projected);
+
+  prob->removeLinearConstraints(cnts);
+  EXPECT_EQ(prob->getClosestFeasiblePoint({ 0, 0 }), DblVec({ 0, 0 }));
+}
+
+/** @brief Smooth, positive and coupled error, so its ABS penalty is only linearized by the QP */
+VectorXd g_Smooth(const VectorXd& x)
+{
+  VectorXd out(1);
+  out(0) = 1 + sq(x(0) + x(1) - 3) + 4 * sq(x(0) - x(1) - 1) + 0.1 * sq(sq(x(0)));
+  return out;
+}
+
+/** @brief Coupled cost whose diagonal Hessian misses the coupling */
+double f_Coupled(const VectorXd& x) { return sq(x(0) + x(1) - 3) + 0.01 * sq(x(0) - x(1) - 1) + 0.1 * sq(sq(x(0))); }
+
+/** The quasi-Newton Hessians converge in fewer QP solves than the first order model, to at least as good a point */
+TEST_P(SQP, QuasiNewton)
+{
+  for (bool err_func : { true, false })
+  {
+    int qp_solves[3];
+    double cost[3];
+    DblVec x[3];
+    for (QuasiNewtonType type : { QN_NONE, QN_BFGS, QN_SR1 })
+    {
+      OptProb::Ptr prob;
+      setupProblem(prob, 2, GetParam());
+      if (err_func)
+      {
+        auto term = std::make_shared<CostFromErrFunc>(
+            VectorOfVector::construct(&g_Smooth), prob->getVars(), VectorXd(), ABS, "g");
+        term->setQuasiNewton(type);
+        prob->addCost(term);
+      }
+      else
+      {
+        auto term = std::make_shared<CostFromFunc>(ScalarOfVector::construct(&f_Coupled), prob->getVars(), "f");
+        term->setQuasiNewton(type);
+        prob->addCost(term);
+      }
+      BasicTrustRegionSQP solver(prob);
+      solver.getParameters().min_approx_improve = 1e-8;
+      solver.getParameters().max_iter = 200;
+      solver.initialize({ -3, 4 });
+      OptStatus status = solver.optimize();
+      if (type != QN_NONE)
+        EXPECT_EQ(status, OPT_CONVERGED);
+      qp_solves[type] = solver.results().n_qp_solves;
+      cost[type] = solver.results().total_cost;
+      x[type] = solver.x();
+    }
+    expectAllNear(x[QN_SR1], x[QN_BFGS], 1e-3);
+    EXPECT_LE(cost[QN_BFGS], cost[QN_NONE] + 1e-6);
+    EXPECT_LE(cost[QN_SR1], cost[QN_NONE] + 1e-6);
+    EXPECT_LT(qp_solves[QN_BFGS], qp_solves[QN_NONE]);
+    EXPECT_LT(qp_solves[QN_SR1], qp_solves[QN_NONE]);
+  }
+}
+
+/** @brief g_Smooth moved by a shift that can change between optimizations, like a retargeted pose error */
+class ShiftedSmooth : public VectorOfVector
+{
+public:
+  VectorXd operator()(const VectorXd& x) const override { return g_Smooth(x - shift); }
+  VectorXd shift = VectorXd::Zero(2);
+};
+
+/** The quasi-Newton Hessian of the last optimization is forgotten, so re-solving after a retarget matches a new cost */
+TEST_P(SQP, QuasiNewtonRetarget)
+{
+  for (QuasiNewtonType type : { QN_BFGS, QN_SR1 })
+  {
+    auto solve = [](const OptProb::Ptr& prob, const DblVec& init, DblVec& x) {
+      BasicTrustRegionSQP solver(prob);
+      solver.getParameters().min_approx_improve = 1e-8;
+      solver.getParameters().max_iter = 200;
+      solver.initialize(init);
+      EXPECT_EQ(solver.optimize(), OPT_CONVERGED);
+      x = solver.x();
+      return solver.results().n_qp_solves;
+    };
+    auto shifted = std::make_shared<ShiftedSmooth>();
+    auto addTerm = [this, type, &shifted](OptProb::Ptr& prob) {
+      setupProblem(prob, 2, GetParam());
+      auto term = std::make_shared<CostFromErrFunc>(shifted, prob->getVars(), VectorXd(), ABS, "g");
+      term->setQuasiNewton(type);
+      prob->addCost(term);
+    };
+
+    OptProb::Ptr prob;
+    addTerm(prob);
+    DblVec first, resolved, fresh;
+    solve(prob, { -3, 4 }, first);
+
+    shifted->shift = Eigen::Vector2d(1, -1);
+    int resolved_qp_solves = solve(prob, first, resolved);
+    OptProb::Ptr fresh_prob;
+    addTerm(fresh_prob);
+    int fresh_qp_solves = solve(fresh_prob, first, fresh);
+
+    expectAllNear(resolved, { first[0] + 1, first[1] - 1 }, 1e-3);
+    expectAllNear(resolved, fresh, 1e-10);
+    EXPECT_EQ(resolved_qp_solves, fresh_qp_solves);
+  }
+}
+
+TEST_P(SQP, RecordTiming)
+{
+  OptProb::Ptr prob;
+  setupProblem(prob, 2, GetParam());
+  prob->addCost(Cost::Ptr(new CostFromFunc(ScalarOfVector::construct(&f_TP6), prob->getVars(), "f", true)));
+  prob->addConstraint(Constraint::Ptr(
+      new ConstraintFromErrFunc(VectorOfVector::construct(&g_TP6), prob->getVars(), VectorXd(), EQ, "g")));
+  BasicTrustRegionSQP solver(prob);
+  BasicTrustRegionSQPParameters& params = solver.getParameters();
+  params.max_iter = 1000;
+  params.min_trust_box_size = 1e-5;
+  params.min_approx_improve = 1e-10;
+  params.merit_error_coeff = 1;
+
+  // Nothing is recorded by default
+  solver.initialize({ 10, 1 });
+  solver.optimize();
+  EXPECT_EQ(solver.results().timing.total, 0);
+  EXPECT_TRUE(solver.results().timing.iterations.empty());
+  EXPECT_TRUE(solver.results().timing.costs.empty());
+
+  params.record_timing = true;
+  solver.initialize({ 10, 1 });
+  OptStatus status = solver.optimize();
+  EXPECT_EQ(status, OPT_CONVERGED);
+
+  const OptTiming& timing = solver.results().timing;
+  EXPECT_GT(timing.total, 0);
+  EXPECT_FALSE(timing.iterations.empty());
+  EXPECT_GT(timing.phases.qp_solve, 0);
+  EXPECT_GT(timing.phases.convexify, 0);
+  EXPECT_LE(timing.phases.sum(), timing.total);
+
+  OptPhaseTiming iterations_sum;
+  for (const OptPhaseTiming& iteration : timing.iterations)
+    iterations_sum += iteration;
+  EXPECT_LE(iterations_sum.sum(), timing.phases.sum());
+
+  ASSERT_EQ(timing.costs.size(), 1);
+  ASSERT_EQ(timing.cnts.size(), 1);
+  EXPECT_GT(timing.costs.at("f").convexify, 0);
+  EXPECT_GT(timing.costs.at("f").evaluate, 0);
+  EXPECT_GT(timing.cnts.at("g").convexify, 0);
+  EXPECT_GT(timing.cnts.at("g").evaluate, 0);
+  EXPECT_LE(timing.costs.at("f").convexify + timing.cnts.at("g").convexify, timing.phases.convexify);
+}
+
+namespace
+{
+uint32_t readUInt32(std::istream& in)
+{
+  uint32_t value = 0;
+  in.read(reinterpret_cast<char*>(&value), sizeof(value));
+  return value;
+}
+
+std::vector<std::string> readNames(std::istream& in, uint32_t count)
+{
+  std::vector<std::string> names;
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    std::string name(readUInt32(in), '\0');
+    in.read(&name[0], static_cast<std::streamsize>(name.size()));
+    names.push_back(name);
+  }
+  return names;
+}
+}  // namespace
+
+TEST_P(SQP, IterationLog)
+{
+  OptProb::Ptr prob;
+  setupProblem(prob, 2, GetParam());
+  prob->addCost(Cost::Ptr(new CostFromFunc(ScalarOfVector::construct(&f_TP6), prob->getVars(), "f", true)));
+  prob->addConstraint(Constraint::Ptr(
+      new ConstraintFromErrFunc(VectorOfVector::construct(&g_TP6), prob->getVars(), VectorXd(), EQ, "g")));
+  BasicTrustRegionSQP solver(prob);
+  BasicTrustRegionSQPParameters& params = solver.getParameters();
+  params.max_iter = 1000;
+  params.min_trust_box_size = 1e-5;
+  params.min_approx_improve = 1e-10;
+  params.merit_error_coeff = 1;
+
+  char log_dir[] = "/tmp/trajopt_sco_logXXXXXX";
+  ASSERT_NE(mkdtemp(log_dir), nullptr);
+  params.log_results = true;
+  params.log_dir = log_dir;
+  solver.initialize({ 10, 1 });
+  EXPECT_EQ(solver.optimize(), OPT_CONVERGED);
+
+  // The log is complete once optimize() returns
+  std::string path = std::string(log_dir) + "/trajopt_iterations.bin";
+  std::ifstream in(path, std::ios::binary);
+  ASSERT_TRUE(in.good());
+
+  char magic[8];
+  in.read(magic, sizeof(magic));
+  EXPECT_EQ(std::string(magic, sizeof(magic)), std::string(IterationLogWriter::MAGIC, sizeof(magic)));
+  EXPECT_EQ(readUInt32(in), IterationLogWriter::VERSION);
+  uint32_t n_vars = readUInt32(in);
+  uint32_t n_costs = readUInt32(in);
+  uint32_t n_cnts = readUInt32(in);
+  EXPECT_EQ(readNames(in, n_vars), std::vector<std::string>({ "x_0", "x_1" }));
+  EXPECT_EQ(readNames(in, n_costs), std::vector<std::string>({ "f" }));
+  EXPECT_EQ(readNames(in, n_cnts), std::vector<std::string>({ "g" }));
+
+  std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  size_t record_size = IterationLogWriter::RECORD_HEADER_SIZE + n_vars + 3 * n_costs + 4 * n_cnts;
+  ASSERT_EQ(data.size() % (record_size * sizeof(double)), 0);
+  std::vector<double> values(data.size() / sizeof(double));
+  ASSERT_GT(values.size(), 0);
+  std::memcpy(values.data(), data.data(), data.size());
+
+  size_t n_records = values.size() / record_size;
+  for (size_t i = 0; i < n_records; ++i)
+    EXPECT_TRUE(std::isfinite(values[i * record_size]));
+  EXPECT_EQ(values[4], params.merit_error_coeff);
+  EXPECT_EQ(values[record_size - 1], params.merit_error_coeff);
+
+  std::remove(path.c_str());
+  rmdir(log_dir);
+}
+
 auto getAvailableSolvers = []() {
   std::vector<ModelType> solvers = availableSolvers();
   auto it = std::find(solvers.begin(), solvers.end(), ModelType::OSQP);
@@ -1,10 +1,18 @@
 #include <trajopt_utils/macros.h>
 TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <atomic>
 #include <cstdio>
+#include <dirent.h>
+#include <fstream>
 #include <gtest/gtest.h>
 #include <iostream>
+#include <signal.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
 TRAJOPT_IGNORE_WARNINGS_POP
 
+#include <trajopt_sco/bpmpd_interface.hpp>
 #include <trajopt_sco/expr_ops.hpp>
 #include <trajopt_sco/solver_interface.hpp>
 #include <trajopt_utils/logging.hpp>
@@ -241,6 +249,133 @@ TEST_P(SolverInterface, ExprMult_test3)
   EXPECT_NEAR(aff12.value(soln), answer, 1e-6);
 }
 
+#ifdef HAVE_BPMPD
+namespace
+{
+/** @brief min (x - target)^2 with 0 <= x <= 10 */
+Model::Ptr targetModel(Var& x, double target)
+{
+  Model::Ptr model = createModel(ModelType::BPMPD);
+  x = model->addVar("x");
+  model->update();
+  model->setVarBounds(x, 0, 10);
+  AffExpr err(x);
+  err.constant = -target;
+  model->setObjective(exprSquare(err));
+  model->update();
+  return model;
+}
+
+/** @brief Kill the bpmpd_caller processes started by this process. Returns how many were killed. */
+int killWorkers()
+{
+  int killed = 0;
+  DIR* proc = opendir("/proc");
+  if (proc == nullptr)
+    return 0;
+  while (dirent* entry = readdir(proc))
+  {
+    pid_t pid = static_cast<pid_t>(atoi(entry->d_name));
+    if (pid <= 0)
+      continue;
+
+    std::ifstream stat_file(std::string("/proc/") + entry->d_name + "/stat");
+    std::string stat;
+    std::getline(stat_file, stat);
+    size_t comm_end = stat.rfind(')');
+    if (comm_end == std::string::npos || stat.find("bpmpd_caller") == std::string::npos)
+      continue;
+
+    char state;
+    int ppid = 0;
+    if (std::sscanf(stat.c_str() + comm_end + 1, " %c %d", &state, &ppid) == 2 && ppid == getpid() &&
+        kill(pid, SIGKILL) == 0)
+      ++killed;
+  }
+  closedir(proc);
+  return killed;
+}
+
+/** @brief Restores the worker pool size when destroyed */
+struct PoolSizeGuard
+{
+  size_t size = getBPMPDWorkerPoolSize();
+  ~PoolSizeGuard() { setBPMPDWorkerPoolSize(size); }
+};
+}  // namespace
+
+/** A worker killed while idle is replaced without failing the solve, one killed while solving is restarted */
+TEST(BPMPDWorkerPool, KilledWorkerRestarts)
+{
+  PoolSizeGuard guard;
+  setBPMPDWorkerPoolSize(1);
+
+  Var x;
+  Model::Ptr model = targetModel(x, 3);
+  ASSERT_EQ(model->optimize(), CVX_SOLVED);
+  EXPECT_NEAR(model->getVarValue(x), 3, 1e-6);
+
+  // Killed between solves
+  EXPECT_GT(killWorkers(), 0);
+  ASSERT_EQ(model->optimize(), CVX_SOLVED);
+  EXPECT_NEAR(model->getVarValue(x), 3, 1e-6);
+
+  // Killed while solving
+  std::atomic<bool> done(false);
+  int n_failed = 0;
+  std::thread solver([&]() {
+    Var y;
+    Model::Ptr solving = targetModel(y, 5);
+    for (int i = 0; i < 200; ++i)
+    {
+      CvxOptStatus status = solving->optimize();
+      if (status == CVX_SOLVED)
+        EXPECT_NEAR(solving->getVarValue(y), 5, 1e-6);
+      else
+        ++n_failed;
+    }
+    done = true;
+  });
+  int killed = 0;
+  while (!done)
+  {
+    killed += killWorkers();
+    std::this_thread::sleep_for(std::chrono::microseconds(200));
+  }
+  solver.join();
+  EXPECT_GT(killed, 0);
+  EXPECT_LT(n_failed, 200);
+
+  ASSERT_EQ(model->optimize(), CVX_SOLVED);
+  EXPECT_NEAR(model->getVarValue(x), 3, 1e-6);
+}
+
+/** Solves from more threads than workers each get their own solution */
+TEST(BPMPDWorkerPool, ConcurrentSolves)
+{
+  PoolSizeGuard guard;
+  setBPMPDWorkerPoolSize(3);
+
+  const int n_threads = 8;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < n_threads; ++t)
+  {
+    threads.emplace_back([t]() {
+      for (int i = 0; i < 20; ++i)
+      {
+        double target = 1 + 0.5 * t + 0.01 * i;
+        Var x;
+        Model::Ptr model = targetModel(x, target);
+        ASSERT_EQ(model->optimize(), CVX_SOLVED);
+        EXPECT_NEAR(model->getVarValue(x), target, 1e-6);
+      }
+    });
+  }
+  for (std::thread& thread : threads)
+    thread.join();
+}
+#endif
+
 auto getAvailableSolvers = []() {
   std::vector<ModelType> solvers = availableSolvers();
   auto it = std::find(solvers.begin(), solvers.end(), ModelType::OSQP);
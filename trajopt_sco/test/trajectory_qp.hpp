@@ -0,0 +1,75 @@
+#pragma once
+#include <trajopt_utils/macros.h>
+TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+TRAJOPT_IGNORE_WARNINGS_POP
+
+#include <trajopt_sco/expr_ops.hpp>
+#include <trajopt_sco/solver_interface.hpp>
+
+namespace sco
+{
+/**
+ * @brief Builds the kind of QP a trajectory optimization solves in one SQP iteration
+ *
+ * n_steps x n_dof joint variables are created row by row, followed by one penalty slack per step like the ones the
+ * penalty terms add. The objective penalizes velocity, acceleration and the slacks. The start and goal are fixed with
+ * equalities, the joints are bounded and a collision-like inequality couples each pair of consecutive steps.
+ */
+struct TrajectoryQP
+{
+  VarVector joints;
+  VarVector slacks;
+  QuadExpr objective;
+
+  TrajectoryQP(Model& model, int n_steps, int n_dof)
+  {
+    for (int t = 0; t < n_steps; ++t)
+      for (int j = 0; j < n_dof; ++j)
+        joints.push_back(model.addVar("j_" + std::to_string(t) + "_" + std::to_string(j), -2., 2.));
+    for (int t = 0; t + 1 < n_steps; ++t)
+      slacks.push_back(model.addVar("slack_" + std::to_string(t), 0., 1e3));
+    model.update();
+
+    for (int t = 0; t + 1 < n_steps; ++t)
+    {
+      for (int j = 0; j < n_dof; ++j)
+      {
+        exprInc(objective, exprSquare(exprSub(AffExpr(joint(t + 1, j, n_dof)), joint(t, j, n_dof))));
+        if (t > 0)
+        {
+          AffExpr acc = exprAdd(AffExpr(joint(t + 1, j, n_dof)), joint(t - 1, j, n_dof));
+          exprDec(acc, exprMult(joint(t, j, n_dof), 2.));
+          exprInc(objective, exprMult(exprSquare(acc), 0.1));
+        }
+      }
+      exprInc(objective, exprMult(slacks[static_cast<size_t>(t)], 10.));
+    }
+    model.setObjective(objective);
+
+    for (int j = 0; j < n_dof; ++j)
+    {
+      model.addEqCnt(exprSub(AffExpr(joint(0, j, n_dof)), -1.), "start");
+      model.addEqCnt(exprSub(AffExpr(joint(n_steps - 1, j, n_dof)), 1.), "goal");
+    }
+
+    // sum of the first two joints of steps t and t + 1 >= 0.5 in the middle of the trajectory, softened by the slack
+    for (int t = 0; t + 1 < n_steps; ++t)
+    {
+      double clearance = std::abs(t - n_steps / 2) < n_steps / 8 ? 0.5 : -4.;
+      AffExpr cnt(clearance);
+      for (int j = 0; j < std::min(2, n_dof); ++j)
+      {
+        exprDec(cnt, joint(t, j, n_dof));
+        exprDec(cnt, joint(t + 1, j, n_dof));
+      }
+      exprDec(cnt, slacks[static_cast<size_t>(t)]);
+      model.addIneqCnt(cnt, "clearance");
+    }
+  }
+
+  const Var& joint(int t, int j, int n_dof) const { return joints[static_cast<size_t>(t * n_dof + j)]; }
+};
+}  // namespace sco
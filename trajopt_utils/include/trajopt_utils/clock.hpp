@@ -1,7 +1,38 @@
 #pragma once
+#include <trajopt_utils/macros.h>
+TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <chrono>
+TRAJOPT_IGNORE_WARNINGS_POP
 
 namespace util
 {
 void StartClock();
 double GetClock();
+
+/**
+ * @brief Adds the time (s) between construction and destruction to an accumulator
+ *
+ * Uses the monotonic clock. If the accumulator is null the clock is never read, so a disabled timer only costs a
+ * pointer check.
+ */
+class ScopedTimer
+{
+public:
+  explicit ScopedTimer(double* accumulator) : accumulator_(accumulator)
+  {
+    if (accumulator_ != nullptr)
+      start_ = std::chrono::steady_clock::now();
+  }
+  ~ScopedTimer()
+  {
+    if (accumulator_ != nullptr)
+      *accumulator_ += std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+  }
+  ScopedTimer(const ScopedTimer&) = delete;
+  ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+  double* accumulator_;
+  std::chrono::steady_clock::time_point start_;
+};
 }  // namespace util
@@ -4,6 +4,16 @@ TRAJOPT_IGNORE_WARNINGS_PUSH
 #include <cstdio>
 TRAJOPT_IGNORE_WARNINGS_POP
 
+/**
+ * @brief The most verbose log level that is compiled in (0 FATAL ... 5 TRACE)
+ *
+ * Log statements above this level are removed by the compiler, so they cost nothing even in the optimizer hot loop.
+ * Set with the TRAJOPT_COMPILED_LOG_LEVEL cmake cache variable.
+ */
+#ifndef TRAJOPT_COMPILED_LOG_LEVEL
+#define TRAJOPT_COMPILED_LOG_LEVEL 5
+#endif
+
 namespace util
 {
 enum LogLevel
@@ -26,46 +36,55 @@ inline LogLevel GetLogLevel() { return gLogLevel; }
 #define TRACE_PREFIX "\x1b[34m[TRACE] "
 #define LOG_SUFFIX "\x1b[0m\n"
 
-#define LOG_FATAL(msg, ...)                                                                                            \
-  if (util::GetLogLevel() >= util::LevelFatal)                                                                         \
-  {                                                                                                                    \
-    printf(FATAL_PREFIX);                                                                                              \
-    printf(msg, ##__VA_ARGS__);                                                                                        \
-    printf(LOG_SUFFIX);                                                                                                \
-  }
-#define LOG_ERROR(msg, ...)                                                                                            \
-  if (util::GetLogLevel() >= util::LevelError)                                                                         \
-  {                                                                                                                    \
-    printf(ERROR_PREFIX);                                                                                              \
-    printf(msg, ##__VA_ARGS__);                                                                                        \
-    printf(LOG_SUFFIX);                                                                                                \
-  }
-#define LOG_WARN(msg, ...)                                                                                             \
-  if (util::GetLogLevel() >= util::LevelWarn)                                                                          \
-  {                                                                                                                    \
-    printf(WARN_PREFIX);                                                                                               \
-    printf(msg, ##__VA_ARGS__);                                                                                        \
-    printf(LOG_SUFFIX);                                                                                                \
-  }
-#define LOG_INFO(msg, ...)                                                                                             \
-  if (util::GetLogLevel() >= util::LevelInfo)                                                                          \
-  {                                                                                                                    \
-    printf(INFO_PREFIX);                                                                                               \
-    printf(msg, ##__VA_ARGS__);                                                                                        \
-    printf(LOG_SUFFIX);                                                                                                \
-  }
-#define LOG_DEBUG(msg, ...)                                                                                            \
-  if (util::GetLogLevel() >= util::LevelDebug)                                                                         \
-  {                                                                                                                    \
-    printf(DEBUG_PREFIX);                                                                                              \
-    printf(msg, ##__VA_ARGS__);                                                                                        \
-    printf(LOG_SUFFIX);                                                                                                \
-  }
-#define LOG_TRACE(msg, ...)                                                                                            \
-  if (util::GetLogLevel() >= util::LevelTrace)                                                                         \
+/**
+ * @brief Writes a log message. Use the LOG_* macros instead of calling this directly.
+ *
+ * If asynchronous logging is enabled the message is formatted into a lock-free ring buffer and printed by a background
+ * thread, otherwise it is printed to stdout immediately.
+ */
+void LogMessage(LogLevel level, const char* prefix, const char* msg, ...) __attribute__((format(printf, 3, 4)));
+
+/**
+ * @brief Print log messages from a background thread so logging does not block on stdout
+ *
+ * Messages are formatted on the calling thread into a fixed size slot of a lock-free ring buffer and written to stdout
+ * by a background thread. If the ring is full, DEBUG and TRACE messages are dropped (the number dropped is reported),
+ * more severe messages are printed synchronously. Disabling waits until the queued messages are printed. Can also be
+ * enabled by setting the environment variable TRAJOPT_LOG_ASYNC=1.
+ */
+void SetAsyncLogging(bool enable);
+bool IsAsyncLogging();
+
+/** @brief Wait until all messages queued for the background thread are printed */
+void FlushLog();
+
+/** @brief Tag printed with every log message of the calling thread, e.g. the name of a worker. Null clears it. */
+void SetLogThreadTag(const char* tag);
+const char* GetLogThreadTag();
+
+/** @brief Sets the log tag of the calling thread and restores the previous one when destroyed */
+class ScopedLogThreadTag
+{
+public:
+  explicit ScopedLogThreadTag(const char* tag);
+  ~ScopedLogThreadTag();
+  ScopedLogThreadTag(const ScopedLogThreadTag&) = delete;
+  ScopedLogThreadTag& operator=(const ScopedLogThreadTag&) = delete;
+
+private:
+  char previous_[32];
+};
+
+#define TRAJOPT_LOG(level, prefix, msg, ...)                                                                           \
+  if ((level) <= TRAJOPT_COMPILED_LOG_LEVEL && util::GetLogLevel() >= (level))                                       \
   {                                                                                                                    \
-    printf(TRACE_PREFIX);                                                                                              \
-    printf(msg, ##__VA_ARGS__);                                                                                        \
-    printf(LOG_SUFFIX);                                                                                                \
+    util::LogMessage(level, prefix, msg, ##__VA_ARGS__);                                                               \
   }
+
+#define LOG_FATAL(msg, ...) TRAJOPT_LOG(util::LevelFatal, FATAL_PREFIX, msg, ##__VA_ARGS__)
+#define LOG_ERROR(msg, ...) TRAJOPT_LOG(util::LevelError, ERROR_PREFIX, msg, ##__VA_ARGS__)
+#define LOG_WARN(msg, ...) TRAJOPT_LOG(util::LevelWarn, WARN_PREFIX, msg, ##__VA_ARGS__)
+#define LOG_INFO(msg, ...) TRAJOPT_LOG(util::LevelInfo, INFO_PREFIX, msg, ##__VA_ARGS__)
+#define LOG_DEBUG(msg, ...) TRAJOPT_LOG(util::LevelDebug, DEBUG_PREFIX, msg, ##__VA_ARGS__)
+#define LOG_TRACE(msg, ...) TRAJOPT_LOG(util::LevelTrace, TRACE_PREFIX, msg, ##__VA_ARGS__)
 }  // namespace util
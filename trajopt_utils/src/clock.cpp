@@ -1,40 +1,31 @@
 #include <trajopt_utils/macros.h>
 TRAJOPT_IGNORE_WARNINGS_PUSH
-#include <sys/time.h>
-#include <time.h>
+#include <atomic>
+#include <chrono>
 TRAJOPT_IGNORE_WARNINGS_POP
 
 #include <trajopt_utils/clock.hpp>
 
 namespace util
 {
-static long unsigned int startTime = 0;
+/** @brief Ticks of the monotonic clock at the last call to StartClock() */
+static std::atomic<std::chrono::steady_clock::rep> startTime(0);
 
 /*
  * Starts the clock!  Call this once at the beginning of the program.
- * Calling again will reset the clock to 0;  but doing so is not
- * thread-safe if other threads may be calling GetClock(); (which
- * is thread-safe since it only reads values and calls thread-safe
- * functions in the kernel).
+ * Calling again will reset the clock to 0. The clock is monotonic, so
+ * differences between calls to GetClock() are not affected by changes
+ * to the system time.
  */
 // time in units of seconds since some time in the past
-void StartClock()
-{
-  // determine start time
-  struct timeval startTimeStruct;
-  gettimeofday(&startTimeStruct, nullptr);
-  startTime = static_cast<unsigned long>(startTimeStruct.tv_sec * 1e6l + startTimeStruct.tv_usec);
-}
+void StartClock() { startTime = std::chrono::steady_clock::now().time_since_epoch().count(); }
 
 /*
  * Returns the current time since the call to StartClock();
  */
 double GetClock()
 {
-  struct timeval startTimeStruct;
-  unsigned long int curTime;
-  gettimeofday(&startTimeStruct, nullptr);
-  curTime = static_cast<unsigned long>(startTimeStruct.tv_sec * 1e6l + startTimeStruct.tv_usec);
-  return (1e-6) * static_cast<double>(curTime - startTime);
+  std::chrono::steady_clock::duration elapsed(std::chrono::steady_clock::now().time_since_epoch().count() - startTime);
+  return std::chrono::duration<double>(elapsed).count();
 }
 }  // namespace util
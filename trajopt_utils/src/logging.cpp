@@ -1,8 +1,15 @@
 #include <trajopt_utils/macros.h>
 TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 TRAJOPT_IGNORE_WARNINGS_POP
 
 #include <trajopt_utils/logging.hpp>
@@ -11,6 +18,287 @@ namespace util
 {
 LogLevel gLogLevel;
 
+namespace
+{
+const size_t LOG_TAG_SIZE = 32;
+thread_local char gThreadTag[LOG_TAG_SIZE] = { '\0' };
+std::atomic<bool> gAsyncLogging(false);
+std::mutex gAsyncLoggingMutex; /**< Serializes starting and stopping the background thread */
+
+/** @brief Writes "[tag] " followed by the formatted message to buf, truncating it to size */
+void formatMessage(char* buf, size_t size, const char* msg, va_list args)
+{
+  int n = 0;
+  if (gThreadTag[0] != '\0')
+    n = std::snprintf(buf, size, "[%s] ", gThreadTag);
+  if (n >= 0 && static_cast<size_t>(n) < size)
+    std::vsnprintf(buf + n, size - static_cast<size_t>(n), msg, args);
+}
+
+void printMessage(const char* prefix, const char* text)
+{
+  flockfile(stdout);
+  std::fputs(prefix, stdout);
+  std::fputs(text, stdout);
+  std::fputs(LOG_SUFFIX, stdout);
+  funlockfile(stdout);
+}
+
+/**
+ * @brief Bounded multi-producer single-consumer ring of formatted log messages
+ *
+ * Producers claim a slot with a compare and swap on the enqueue position and publish it through the slot sequence
+ * number (D. Vyukov's bounded queue), so logging never takes a lock. A background thread prints the messages.
+ * Messages longer than MESSAGE_SIZE are truncated.
+ *
+ * Producers are counted while they use the ring. When the sink is stopped the background thread waits for the count to
+ * reach zero before it prints the last messages, so a message claimed while stopping is never lost.
+ */
+class AsyncLogSink
+{
+public:
+  static const size_t CAPACITY = 4096;
+  static const size_t MESSAGE_SIZE = 512;
+
+  AsyncLogSink()
+    : slots_(new Slot[CAPACITY]), enqueue_pos_(0), dequeue_pos_(0), dropped_(0), producers_(0), done_(true)
+  {
+    for (size_t i = 0; i < CAPACITY; ++i)
+      slots_[i].sequence.store(i, std::memory_order_relaxed);
+  }
+
+  ~AsyncLogSink()
+  {
+    gAsyncLogging.store(false, std::memory_order_release);
+    stop();
+  }
+
+  AsyncLogSink(const AsyncLogSink&) = delete;
+  AsyncLogSink& operator=(const AsyncLogSink&) = delete;
+
+  /** @brief Start the background thread. Not thread safe w.r.t. stop(). */
+  void start()
+  {
+    if (thread_.joinable())
+      return;
+    done_.store(false);
+    thread_ = std::thread(&AsyncLogSink::run, this);
+  }
+
+  /** @brief Stop the background thread once the queued messages are printed. Not thread safe w.r.t. start(). */
+  void stop()
+  {
+    if (!thread_.joinable())
+      return;
+    done_.store(true);
+    thread_.join();
+  }
+
+  /**
+   * @brief Queue a message
+   * @return False if the message must be printed synchronously, because the sink is stopped or because the ring is full
+   * and the message is more severe than DEBUG. DEBUG and TRACE messages that do not fit are counted and dropped.
+   */
+  bool push(LogLevel level, const char* prefix, const char* msg, va_list args)
+  {
+    // Sequentially consistent with the done_ store in stop() and the producers_ load in run(): either this producer
+    // sees done_ or the background thread sees it counted
+    producers_.fetch_add(1);
+    if (done_.load())
+    {
+      producers_.fetch_sub(1, std::memory_order_release);
+      return false;
+    }
+
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    Slot* slot;
+    for (;;)
+    {
+      slot = &slots_[pos % CAPACITY];
+      size_t seq = slot->sequence.load(std::memory_order_acquire);
+      if (seq == pos)
+      {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+          break;
+      }
+      else if (seq < pos)
+      {
+        bool dropped = level >= LevelDebug;
+        if (dropped)
+          dropped_.fetch_add(1, std::memory_order_relaxed);
+        producers_.fetch_sub(1, std::memory_order_release);
+        return dropped;
+      }
+      else
+      {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+
+    slot->prefix = prefix;
+    formatMessage(slot->text, MESSAGE_SIZE, msg, args);
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    producers_.fetch_sub(1, std::memory_order_release);
+    return true;
+  }
+
+  /** @brief Wait until the messages queued before the call are printed */
+  void flush()
+  {
+    size_t target = enqueue_pos_.load(std::memory_order_acquire);
+    while (dequeue_pos_.load(std::memory_order_acquire) < target)
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    std::fflush(stdout);
+  }
+
+private:
+  struct Slot
+  {
+    std::atomic<size_t> sequence;
+    const char* prefix;
+    char text[MESSAGE_SIZE];
+  };
+
+  /** @brief Print the next message if there is one */
+  bool printNext()
+  {
+    size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    Slot& slot = slots_[pos % CAPACITY];
+    if (slot.sequence.load(std::memory_order_acquire) != pos + 1)
+      return false;
+
+    printMessage(slot.prefix, slot.text);
+    slot.sequence.store(pos + CAPACITY, std::memory_order_release);
+    dequeue_pos_.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  void reportDropped()
+  {
+    size_t dropped = dropped_.exchange(0, std::memory_order_relaxed);
+    if (dropped > 0)
+      std::printf(WARN_PREFIX "%zu log messages were dropped because the log buffer was full" LOG_SUFFIX, dropped);
+  }
+
+  void run()
+  {
+    for (;;)
+    {
+      if (done_.load())
+      {
+        // No producer can claim a slot any more once the count is zero, and every claimed slot is published
+        while (producers_.load() != 0)
+          std::this_thread::yield();
+        while (printNext())
+        {
+        }
+        reportDropped();
+        std::fflush(stdout);
+        return;
+      }
+
+      bool printed = false;
+      while (printNext())
+        printed = true;
+      reportDropped();
+
+      if (printed)
+        std::fflush(stdout);
+      else
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+
+  std::unique_ptr<Slot[]> slots_;
+  std::atomic<size_t> enqueue_pos_;
+  std::atomic<size_t> dequeue_pos_;
+  std::atomic<size_t> dropped_;
+  std::atomic<size_t> producers_; /**< Number of producers between their done_ check and publishing their slot */
+  std::atomic<bool> done_;
+  std::thread thread_;
+};
+
+/** @brief Created on first use. Destroyed at exit, after which messages are printed synchronously again. */
+AsyncLogSink& asyncLogSink()
+{
+  static AsyncLogSink sink;
+  return sink;
+}
+}  // namespace
+
+void LogMessage(LogLevel level, const char* prefix, const char* msg, ...)
+{
+  va_list args;
+  va_start(args, msg);
+  if (gAsyncLogging.load(std::memory_order_acquire))
+  {
+    va_list async_args;
+    va_copy(async_args, args);
+    bool queued = asyncLogSink().push(level, prefix, msg, async_args);
+    va_end(async_args);
+    if (queued)
+    {
+      va_end(args);
+      return;
+    }
+  }
+
+  flockfile(stdout);
+  std::fputs(prefix, stdout);
+  if (gThreadTag[0] != '\0')
+    std::printf("[%s] ", gThreadTag);
+  std::vprintf(msg, args);
+  std::fputs(LOG_SUFFIX, stdout);
+  funlockfile(stdout);
+  va_end(args);
+}
+
+void SetAsyncLogging(bool enable)
+{
+  std::lock_guard<std::mutex> lock(gAsyncLoggingMutex);
+  if (enable == gAsyncLogging.load(std::memory_order_acquire))
+    return;
+
+  if (enable)
+  {
+    asyncLogSink().start();
+    gAsyncLogging.store(true, std::memory_order_release);
+  }
+  else
+  {
+    gAsyncLogging.store(false, std::memory_order_release);
+    asyncLogSink().stop();
+  }
+}
+
+bool IsAsyncLogging() { return gAsyncLogging.load(std::memory_order_acquire); }
+
+void FlushLog()
+{
+  if (IsAsyncLogging())
+    asyncLogSink().flush();
+  else
+    std::fflush(stdout);
+}
+
+void SetLogThreadTag(const char* tag)
+{
+  if (tag == nullptr)
+    gThreadTag[0] = '\0';
+  else
+    std::snprintf(gThreadTag, LOG_TAG_SIZE, "%s", tag);
+}
+
+const char* GetLogThreadTag() { return gThreadTag; }
+
+ScopedLogThreadTag::ScopedLogThreadTag(const char* tag)
+{
+  std::memcpy(previous_, gThreadTag, sizeof(previous_));
+  SetLogThreadTag(tag);
+}
+
+ScopedLogThreadTag::~ScopedLogThreadTag() { std::memcpy(gThreadTag, previous_, sizeof(previous_)); }
+
 int LoggingInit()
 {
   const char* VALID_THRESH_VALUES = "FATAL ERROR WARN INFO DEBUG TRACE";
@@ -48,6 +336,10 @@ int LoggingInit()
     std::printf("Valid values: %s\n", VALID_THRESH_VALUES);
     abort();
   }
+
+  char* async = getenv("TRAJOPT_LOG_ASYNC");
+  if (async != nullptr && std::string(async) == "1")
+    SetAsyncLogging(true);
   return 1;
 }
 int this_is_a_hack_but_rhs_executes_on_library_load = LoggingInit();
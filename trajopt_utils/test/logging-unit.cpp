@@ -0,0 +1,192 @@
+#include <trajopt_utils/macros.h>
+TRAJOPT_IGNORE_WARNINGS_PUSH
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include <gtest/gtest.h>
+TRAJOPT_IGNORE_WARNINGS_POP
+
+#include <trajopt_utils/logging.hpp>
+
+using namespace util;
+
+namespace
+{
+const int N_PRODUCERS = 4;
+
+/** @brief Redirects stdout to a temporary file and reads back what was printed */
+class LoggingTest : public testing::Test
+{
+public:
+  void SetUp() override
+  {
+    level_ = gLogLevel;
+    gLogLevel = LevelDebug;
+    path_ = testing::TempDir() + "logging_unit.txt";
+    std::fflush(stdout);
+    stdout_fd_ = dup(fileno(stdout));
+    ASSERT_NE(std::freopen(path_.c_str(), "w", stdout), nullptr);
+  }
+
+  void TearDown() override
+  {
+    SetAsyncLogging(false);
+    restoreStdout();
+    gLogLevel = level_;
+    std::remove(path_.c_str());
+  }
+
+  /** @brief The lines printed so far */
+  std::vector<std::string> lines()
+  {
+    std::fflush(stdout);
+    std::ifstream file(path_);
+    std::vector<std::string> result;
+    std::string line;
+    while (std::getline(file, line))
+      result.push_back(line);
+    return result;
+  }
+
+  /** @brief The values of "<producer> <index>" messages, per producer in the order printed */
+  std::vector<std::vector<int>> messages()
+  {
+    std::vector<std::vector<int>> result(N_PRODUCERS);
+    for (const std::string& line : lines())
+    {
+      int producer, index;
+      if (std::sscanf(line.c_str(), "%*[^]]] message %d %d", &producer, &index) == 2)
+        result[static_cast<size_t>(producer)].push_back(index);
+    }
+    return result;
+  }
+
+  /** @brief Sum of the drop counts reported */
+  size_t dropped()
+  {
+    size_t result = 0;
+    for (const std::string& line : lines())
+    {
+      size_t n;
+      if (std::sscanf(line.c_str(), "%*[^]]] %zu log messages were dropped", &n) == 1)
+        result += n;
+    }
+    return result;
+  }
+
+private:
+  void restoreStdout()
+  {
+    if (stdout_fd_ < 0)
+      return;
+    std::fflush(stdout);
+    dup2(stdout_fd_, fileno(stdout));
+    close(stdout_fd_);
+    stdout_fd_ = -1;
+  }
+
+  LogLevel level_;
+  std::string path_;
+  int stdout_fd_ = -1;
+};
+
+/** @brief Runs N_PRODUCERS threads that log n_messages "message <producer> <index>" each */
+void produce(int n_messages, bool debug)
+{
+  std::vector<std::thread> producers;
+  for (int p = 0; p < N_PRODUCERS; ++p)
+  {
+    producers.emplace_back([p, n_messages, debug]() {
+      for (int i = 0; i < n_messages; ++i)
+      {
+        if (debug)
+        {
+          LOG_DEBUG("message %d %d", p, i);
+        }
+        else
+        {
+          LOG_INFO("message %d %d", p, i);
+        }
+      }
+    });
+  }
+  for (std::thread& producer : producers)
+    producer.join();
+}
+}  // namespace
+
+/** Messages of each producer are printed once and in the order they were logged when the ring does not overflow */
+TEST_F(LoggingTest, MultiProducerOrdering)
+{
+  SetAsyncLogging(true);
+  produce(500, true);
+  SetAsyncLogging(false);
+
+  std::vector<std::vector<int>> printed = messages();
+  for (const std::vector<int>& indices : printed)
+  {
+    ASSERT_EQ(indices.size(), 500u);
+    for (int i = 0; i < 500; ++i)
+      EXPECT_EQ(indices[static_cast<size_t>(i)], i);
+  }
+  EXPECT_EQ(dropped(), 0u);
+}
+
+/** Every DEBUG message is either printed or counted as dropped, and the messages printed stay in order */
+TEST_F(LoggingTest, DropCounting)
+{
+  const int n_messages = 20000;
+  SetAsyncLogging(true);
+  produce(n_messages, true);
+  SetAsyncLogging(false);
+
+  size_t n_printed = 0;
+  for (const std::vector<int>& indices : messages())
+  {
+    n_printed += indices.size();
+    for (size_t i = 1; i < indices.size(); ++i)
+      EXPECT_LT(indices[i - 1], indices[i]);
+  }
+  EXPECT_EQ(n_printed + dropped(), static_cast<size_t>(N_PRODUCERS * n_messages));
+}
+
+/** FlushLog returns once the messages queued before it are printed */
+TEST_F(LoggingTest, FlushLog)
+{
+  SetAsyncLogging(true);
+  for (int i = 0; i < 100; ++i)
+    LOG_INFO("message %d %d", 0, i);
+  FlushLog();
+  EXPECT_EQ(messages()[0].size(), 100u);
+  EXPECT_TRUE(IsAsyncLogging());
+}
+
+/** Messages logged while the background thread is stopped are neither lost nor printed twice */
+TEST_F(LoggingTest, LoggingDuringShutdown)
+{
+  const int n_rounds = 5;
+  const int n_messages = 4000;
+  for (int round = 0; round < n_rounds; ++round)
+  {
+    SetAsyncLogging(true);
+    std::thread stopper([]() {
+      std::this_thread::sleep_for(std::chrono::microseconds(500));
+      SetAsyncLogging(false);
+    });
+    produce(n_messages, false);
+    stopper.join();
+  }
+
+  for (const std::vector<int>& indices : messages())
+    EXPECT_EQ(indices.size(), static_cast<size_t>(n_rounds * n_messages));
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}